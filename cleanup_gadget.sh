@@ -51,8 +51,9 @@ done
 
 # 3. 删除 UVC streaming 中的链接
 echo "[3/5] 删除 UVC streaming 链接..."
-FUNC="$GADGET/functions/uvc.0"
-if [ -d "$FUNC" ]; then
+for FUNC in "$GADGET"/functions/uvc.*; do
+    [ -d "$FUNC" ] || continue
+
     # streaming header 链接
     for link in "$FUNC"/streaming/header/h/*; do
         [ -L "$link" ] && rm -f "$link"
@@ -74,31 +75,36 @@ if [ -d "$FUNC" ]; then
             [ -L "$link" ] && rm -f "$link"
         done
     done
-fi
+done
 
 # 4. 删除帧格式目录
 echo "[4/5] 删除帧格式目录..."
-if [ -d "$FUNC/streaming/uncompressed" ]; then
-    # 删除帧目录 (如 yuy2)
-    for frame in "$FUNC"/streaming/uncompressed/*/*/; do
-        [ -d "$frame" ] && rmdir "$frame" 2>/dev/null
+for FUNC in "$GADGET"/functions/uvc.*; do
+    [ -d "$FUNC" ] || continue
+
+    for kind in uncompressed framebased; do
+        [ -d "$FUNC/streaming/$kind" ] || continue
+        # 删除帧目录 (如 yuy2)
+        for frame in "$FUNC"/streaming/$kind/*/*/; do
+            [ -d "$frame" ] && rmdir "$frame" 2>/dev/null
+        done
+        # 删除格式目录 (如 u)
+        for format in "$FUNC"/streaming/$kind/*/; do
+            [ -d "$format" ] && rmdir "$format" 2>/dev/null
+        done
     done
-    # 删除格式目录 (如 u)
-    for format in "$FUNC"/streaming/uncompressed/*/; do
-        [ -d "$format" ] && rmdir "$format" 2>/dev/null
+
+    # 删除 header 目录
+    for h in "$FUNC"/streaming/header/*/; do
+        [ -d "$h" ] && rmdir "$h" 2>/dev/null
+    done
+    for h in "$FUNC"/control/header/*/; do
+        [ -d "$h" ] && rmdir "$h" 2>/dev/null
     done
-fi
 
-# 删除 header 目录
-for h in "$FUNC"/streaming/header/*/; do
-    [ -d "$h" ] && rmdir "$h" 2>/dev/null
+    # 删除 function
+    [ -d "$FUNC" ] && rmdir "$FUNC" 2>/dev/null
 done
-for h in "$FUNC"/control/header/*/; do
-    [ -d "$h" ] && rmdir "$h" 2>/dev/null
-done
-
-# 删除 function
-[ -d "$FUNC" ] && rmdir "$FUNC" 2>/dev/null
 
 # 5. 删除 configs 和 strings
 echo "[5/5] 删除配置目录..."
@@ -0,0 +1,81 @@
+/**
+ * @file config_file.c
+ * @brief key=value配置文件读取实现
+ */
+
+#include "config_file.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+/**
+ * 去掉字符串两侧的空白（原地修改）
+ */
+static char *config_trim(char *s)
+{
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    *end = '\0';
+
+    return s;
+}
+
+/**
+ * 读取配置文件
+ */
+int config_file_load(const char *path, config_handler_t handler)
+{
+    char line[256];
+    int lineno = 0;
+    int ret = 0;
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        if (errno == ENOENT) {
+            return 1;
+        }
+        fprintf(stderr, "打开配置文件%s失败: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        char *key = config_trim(line);
+        if (*key == '\0') {
+            continue;
+        }
+
+        char *eq = strchr(key, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: 缺少'=': %s\n", path, lineno, key);
+            ret = -1;
+            break;
+        }
+        *eq = '\0';
+
+        key = config_trim(key);
+        char *value = config_trim(eq + 1);
+
+        if (handler(key, value) < 0) {
+            fprintf(stderr, "%s:%d: 配置项%s无效\n", path, lineno, key);
+            ret = -1;
+            break;
+        }
+    }
+
+    fclose(f);
+    return ret;
+}
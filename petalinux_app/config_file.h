@@ -0,0 +1,36 @@
+/**
+ * @file config_file.h
+ * @brief key=value配置文件读取
+ *
+ * 每行一项 `key = value`，键名与命令行长选项相同（不带--），例如：
+ *
+ *     # /etc/uvc-camera.conf
+ *     width = 640
+ *     frames = 4
+ *     fb-phys = 0x20000000
+ *
+ * 支持#注释和空行，键和值两侧的空白被忽略。无参数的选项写作 `binning = 1`。
+ */
+
+#ifndef CONFIG_FILE_H
+#define CONFIG_FILE_H
+
+/**
+ * 配置项回调
+ *
+ * @param key 键名
+ * @param value 值（可能为空字符串）
+ * @return 0成功，-1该项无效（停止读取）
+ */
+typedef int (*config_handler_t)(const char *key, const char *value);
+
+/**
+ * 读取配置文件，逐项调用handler
+ *
+ * @param path 文件路径
+ * @param handler 配置项回调
+ * @return 0成功，1文件不存在，-1读取失败或某一项无效
+ */
+int config_file_load(const char *path, config_handler_t handler);
+
+#endif /* CONFIG_FILE_H */
@@ -0,0 +1,518 @@
+/**
+ * @file format_convert.c
+ * @brief 像素格式转换实现
+ */
+
+#include "format_convert.h"
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* ABGR32内存中的字节顺序 */
+#define PIX_B   0
+#define PIX_G   1
+#define PIX_R   2
+
+/**
+ * 8位定点色彩矩阵（系数 x 256）
+ * Y = 16  + ( yr*R + yg*G + yb*B) / 256
+ * U = 128 + (-ur*R - ug*G + ub*B) / 256
+ * V = 128 + ( vr*R - vg*G - vb*B) / 256
+ */
+typedef struct {
+    uint8_t yr, yg, yb;
+    uint8_t ur, ug, ub;
+    uint8_t vr, vg, vb;
+} csc_coeff_t;
+
+static const csc_coeff_t csc_coeffs[] = {
+    [CSC_BT601] = { 66, 129, 25,  38, 74, 112,  112, 94, 18 },
+    [CSC_BT709] = { 47, 157, 16,  26, 87, 112,  112, 102, 10 },
+};
+
+static inline uint8_t csc_y(const csc_coeff_t *c, int r, int g, int b)
+{
+    return (uint8_t)(16 + ((c->yr * r + c->yg * g + c->yb * b + 128) >> 8));
+}
+
+static inline uint8_t csc_u(const csc_coeff_t *c, int r, int g, int b)
+{
+    return (uint8_t)(128 + ((-c->ur * r - c->ug * g + c->ub * b + 128) >> 8));
+}
+
+static inline uint8_t csc_v(const csc_coeff_t *c, int r, int g, int b)
+{
+    return (uint8_t)(128 + ((c->vr * r - c->vg * g - c->vb * b + 128) >> 8));
+}
+
+/**
+ * 标量实现：转换一行中从x开始的像素为YUYV
+ */
+static void yuyv_row_scalar(uint8_t *dst, const uint8_t *src, int x, int width,
+                            const csc_coeff_t *c)
+{
+    for (; x < width; x += 2) {
+        const uint8_t *p0 = src + x * 4;
+        const uint8_t *p1 = p0 + 4;
+        int r = (p0[PIX_R] + p1[PIX_R] + 1) >> 1;
+        int g = (p0[PIX_G] + p1[PIX_G] + 1) >> 1;
+        int b = (p0[PIX_B] + p1[PIX_B] + 1) >> 1;
+        uint8_t *q = dst + x * 2;
+
+        q[0] = csc_y(c, p0[PIX_R], p0[PIX_G], p0[PIX_B]);
+        q[1] = csc_u(c, r, g, b);
+        q[2] = csc_y(c, p1[PIX_R], p1[PIX_G], p1[PIX_B]);
+        q[3] = csc_v(c, r, g, b);
+    }
+}
+
+/**
+ * 标量实现：转换一行中从x开始的像素亮度
+ */
+static void luma_row_scalar(uint8_t *dst, const uint8_t *src, int x, int width,
+                            const csc_coeff_t *c)
+{
+    for (; x < width; x++) {
+        const uint8_t *p = src + x * 4;
+        dst[x] = csc_y(c, p[PIX_R], p[PIX_G], p[PIX_B]);
+    }
+}
+
+/**
+ * 标量实现：两行2x2平均得到一行NV12色度，从x开始
+ */
+static void chroma_420_row_scalar(uint8_t *dst_uv, const uint8_t *src0, const uint8_t *src1,
+                                  int x, int width, const csc_coeff_t *c)
+{
+    for (; x < width; x += 2) {
+        const uint8_t *a = src0 + x * 4;
+        const uint8_t *b = src1 + x * 4;
+        int r = (a[PIX_R] + a[4 + PIX_R] + b[PIX_R] + b[4 + PIX_R] + 2) >> 2;
+        int g = (a[PIX_G] + a[4 + PIX_G] + b[PIX_G] + b[4 + PIX_G] + 2) >> 2;
+        int bl = (a[PIX_B] + a[4 + PIX_B] + b[PIX_B] + b[4 + PIX_B] + 2) >> 2;
+
+        dst_uv[x] = csc_u(c, r, g, bl);
+        dst_uv[x + 1] = csc_v(c, r, g, bl);
+    }
+}
+
+/**
+ * 标量实现：两行YUYV得到两行Y和一行NV12色度，从x开始
+ */
+static void yuyv_420_rows_scalar(uint8_t *y0, uint8_t *y1, uint8_t *dst_uv,
+                                 const uint8_t *src0, const uint8_t *src1,
+                                 int x, int width)
+{
+    for (; x < width; x += 2) {
+        const uint8_t *a = src0 + x * 2;
+        const uint8_t *b = src1 + x * 2;
+
+        y0[x] = a[0];
+        y0[x + 1] = a[2];
+        y1[x] = b[0];
+        y1[x + 1] = b[2];
+        dst_uv[x] = (uint8_t)((a[1] + b[1] + 1) >> 1);
+        dst_uv[x + 1] = (uint8_t)((a[3] + b[3] + 1) >> 1);
+    }
+}
+
+/**
+ * 标量实现：两行RGBA合并为一行，从输出像素x开始
+ */
+static void bin_rgba_row_scalar(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                                int x, int width)
+{
+    for (; x < width; x++) {
+        const uint8_t *a = src0 + x * 8;
+        const uint8_t *b = src1 + x * 8;
+
+        for (int ch = 0; ch < 4; ch++) {
+            dst[x * 4 + ch] = (uint8_t)((a[ch] + a[ch + 4] + b[ch] + b[ch + 4] + 2) >> 2);
+        }
+    }
+}
+
+/**
+ * 标量实现：两行YUYV合并为一行，从输出像素x开始（每次一个输出宏像素）
+ */
+static void bin_yuyv_row_scalar(uint8_t *dst, const uint8_t *src0, const uint8_t *src1,
+                                int x, int width)
+{
+    for (; x < width; x += 2) {
+        /* 输出宏像素对应源中的两个宏像素（8字节） */
+        const uint8_t *a = src0 + x * 4;
+        const uint8_t *b = src1 + x * 4;
+        uint8_t *d = dst + x * 2;
+
+        d[0] = (uint8_t)((a[0] + a[2] + b[0] + b[2] + 2) >> 2);
+        d[1] = (uint8_t)((a[1] + a[5] + b[1] + b[5] + 2) >> 2);
+        d[2] = (uint8_t)((a[4] + a[6] + b[4] + b[6] + 2) >> 2);
+        d[3] = (uint8_t)((a[3] + a[7] + b[3] + b[7] + 2) >> 2);
+    }
+}
+
+/**
+ * 标量实现：两行Y16合并为一行，从输出像素x开始
+ */
+static void bin_y16_row_scalar(uint16_t *dst, const uint16_t *src0, const uint16_t *src1,
+                               int x, int width)
+{
+    for (; x < width; x++) {
+        uint32_t sum = (uint32_t)src0[2 * x] + src0[2 * x + 1] + src1[2 * x] + src1[2 * x + 1];
+        dst[x] = (uint16_t)((sum + 2) >> 2);
+    }
+}
+
+#if defined(__ARM_NEON)
+/**
+ * NEON：16个像素的亮度
+ */
+static inline uint8x16_t neon_luma(uint8x16_t r, uint8x16_t g, uint8x16_t b,
+                                   const csc_coeff_t *c)
+{
+    uint16x8_t lo = vmull_u8(vget_low_u8(r), vdup_n_u8(c->yr));
+    uint16x8_t hi = vmull_u8(vget_high_u8(r), vdup_n_u8(c->yr));
+    lo = vmlal_u8(lo, vget_low_u8(g), vdup_n_u8(c->yg));
+    hi = vmlal_u8(hi, vget_high_u8(g), vdup_n_u8(c->yg));
+    lo = vmlal_u8(lo, vget_low_u8(b), vdup_n_u8(c->yb));
+    hi = vmlal_u8(hi, vget_high_u8(b), vdup_n_u8(c->yb));
+
+    /* 系数和不超过256，结果不超过219，加16不会溢出 */
+    uint8x16_t y = vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8));
+    return vaddq_u8(y, vdupq_n_u8(16));
+}
+
+/**
+ * NEON：8组平均后的RGB（0-255，16位）计算U和V
+ */
+static inline void neon_chroma(int16x8_t r, int16x8_t g, int16x8_t b,
+                               const csc_coeff_t *c, uint8x8_t *u, uint8x8_t *v)
+{
+    /* 系数绝对值之和不超过224，乘以255后在int16范围内 */
+    int16x8_t tu = vmulq_n_s16(b, c->ub);
+    tu = vmlsq_n_s16(tu, r, c->ur);
+    tu = vmlsq_n_s16(tu, g, c->ug);
+
+    int16x8_t tv = vmulq_n_s16(r, c->vr);
+    tv = vmlsq_n_s16(tv, g, c->vg);
+    tv = vmlsq_n_s16(tv, b, c->vb);
+
+    tu = vaddq_s16(vrshrq_n_s16(tu, 8), vdupq_n_s16(128));
+    tv = vaddq_s16(vrshrq_n_s16(tv, 8), vdupq_n_s16(128));
+
+    *u = vqmovun_s16(tu);
+    *v = vqmovun_s16(tv);
+}
+
+/**
+ * NEON：转换一行为YUYV，返回已处理的像素数
+ */
+static int yuyv_row_neon(uint8_t *dst, const uint8_t *src, int width, const csc_coeff_t *c)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(src + x * 4);
+        uint8x16_t r = px.val[PIX_R];
+        uint8x16_t g = px.val[PIX_G];
+        uint8x16_t b = px.val[PIX_B];
+
+        uint8x16_t y = neon_luma(r, g, b, c);
+        uint8x16x2_t y_eo = vuzpq_u8(y, y);
+
+        /* 相邻两个像素求平均作为色度采样点 */
+        int16x8_t ra = vreinterpretq_s16_u16(vrshrq_n_u16(vpaddlq_u8(r), 1));
+        int16x8_t ga = vreinterpretq_s16_u16(vrshrq_n_u16(vpaddlq_u8(g), 1));
+        int16x8_t ba = vreinterpretq_s16_u16(vrshrq_n_u16(vpaddlq_u8(b), 1));
+
+        uint8x8x4_t out;
+        neon_chroma(ra, ga, ba, c, &out.val[1], &out.val[3]);
+        out.val[0] = vget_low_u8(y_eo.val[0]);
+        out.val[2] = vget_low_u8(y_eo.val[1]);
+
+        vst4_u8(dst + x * 2, out);
+    }
+
+    return x;
+}
+
+/**
+ * NEON：转换一行亮度，返回已处理的像素数
+ */
+static int luma_row_neon(uint8_t *dst, const uint8_t *src, int width, const csc_coeff_t *c)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(src + x * 4);
+        vst1q_u8(dst + x, neon_luma(px.val[PIX_R], px.val[PIX_G], px.val[PIX_B], c));
+    }
+
+    return x;
+}
+
+/**
+ * NEON：两行2x2平均得到一行NV12色度，返回已处理的像素数
+ */
+static int chroma_420_row_neon(uint8_t *dst_uv, const uint8_t *src0, const uint8_t *src1,
+                               int width, const csc_coeff_t *c)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t a = vld4q_u8(src0 + x * 4);
+        uint8x16x4_t b = vld4q_u8(src1 + x * 4);
+
+        /* 上下两行各自两两相加，再相加后除以4 */
+        uint16x8_t rs = vpadalq_u8(vpaddlq_u8(a.val[PIX_R]), b.val[PIX_R]);
+        uint16x8_t gs = vpadalq_u8(vpaddlq_u8(a.val[PIX_G]), b.val[PIX_G]);
+        uint16x8_t bs = vpadalq_u8(vpaddlq_u8(a.val[PIX_B]), b.val[PIX_B]);
+
+        uint8x8x2_t uv;
+        neon_chroma(vreinterpretq_s16_u16(vrshrq_n_u16(rs, 2)),
+                    vreinterpretq_s16_u16(vrshrq_n_u16(gs, 2)),
+                    vreinterpretq_s16_u16(vrshrq_n_u16(bs, 2)),
+                    c, &uv.val[0], &uv.val[1]);
+
+        vst2_u8(dst_uv + x, uv);
+    }
+
+    return x;
+}
+/**
+ * NEON：两行YUYV得到两行Y和一行NV12色度，返回已处理的像素数
+ */
+static int yuyv_420_rows_neon(uint8_t *y0, uint8_t *y1, uint8_t *dst_uv,
+                              const uint8_t *src0, const uint8_t *src1, int width)
+{
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        /* 每次32个像素：val[0]=Y偶 val[1]=U val[2]=Y奇 val[3]=V */
+        uint8x16x4_t a = vld4q_u8(src0 + x * 2);
+        uint8x16x4_t b = vld4q_u8(src1 + x * 2);
+
+        uint8x16x2_t ya = { { a.val[0], a.val[2] } };
+        uint8x16x2_t yb = { { b.val[0], b.val[2] } };
+        vst2q_u8(y0 + x, ya);
+        vst2q_u8(y1 + x, yb);
+
+        uint8x16x2_t uv = { { vrhaddq_u8(a.val[1], b.val[1]),
+                              vrhaddq_u8(a.val[3], b.val[3]) } };
+        vst2q_u8(dst_uv + x, uv);
+    }
+
+    return x;
+}
+
+/**
+ * NEON：两行RGBA合并为一行，返回已处理的输出像素数
+ */
+static int bin_rgba_row_neon(uint8_t *dst, const uint8_t *src0, const uint8_t *src1, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        /* 每次16个源像素，按通道分离后相邻两个像素两两相加 */
+        uint8x16x4_t a = vld4q_u8(src0 + x * 8);
+        uint8x16x4_t b = vld4q_u8(src1 + x * 8);
+        uint8x8x4_t out;
+
+        for (int ch = 0; ch < 4; ch++) {
+            uint16x8_t sum = vpadalq_u8(vpaddlq_u8(a.val[ch]), b.val[ch]);
+            out.val[ch] = vrshrn_n_u16(sum, 2);
+        }
+        vst4_u8(dst + x * 4, out);
+    }
+
+    return x;
+}
+
+/**
+ * NEON：两行YUYV合并为一行，返回已处理的输出像素数
+ */
+static int bin_yuyv_row_neon(uint8_t *dst, const uint8_t *src0, const uint8_t *src1, int width)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        /* 每次32个源像素：val[0]=Y偶 val[1]=U val[2]=Y奇 val[3]=V */
+        uint8x16x4_t a = vld4q_u8(src0 + x * 4);
+        uint8x16x4_t b = vld4q_u8(src1 + x * 4);
+
+        /* 每个源宏像素的两个Y合并为一个输出Y，共16个 */
+        uint16x8_t y_lo = vaddq_u16(vaddl_u8(vget_low_u8(a.val[0]), vget_low_u8(a.val[2])),
+                                    vaddl_u8(vget_low_u8(b.val[0]), vget_low_u8(b.val[2])));
+        uint16x8_t y_hi = vaddq_u16(vaddl_u8(vget_high_u8(a.val[0]), vget_high_u8(a.val[2])),
+                                    vaddl_u8(vget_high_u8(b.val[0]), vget_high_u8(b.val[2])));
+        uint8x8x2_t y = vuzp_u8(vrshrn_n_u16(y_lo, 2), vrshrn_n_u16(y_hi, 2));
+
+        /* 相邻两个源宏像素的色度合并为一个输出宏像素的色度 */
+        uint8x8_t u = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[1]), b.val[1]), 2);
+        uint8x8_t v = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[3]), b.val[3]), 2);
+
+        uint8x8x4_t out = { { y.val[0], u, y.val[1], v } };
+        vst4_u8(dst + x * 2, out);
+    }
+
+    return x;
+}
+
+/**
+ * NEON：两行Y16合并为一行，返回已处理的输出像素数
+ */
+static int bin_y16_row_neon(uint16_t *dst, const uint16_t *src0, const uint16_t *src1, int width)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        /* 每次16个源样本，相邻两个两两相加扩展到32位，避免溢出 */
+        uint32x4_t lo = vpadalq_u16(vpaddlq_u16(vld1q_u16(src0 + 2 * x)), vld1q_u16(src1 + 2 * x));
+        uint32x4_t hi = vpadalq_u16(vpaddlq_u16(vld1q_u16(src0 + 2 * x + 8)),
+                                    vld1q_u16(src1 + 2 * x + 8));
+
+        vst1q_u16(dst + x, vcombine_u16(vrshrn_n_u32(lo, 2), vrshrn_n_u32(hi, 2)));
+    }
+
+    return x;
+}
+#endif /* __ARM_NEON */
+
+/**
+ * RGBA转换为YUYV
+ */
+void convert_rgba_to_yuyv(uint8_t *dst, const uint8_t *src,
+                          int width, int height, int src_stride,
+                          csc_standard_t standard)
+{
+    const csc_coeff_t *c = &csc_coeffs[standard];
+
+    for (int row = 0; row < height; row++) {
+        const uint8_t *s = src + (size_t)row * src_stride;
+        uint8_t *d = dst + (size_t)row * width * 2;
+        int x = 0;
+#if defined(__ARM_NEON)
+        x = yuyv_row_neon(d, s, width, c);
+#endif
+        yuyv_row_scalar(d, s, x, width, c);
+    }
+}
+
+/**
+ * RGBA转换为NV12
+ */
+void convert_rgba_to_nv12(uint8_t *dst_y, uint8_t *dst_uv, const uint8_t *src,
+                          int width, int height, int src_stride,
+                          csc_standard_t standard)
+{
+    const csc_coeff_t *c = &csc_coeffs[standard];
+
+    for (int row = 0; row < height; row += 2) {
+        const uint8_t *s0 = src + (size_t)row * src_stride;
+        const uint8_t *s1 = s0 + src_stride;
+        uint8_t *y0 = dst_y + (size_t)row * width;
+        uint8_t *y1 = y0 + width;
+        uint8_t *uv = dst_uv + (size_t)(row / 2) * width;
+        int x0 = 0, x1 = 0, xc = 0;
+#if defined(__ARM_NEON)
+        x0 = luma_row_neon(y0, s0, width, c);
+        x1 = luma_row_neon(y1, s1, width, c);
+        xc = chroma_420_row_neon(uv, s0, s1, width, c);
+#endif
+        luma_row_scalar(y0, s0, x0, width, c);
+        luma_row_scalar(y1, s1, x1, width, c);
+        chroma_420_row_scalar(uv, s0, s1, xc, width, c);
+    }
+}
+
+/**
+ * YUYV转换为NV12
+ */
+void convert_yuyv_to_nv12(uint8_t *dst_y, uint8_t *dst_uv, const uint8_t *src,
+                          int width, int height, int src_stride)
+{
+    for (int row = 0; row < height; row += 2) {
+        const uint8_t *s0 = src + (size_t)row * src_stride;
+        const uint8_t *s1 = s0 + src_stride;
+        uint8_t *y0 = dst_y + (size_t)row * width;
+        uint8_t *y1 = y0 + width;
+        uint8_t *uv = dst_uv + (size_t)(row / 2) * width;
+        int x = 0;
+#if defined(__ARM_NEON)
+        x = yuyv_420_rows_neon(y0, y1, uv, s0, s1, width);
+#endif
+        yuyv_420_rows_scalar(y0, y1, uv, s0, s1, x, width);
+    }
+}
+
+/**
+ * 按行拷贝（ROI裁剪）
+ */
+void convert_copy_rows(uint8_t *dst, const uint8_t *src, int row_bytes, int height,
+                       int src_stride)
+{
+    if (row_bytes == src_stride) {
+        memcpy(dst, src, (size_t)row_bytes * height);
+        return;
+    }
+
+    for (int row = 0; row < height; row++) {
+        memcpy(dst + (size_t)row * row_bytes, src + (size_t)row * src_stride, row_bytes);
+    }
+}
+
+/**
+ * RGBA 2x2像素合并
+ */
+void convert_bin2x2_rgba(uint8_t *dst, const uint8_t *src, int width, int height,
+                         int src_stride)
+{
+    for (int row = 0; row < height; row++) {
+        const uint8_t *s0 = src + (size_t)row * 2 * src_stride;
+        const uint8_t *s1 = s0 + src_stride;
+        uint8_t *d = dst + (size_t)row * width * 4;
+        int x = 0;
+#if defined(__ARM_NEON)
+        x = bin_rgba_row_neon(d, s0, s1, width);
+#endif
+        bin_rgba_row_scalar(d, s0, s1, x, width);
+    }
+}
+
+/**
+ * YUYV 2x2像素合并
+ */
+void convert_bin2x2_yuyv(uint8_t *dst, const uint8_t *src, int width, int height,
+                         int src_stride)
+{
+    for (int row = 0; row < height; row++) {
+        const uint8_t *s0 = src + (size_t)row * 2 * src_stride;
+        const uint8_t *s1 = s0 + src_stride;
+        uint8_t *d = dst + (size_t)row * width * 2;
+        int x = 0;
+#if defined(__ARM_NEON)
+        x = bin_yuyv_row_neon(d, s0, s1, width);
+#endif
+        bin_yuyv_row_scalar(d, s0, s1, x, width);
+    }
+}
+
+/**
+ * Y16 2x2像素合并
+ */
+void convert_bin2x2_y16(uint8_t *dst, const uint8_t *src, int width, int height,
+                        int src_stride)
+{
+    for (int row = 0; row < height; row++) {
+        const uint16_t *s0 = (const uint16_t *)(src + (size_t)row * 2 * src_stride);
+        const uint16_t *s1 = (const uint16_t *)((const uint8_t *)s0 + src_stride);
+        uint16_t *d = (uint16_t *)(dst + (size_t)row * width * 2);
+        int x = 0;
+#if defined(__ARM_NEON)
+        x = bin_y16_row_neon(d, s0, s1, width);
+#endif
+        bin_y16_row_scalar(d, s0, s1, x, width);
+    }
+}
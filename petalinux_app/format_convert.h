@@ -0,0 +1,124 @@
+/**
+ * @file format_convert.h
+ * @brief 像素格式转换接口
+ *
+ * 此模块提供发送前的CPU像素格式转换，包括：
+ * - RGBA -> YUYV (YUV 4:2:2 打包)
+ * - RGBA -> NV12 (YUV 4:2:0 半平面)
+ * - YUYV -> NV12（YUV422直通流水线）
+ * - ROI裁剪拷贝、RGBA/YUYV/Y16 2x2像素合并（binning）
+ * - BT.601 / BT.709 色彩矩阵（限幅范围 16-235/16-240）
+ *
+ * RGBA源数据为V4L2_PIX_FMT_ABGR32内存顺序（每像素4字节：B G R A）。
+ * ARM64上使用NEON每次处理16个像素，其他平台使用标量实现。
+ */
+
+#ifndef FORMAT_CONVERT_H
+#define FORMAT_CONVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * 色彩矩阵标准
+ */
+typedef enum {
+    CSC_BT601 = 0,    /* SD标准 */
+    CSC_BT709,        /* HD标准 */
+} csc_standard_t;
+
+/**
+ * RGBA转换为YUYV
+ *
+ * @param dst 目标缓冲（width * height * 2 字节）
+ * @param src 源RGBA帧
+ * @param width 宽度（像素，必须为偶数）
+ * @param height 高度（像素）
+ * @param src_stride 源帧每行字节数
+ * @param standard 色彩矩阵标准
+ */
+void convert_rgba_to_yuyv(uint8_t *dst, const uint8_t *src,
+                          int width, int height, int src_stride,
+                          csc_standard_t standard);
+
+/**
+ * RGBA转换为NV12
+ *
+ * 色度取2x2像素平均。
+ *
+ * @param dst_y 目标Y平面（width * height 字节）
+ * @param dst_uv 目标UV交织平面（width * height / 2 字节）
+ * @param src 源RGBA帧
+ * @param width 宽度（像素，必须为偶数）
+ * @param height 高度（像素，必须为偶数）
+ * @param src_stride 源帧每行字节数
+ * @param standard 色彩矩阵标准
+ */
+void convert_rgba_to_nv12(uint8_t *dst_y, uint8_t *dst_uv, const uint8_t *src,
+                          int width, int height, int src_stride,
+                          csc_standard_t standard);
+
+/**
+ * YUYV转换为NV12
+ *
+ * 色度取上下两行平均。
+ *
+ * @param dst_y 目标Y平面（width * height 字节）
+ * @param dst_uv 目标UV交织平面（width * height / 2 字节）
+ * @param src 源YUYV帧
+ * @param width 宽度（像素，必须为偶数）
+ * @param height 高度（像素，必须为偶数）
+ * @param src_stride 源帧每行字节数
+ */
+void convert_yuyv_to_nv12(uint8_t *dst_y, uint8_t *dst_uv, const uint8_t *src,
+                          int width, int height, int src_stride);
+
+/**
+ * 按行拷贝（ROI裁剪）
+ *
+ * @param dst 目标缓冲（紧凑排列，row_bytes * height 字节）
+ * @param src 源窗口左上角
+ * @param row_bytes 每行拷贝字节数
+ * @param height 行数
+ * @param src_stride 源帧每行字节数
+ */
+void convert_copy_rows(uint8_t *dst, const uint8_t *src, int row_bytes, int height,
+                       int src_stride);
+
+/**
+ * RGBA 2x2像素合并，每个输出像素取2x2块各通道平均
+ *
+ * @param dst 目标缓冲（width * height * 4 字节）
+ * @param src 源窗口左上角（2*width x 2*height 像素）
+ * @param width 输出宽度（像素）
+ * @param height 输出高度（像素）
+ * @param src_stride 源帧每行字节数
+ */
+void convert_bin2x2_rgba(uint8_t *dst, const uint8_t *src, int width, int height,
+                         int src_stride);
+
+/**
+ * YUYV 2x2像素合并，亮度取2x2块平均，色度取相邻两个宏像素上下两行平均
+ *
+ * @param dst 目标缓冲（width * height * 2 字节）
+ * @param src 源窗口左上角（2*width x 2*height 像素）
+ * @param width 输出宽度（像素，必须为偶数）
+ * @param height 输出高度（像素）
+ * @param src_stride 源帧每行字节数
+ */
+void convert_bin2x2_yuyv(uint8_t *dst, const uint8_t *src, int width, int height,
+                         int src_stride);
+
+/**
+ * Y16（16位小端原始数据）2x2像素合并，取4个样本平均，保留16位精度
+ *
+ * @param dst 目标缓冲（width * height * 2 字节）
+ * @param src 源窗口左上角（2*width x 2*height 像素）
+ * @param width 输出宽度（像素）
+ * @param height 输出高度（像素）
+ * @param src_stride 源帧每行字节数
+ */
+void convert_bin2x2_y16(uint8_t *dst, const uint8_t *src, int width, int height,
+                        int src_stride);
+
+#endif /* FORMAT_CONVERT_H */
@@ -0,0 +1,132 @@
+/**
+ * @file frame_diff.c
+ * @brief 静止画面检测实现
+ */
+
+#include "frame_diff.h"
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__ARM_NEON)
+/**
+ * NEON：8位样本求和，返回已处理的字节数
+ */
+static int sum_u8_neon(const uint8_t *src, int bytes, uint32_t *sum)
+{
+    uint16x8_t acc = vdupq_n_u16(0);
+    int x = 0;
+
+    /* 每次16字节，每个16位累加器最多累加FRAME_DIFF_SAMPLE_BYTES/8个样本，不会溢出 */
+    for (; x + 16 <= bytes; x += 16) {
+        acc = vpadalq_u8(acc, vld1q_u8(src + x));
+    }
+
+    uint64x2_t total = vpaddlq_u32(vpaddlq_u16(acc));
+    *sum += (uint32_t)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+    return x;
+}
+
+/**
+ * NEON：16位样本求和，返回已处理的字节数
+ */
+static int sum_u16_neon(const uint8_t *src, int bytes, uint32_t *sum)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    int x = 0;
+
+    for (; x + 16 <= bytes; x += 16) {
+        acc = vpadalq_u16(acc, vld1q_u16((const uint16_t *)(src + x)));
+    }
+
+    uint64x2_t total = vpaddlq_u32(acc);
+    *sum += (uint32_t)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+    return x;
+}
+#endif /* __ARM_NEON */
+
+/**
+ * 一段连续样本求和
+ */
+static uint32_t sum_span(const uint8_t *src, int bytes, int sample_size)
+{
+    uint32_t sum = 0;
+    int x = 0;
+
+#if defined(__ARM_NEON)
+    x = sample_size == 2 ? sum_u16_neon(src, bytes, &sum) : sum_u8_neon(src, bytes, &sum);
+#endif
+    if (sample_size == 2) {
+        for (; x + 2 <= bytes; x += 2) {
+            sum += src[x] | (src[x + 1] << 8);
+        }
+    } else {
+        for (; x < bytes; x++) {
+            sum += src[x];
+        }
+    }
+
+    return sum;
+}
+
+/**
+ * 初始化检测状态
+ */
+void frame_diff_init(frame_diff_t *diff, int sample_size, int threshold)
+{
+    memset(diff, 0, sizeof(frame_diff_t));
+    diff->sample_size = sample_size == 2 ? 2 : 1;
+    diff->threshold = threshold;
+}
+
+/**
+ * 计算一帧的块签名并与上一次发送的帧比较
+ */
+int frame_diff_check(frame_diff_t *diff, const uint8_t *frame, int row_bytes, int height, int stride)
+{
+    int block_bytes = row_bytes / FRAME_DIFF_BLOCKS_X;
+    int block_rows = height / FRAME_DIFF_BLOCKS_Y;
+    int span = block_bytes < FRAME_DIFF_SAMPLE_BYTES ? block_bytes : FRAME_DIFF_SAMPLE_BYTES;
+    int changed = !diff->valid;
+
+    /* 块起点和采样长度按样本对齐 */
+    block_bytes -= block_bytes % diff->sample_size;
+    span -= span % diff->sample_size;
+    diff->samples = (uint32_t)(span / diff->sample_size) * FRAME_DIFF_SAMPLE_ROWS;
+
+    uint32_t limit = (uint32_t)diff->threshold * diff->samples;
+
+    for (int by = 0; by < FRAME_DIFF_BLOCKS_Y; by++) {
+        for (int bx = 0; bx < FRAME_DIFF_BLOCKS_X; bx++) {
+            const uint8_t *block = frame + (size_t)by * block_rows * stride + (size_t)bx * block_bytes;
+            uint32_t sum = 0;
+
+            /* 采样行均匀分布在块内 */
+            for (int r = 0; r < FRAME_DIFF_SAMPLE_ROWS; r++) {
+                int row = (2 * r + 1) * block_rows / (2 * FRAME_DIFF_SAMPLE_ROWS);
+                sum += sum_span(block + (size_t)row * stride, span, diff->sample_size);
+            }
+
+            int index = by * FRAME_DIFF_BLOCKS_X + bx;
+            uint32_t ref = diff->reference[index];
+            uint32_t delta = sum > ref ? sum - ref : ref - sum;
+            if (delta > limit) {
+                changed = 1;
+            }
+            diff->current[index] = sum;
+        }
+    }
+
+    return changed;
+}
+
+/**
+ * 把最近一次检测的帧设为参考帧
+ */
+void frame_diff_accept(frame_diff_t *diff)
+{
+    memcpy(diff->reference, diff->current, sizeof(diff->reference));
+    diff->valid = 1;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file frame_pacer.c
+ * @brief 跟随传感器帧节拍的发送节流实现
+ */
+
+#include "frame_pacer.h"
+#include <string.h>
+
+/* 周期估计的低通滤波系数：每帧修正偏差的1/16 */
+#define PACER_FILTER_SHIFT  4
+
+/* 连续这么多帧偏离估计值一倍以上时认为传感器帧率变了，重新估计 */
+#define PACER_MAX_OUTLIERS  8
+
+/**
+ * 初始化节流状态
+ */
+void frame_pacer_init(frame_pacer_t *pacer, uint64_t interval_ns)
+{
+    memset(pacer, 0, sizeof(frame_pacer_t));
+    pacer->interval_ns = interval_ns;
+}
+
+/**
+ * 用相邻两帧的完成时间更新传感器帧周期估计
+ */
+static void frame_pacer_update_period(frame_pacer_t *pacer, uint64_t done_ns, uint32_t sequence)
+{
+    uint32_t frames = sequence - pacer->last_seq;
+
+    /* 序号回退（VDMA重新初始化）或同一帧：重新开始估计 */
+    if (pacer->last_done_ns == 0 || frames == 0 || frames > 0x7FFFFFFF ||
+        done_ns <= pacer->last_done_ns) {
+        return;
+    }
+
+    uint64_t period = (done_ns - pacer->last_done_ns) / frames;
+
+    if (pacer->period_ns == 0) {
+        pacer->period_ns = period;
+        return;
+    }
+
+    if (period > pacer->period_ns * 2 || period < pacer->period_ns / 2) {
+        if (++pacer->outliers >= PACER_MAX_OUTLIERS) {
+            pacer->period_ns = period;
+            pacer->outliers = 0;
+        }
+        return;
+    }
+    pacer->outliers = 0;
+
+    int64_t error = (int64_t)period - (int64_t)pacer->period_ns;
+    pacer->period_ns += error / (1 << PACER_FILTER_SHIFT);
+}
+
+/**
+ * 判断一帧是否发送
+ */
+int frame_pacer_accept(frame_pacer_t *pacer, uint64_t done_ns, uint32_t sequence)
+{
+    frame_pacer_update_period(pacer, done_ns, sequence);
+    pacer->last_done_ns = done_ns;
+    pacer->last_seq = sequence;
+
+    /* 截止时间前后半个传感器周期内算准时；还没有周期估计时用1/4个输出间隔 */
+    uint64_t tolerance = pacer->period_ns ? pacer->period_ns / 2 : pacer->interval_ns / 4;
+
+    /* 首帧，或落后超过一个输出间隔（长时间没有帧）：从这一帧重新对齐 */
+    if (pacer->next_ns == 0 || done_ns > pacer->next_ns + pacer->interval_ns) {
+        pacer->next_ns = done_ns + pacer->interval_ns;
+        return 1;
+    }
+
+    if (done_ns + tolerance < pacer->next_ns) {
+        return 0;
+    }
+
+    /* 截止时间按输出间隔前进，不跟随这一帧的抖动 */
+    pacer->next_ns += pacer->interval_ns;
+    return 1;
+}
+
+/**
+ * 估计的传感器帧率
+ */
+double frame_pacer_sensor_fps(const frame_pacer_t *pacer)
+{
+    return pacer->period_ns ? 1e9 / pacer->period_ns : 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file frame_pacer.h
+ * @brief 跟随传感器帧节拍的发送节流
+ *
+ * 发送与否只看帧的VDMA完成时间（CLOCK_MONOTONIC），不看帧到达发送线程的时刻，
+ * 所以节拍锁定在传感器时钟上，不受发送线程调度和格式转换时间的影响：
+ * - 输出截止时间是帧完成时间轴上的绝对时刻，每发送一帧前进一个输出间隔，
+ *   不会像相对计时那样累积误差
+ * - 按帧序号间隔估计传感器帧周期（一阶低通滤波，跳过漏帧），截止时间前后
+ *   半个传感器周期内的帧都算准时，60 fps→30 fps固定每隔一帧发送一帧，
+ *   非整数比（如60→25）时发送间隔在2帧和3帧之间交替
+ * - 传感器帧率低于输出帧率时每帧都发送
+ */
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdint.h>
+
+/**
+ * 节流状态
+ */
+typedef struct {
+    uint64_t interval_ns;     /* 输出帧间隔 */
+    uint64_t period_ns;       /* 估计的传感器帧周期，0表示还没有估计 */
+    uint64_t next_ns;         /* 下一帧的发送截止时间（帧完成时间轴），0表示还没有发送过 */
+    uint64_t last_done_ns;    /* 上一帧的完成时间 */
+    uint32_t last_seq;        /* 上一帧的序号 */
+    int outliers;             /* 连续偏离估计周期的帧数 */
+} frame_pacer_t;
+
+/**
+ * 初始化节流状态
+ *
+ * @param pacer 节流状态
+ * @param interval_ns 输出帧间隔（纳秒）
+ */
+void frame_pacer_init(frame_pacer_t *pacer, uint64_t interval_ns);
+
+/**
+ * 判断一帧是否发送
+ *
+ * 每个到达发送线程的帧都要调用（包括最终跳过的帧），用于估计传感器帧周期。
+ *
+ * @param pacer 节流状态
+ * @param done_ns 帧完成时间（CLOCK_MONOTONIC，纳秒）
+ * @param sequence 帧序号（漏掉的帧也占序号）
+ * @return 1发送，0跳过
+ */
+int frame_pacer_accept(frame_pacer_t *pacer, uint64_t done_ns, uint32_t sequence);
+
+/**
+ * 估计的传感器帧率
+ *
+ * @param pacer 节流状态
+ * @return 帧率，还没有估计时返回0
+ */
+double frame_pacer_sensor_fps(const frame_pacer_t *pacer);
+
+#endif /* FRAME_PACER_H */
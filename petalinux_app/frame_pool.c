@@ -0,0 +1,138 @@
+/**
+ * @file frame_pool.c
+ * @brief 中间帧缓冲池实现
+ */
+
+#define _GNU_SOURCE     /* MAP_HUGETLB / MADV_HUGEPAGE */
+#include "frame_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/**
+ * 向上取整到align的倍数
+ */
+static size_t align_up(size_t size, size_t align)
+{
+    return (size + align - 1) / align * align;
+}
+
+/**
+ * 映射缓冲区域：优先预留大页，失败时按大页对齐的普通映射
+ */
+static int frame_pool_map(frame_pool_t *pool, size_t size)
+{
+#ifdef MAP_HUGETLB
+    pool->map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (pool->map != MAP_FAILED) {
+        pool->map_size = size;
+        pool->base = pool->map;
+        pool->hugetlb = 1;
+        return 0;
+    }
+#endif
+
+    /* 多映射一个大页，从中取对齐的部分，透明大页才能覆盖整个区域 */
+    pool->map = mmap(NULL, size + FRAME_POOL_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pool->map == MAP_FAILED) {
+        perror("映射中间缓冲池失败");
+        pool->map = NULL;
+        return -1;
+    }
+    pool->map_size = size + FRAME_POOL_HUGEPAGE_SIZE;
+    pool->base = (uint8_t*)align_up((size_t)pool->map, FRAME_POOL_HUGEPAGE_SIZE);
+    pool->hugetlb = 0;
+
+#ifdef MADV_HUGEPAGE
+    /* 内核没有开启透明大页时忽略 */
+    madvise(pool->base, size, MADV_HUGEPAGE);
+#endif
+    return 0;
+}
+
+/**
+ * 确保缓冲池至少有num_slots个不小于slot_size的槽位
+ */
+int frame_pool_reserve(frame_pool_t *pool, size_t slot_size, int num_slots)
+{
+    if (num_slots < 1 || num_slots > FRAME_POOL_MAX_SLOTS) {
+        fprintf(stderr, "中间缓冲池槽位数%d超出范围（1~%d）\n", num_slots, FRAME_POOL_MAX_SLOTS);
+        return -1;
+    }
+
+    slot_size = align_up(slot_size, FRAME_POOL_SLOT_ALIGN);
+    if (pool->map && slot_size <= pool->slot_size && num_slots <= pool->num_slots) {
+        return 0;
+    }
+
+    frame_pool_cleanup(pool);
+
+    size_t size = align_up(slot_size * num_slots, FRAME_POOL_HUGEPAGE_SIZE);
+    if (frame_pool_map(pool, size) < 0) {
+        return -1;
+    }
+
+    /* 区域取整后多出的部分也分给槽位 */
+    pool->num_slots = num_slots;
+    pool->slot_size = size / num_slots / FRAME_POOL_SLOT_ALIGN * FRAME_POOL_SLOT_ALIGN;
+
+    /* 预先触发缺页，取流时不再分配物理页 */
+    memset(pool->base, 0, size);
+
+    printf("中间缓冲池: %d x %zu 字节（%s）\n", pool->num_slots, pool->slot_size,
+           pool->hugetlb ? "预留大页" : "透明大页/普通页");
+    return 0;
+}
+
+/**
+ * 取用一个空闲槽位
+ */
+int frame_pool_acquire(frame_pool_t *pool)
+{
+    for (int i = 0; i < pool->num_slots; i++) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&pool->refcnt[i], &expected, 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * 增加槽位的持有计数
+ */
+void frame_pool_ref(frame_pool_t *pool, int slot)
+{
+    __atomic_fetch_add(&pool->refcnt[slot], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * 减少槽位的持有计数
+ */
+void frame_pool_release(frame_pool_t *pool, int slot)
+{
+    __atomic_fetch_sub(&pool->refcnt[slot], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 槽位数据地址
+ */
+uint8_t *frame_pool_data(frame_pool_t *pool, int slot)
+{
+    return pool->base + (size_t)slot * pool->slot_size;
+}
+
+/**
+ * 释放缓冲池
+ */
+void frame_pool_cleanup(frame_pool_t *pool)
+{
+    if (pool->map) {
+        munmap(pool->map, pool->map_size);
+    }
+    memset(pool, 0, sizeof(frame_pool_t));
+}
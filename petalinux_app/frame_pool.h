@@ -0,0 +1,98 @@
+/**
+ * @file frame_pool.h
+ * @brief 中间帧缓冲池
+ *
+ * CPU处理阶段（合并、write方式的格式转换输出等）使用的中间缓冲从一块预分配的
+ * 内存区域中按固定大小的槽位取用，取流期间不调用malloc：
+ * - 区域优先使用2 MB大页（MAP_HUGETLB，需要预留vm.nr_hugepages），
+ *   没有预留大页时退化为按2 MB对齐的普通映射并建议内核使用透明大页，
+ *   1.2 MB以上的帧只占用一两个TLB项，逐行访问不会反复缺失TLB
+ * - 映射后立即写一遍，第一帧不会因为缺页而变慢
+ * - 槽位有持有计数（原子访问），可以在不同线程中取用和归还
+ *
+ * VDMA帧缓冲来自设备树保留区域或u-dma-buf（物理连续，DMA可访问），
+ * 本身就是带持有计数的固定槽位（见vdma_control.h），不放在这个池中。
+ */
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 最多槽位数 */
+#define FRAME_POOL_MAX_SLOTS   8
+
+/* 大页大小，区域按它对齐和取整 */
+#define FRAME_POOL_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/* 槽位按4 KB对齐，行起点保持Cache行和NEON访问对齐 */
+#define FRAME_POOL_SLOT_ALIGN  4096
+
+/**
+ * 缓冲池
+ */
+typedef struct {
+    void *map;                               /* 映射起始地址（munmap用），NULL表示未分配 */
+    size_t map_size;                         /* 映射大小 */
+    uint8_t *base;                           /* 第一个槽位（按大页对齐） */
+    size_t slot_size;                        /* 每个槽位的字节数（已对齐） */
+    int num_slots;                           /* 槽位数 */
+    int hugetlb;                             /* 是否为预留大页（MAP_HUGETLB） */
+    int refcnt[FRAME_POOL_MAX_SLOTS];        /* 持有计数（原子访问），0表示空闲 */
+} frame_pool_t;
+
+/**
+ * 确保缓冲池至少有num_slots个不小于slot_size的槽位
+ *
+ * 已有的区域足够大时直接沿用（分辨率、格式不变时重新取流不再映射），
+ * 否则释放后重新分配。调用时不能有被持有的槽位。
+ *
+ * @param pool 缓冲池（第一次调用前清零）
+ * @param slot_size 每个槽位的最小字节数
+ * @param num_slots 槽位数（1 ~ FRAME_POOL_MAX_SLOTS）
+ * @return 0成功，-1失败
+ */
+int frame_pool_reserve(frame_pool_t *pool, size_t slot_size, int num_slots);
+
+/**
+ * 取用一个空闲槽位（持有计数置1）
+ *
+ * @param pool 缓冲池
+ * @return 槽位编号，没有空闲槽位返回-1
+ */
+int frame_pool_acquire(frame_pool_t *pool);
+
+/**
+ * 增加槽位的持有计数（把缓冲交给下一个处理阶段）
+ *
+ * @param pool 缓冲池
+ * @param slot 槽位编号
+ */
+void frame_pool_ref(frame_pool_t *pool, int slot);
+
+/**
+ * 减少槽位的持有计数，减到0时槽位空闲
+ *
+ * @param pool 缓冲池
+ * @param slot 槽位编号
+ */
+void frame_pool_release(frame_pool_t *pool, int slot);
+
+/**
+ * 槽位数据地址
+ *
+ * @param pool 缓冲池
+ * @param slot 槽位编号
+ * @return 数据地址
+ */
+uint8_t *frame_pool_data(frame_pool_t *pool, int slot);
+
+/**
+ * 释放缓冲池
+ *
+ * @param pool 缓冲池
+ */
+void frame_pool_cleanup(frame_pool_t *pool);
+
+#endif /* FRAME_POOL_H */
@@ -0,0 +1,72 @@
+/**
+ * @file frame_ring.c
+ * @brief 采集线程到发送线程的无锁帧编号队列实现
+ */
+
+#include "frame_ring.h"
+#include <string.h>
+
+#define FRAME_RING_MASK   (FRAME_RING_SLOTS - 1)
+
+/**
+ * 初始化队列
+ */
+void frame_ring_init(frame_ring_t *ring, int capacity)
+{
+    memset(ring, 0, sizeof(frame_ring_t));
+
+    if (capacity < 1) capacity = 1;
+    if (capacity > FRAME_RING_SLOTS) capacity = FRAME_RING_SLOTS;
+    ring->capacity = capacity;
+}
+
+/**
+ * 入队一帧
+ */
+int frame_ring_push(frame_ring_t *ring, int frame)
+{
+    uint32_t head = ring->head;
+    int evicted = -1;
+
+    for (;;) {
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - tail < ring->capacity) {
+            break;
+        }
+
+        /* 队列满：和消费者竞争最旧的一项，CAS成功才拥有它 */
+        int oldest = __atomic_load_n(&ring->slots[tail & FRAME_RING_MASK], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            evicted = oldest;
+            ring->evicted++;
+            break;
+        }
+    }
+
+    /* head - tail < capacity <= 槽位数，写入的槽位不会是还在排队的项 */
+    __atomic_store_n(&ring->slots[head & FRAME_RING_MASK], frame, __ATOMIC_RELAXED);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return evicted;
+}
+
+/**
+ * 出队最旧的一帧
+ */
+int frame_ring_pop(frame_ring_t *ring)
+{
+    for (;;) {
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (tail == head) {
+            return -1;
+        }
+
+        int frame = __atomic_load_n(&ring->slots[tail & FRAME_RING_MASK], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return frame;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file frame_ring.h
+ * @brief 采集线程到发送线程的无锁帧编号队列
+ *
+ * 单生产者/单消费者环形队列，元素是VDMA帧编号：
+ * - 生产者（采集线程）push永不阻塞，队列满时挤掉最旧的一项并交还给调用者释放，
+ *   保证消费者拿到的总是最新的帧（latest wins）
+ * - 消费者（发送线程）pop取最旧的一项
+ *
+ * head只由生产者修改；tail由消费者出队和生产者挤出两方通过CAS推进，
+ * 谁的CAS成功谁就拥有该项。
+ */
+
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stdint.h>
+
+/* 槽位数（2的幂），实际容量由frame_ring_init()指定 */
+#define FRAME_RING_SLOTS  8
+
+/**
+ * 帧编号队列
+ */
+typedef struct {
+    uint32_t head;                    /* 下一个写入位置（生产者） */
+    uint32_t tail;                    /* 最旧一项的位置（CAS推进） */
+    uint32_t capacity;                /* 最多同时排队的帧数 */
+    int slots[FRAME_RING_SLOTS];      /* 帧编号 */
+    uint32_t evicted;                 /* 队列满被挤掉的帧数 */
+} frame_ring_t;
+
+/**
+ * 初始化队列
+ *
+ * 每个排队的帧都占用一个VDMA帧缓冲，容量应小于帧缓冲数减2
+ * （VDMA写入1帧，发送线程持有1帧）。
+ *
+ * @param ring 队列指针
+ * @param capacity 容量（1 ~ FRAME_RING_SLOTS，越界时钳位）
+ */
+void frame_ring_init(frame_ring_t *ring, int capacity);
+
+/**
+ * 入队一帧（仅生产者调用）
+ *
+ * @param ring 队列指针
+ * @param frame 帧编号
+ * @return 被挤掉的帧编号（调用者负责释放），没有挤掉返回-1
+ */
+int frame_ring_push(frame_ring_t *ring, int frame);
+
+/**
+ * 出队最旧的一帧（仅消费者调用）
+ *
+ * @param ring 队列指针
+ * @return 帧编号，队列为空返回-1
+ */
+int frame_ring_pop(frame_ring_t *ring);
+
+#endif /* FRAME_RING_H */
@@ -0,0 +1,61 @@
+/**
+ * @file frame_stamp.c
+ * @brief 帧内时间戳实现
+ *
+ * 布局（小端）：魔数(4) 序号(4) 时间戳(8) 校验(4)
+ */
+
+#include "frame_stamp.h"
+
+static void put_le32(uint8_t *dst, uint32_t value)
+{
+    dst[0] = value;
+    dst[1] = value >> 8;
+    dst[2] = value >> 16;
+    dst[3] = value >> 24;
+}
+
+static uint32_t get_le32(const uint8_t *src)
+{
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/**
+ * 校验：前16字节的FNV-1a哈希
+ */
+static uint32_t frame_stamp_check(const uint8_t *stamp)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < 16; i++) {
+        hash = (hash ^ stamp[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * 写入帧内时间戳
+ */
+void frame_stamp_write(uint8_t *dst, uint32_t sequence, uint64_t timestamp_ns)
+{
+    put_le32(dst, FRAME_STAMP_MAGIC);
+    put_le32(dst + 4, sequence);
+    put_le32(dst + 8, (uint32_t)timestamp_ns);
+    put_le32(dst + 12, (uint32_t)(timestamp_ns >> 32));
+    put_le32(dst + 16, frame_stamp_check(dst));
+}
+
+/**
+ * 读取帧内时间戳
+ */
+int frame_stamp_read(const uint8_t *src, size_t len, uint32_t *sequence, uint64_t *timestamp_ns)
+{
+    if (len < FRAME_STAMP_SIZE || get_le32(src) != FRAME_STAMP_MAGIC ||
+        get_le32(src + 16) != frame_stamp_check(src)) {
+        return -1;
+    }
+
+    *sequence = get_le32(src + 4);
+    *timestamp_ns = get_le32(src + 8) | ((uint64_t)get_le32(src + 12) << 32);
+    return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file frame_stamp.h
+ * @brief 帧内时间戳：VDMA帧序号和帧完成时间写在发送数据的开头
+ *
+ * UVC Gadget驱动不会把v4l2_buffer的序号传给主机（vb2忽略输出缓冲的sequence，
+ * 负载头没有帧计数），时间戳也只有写PTS/SCR负载头的f_uvc版本才会作为PTS发出，
+ * 并被主机uvcvideo换算为主机时间。需要在主机端逐帧核对设备序号和设备时钟时
+ * （--stamp），把这些信息直接写进帧数据：
+ * - 位于发送数据的前FRAME_STAMP_SIZE字节（第一行左端几个像素，NV12为Y平面）
+ * - 小端，带魔数和校验，主机端（host/uvc_host_bench.c）据此判断帧是否带标记
+ * - 只用于未压缩格式，H.264码流不能插入
+ */
+
+#ifndef FRAME_STAMP_H
+#define FRAME_STAMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FRAME_STAMP_MAGIC  0x504D5453   /* "STMP" */
+#define FRAME_STAMP_SIZE   20
+
+/**
+ * 写入帧内时间戳
+ *
+ * @param dst 帧数据开头（至少FRAME_STAMP_SIZE字节）
+ * @param sequence VDMA帧序号（包括跳过和丢弃的帧）
+ * @param timestamp_ns VDMA帧完成时间（设备CLOCK_MONOTONIC，纳秒）
+ */
+void frame_stamp_write(uint8_t *dst, uint32_t sequence, uint64_t timestamp_ns);
+
+/**
+ * 读取帧内时间戳
+ *
+ * @param src 帧数据开头
+ * @param len 帧数据长度
+ * @param sequence 输出：VDMA帧序号
+ * @param timestamp_ns 输出：VDMA帧完成时间
+ * @return 0成功，-1没有有效的标记
+ */
+int frame_stamp_read(const uint8_t *src, size_t len, uint32_t *sequence, uint64_t *timestamp_ns);
+
+#endif /* FRAME_STAMP_H */
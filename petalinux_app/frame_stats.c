@@ -0,0 +1,281 @@
+/**
+ * @file frame_stats.c
+ * @brief 逐帧延迟统计与共享内存统计页实现
+ */
+
+#include "frame_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <errno.h>
+
+/* 统计页是否映射自共享内存（否则为calloc分配） */
+static int stats_shared = 0;
+
+/* 本进程统计页的共享内存名称 */
+static char stats_shm_name[64];
+
+/**
+ * 采集实例的共享内存名称
+ */
+static void frame_stats_shm_name(int instance, char *name, size_t len)
+{
+    if (instance > 0) {
+        snprintf(name, len, "%s.%d", FRAME_STATS_SHM_NAME, instance);
+    } else {
+        snprintf(name, len, "%s", FRAME_STATS_SHM_NAME);
+    }
+}
+
+/**
+ * 数值对应的桶编号
+ */
+static int frame_stats_bucket(uint64_t us)
+{
+    if (us >= (1ULL << 32)) {
+        us = (1ULL << 32) - 1;
+    }
+
+    if (us < FRAME_STATS_SUB_COUNT) {
+        return (int)us;
+    }
+
+    int msb = 63 - __builtin_clzll(us);
+    int shift = msb - FRAME_STATS_SUB_BITS;
+
+    return (shift + 1) * FRAME_STATS_SUB_COUNT +
+           (int)((us >> shift) & (FRAME_STATS_SUB_COUNT - 1));
+}
+
+/**
+ * 桶的上界（微秒）
+ */
+static uint64_t frame_stats_bucket_upper(int index)
+{
+    if (index < FRAME_STATS_SUB_COUNT) {
+        return index;
+    }
+
+    int shift = index / FRAME_STATS_SUB_COUNT - 1;
+    uint64_t mantissa = FRAME_STATS_SUB_COUNT + index % FRAME_STATS_SUB_COUNT;
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+/**
+ * 创建共享内存统计页
+ */
+frame_stats_t *frame_stats_open(int instance)
+{
+    frame_stats_t *stats = NULL;
+
+    frame_stats_shm_name(instance, stats_shm_name, sizeof(stats_shm_name));
+    int fd = shm_open(stats_shm_name, O_CREAT | O_RDWR, 0644);
+
+    if (fd >= 0) {
+        if (ftruncate(fd, sizeof(frame_stats_t)) == 0) {
+            stats = mmap(NULL, sizeof(frame_stats_t), PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+            if (stats == MAP_FAILED) {
+                stats = NULL;
+            }
+        }
+        close(fd);
+    }
+
+    if (stats) {
+        stats_shared = 1;
+        memset(stats, 0, sizeof(frame_stats_t));
+    } else {
+        fprintf(stderr, "警告: 创建共享内存统计页失败: %s，统计只在进程内可见\n",
+                strerror(errno));
+        stats_shared = 0;
+        stats = calloc(1, sizeof(frame_stats_t));
+        if (!stats) {
+            return NULL;
+        }
+    }
+
+    stats->magic = FRAME_STATS_MAGIC;
+    stats->version = FRAME_STATS_VERSION;
+
+    return stats;
+}
+
+/**
+ * 释放统计页并删除共享内存
+ */
+void frame_stats_close(frame_stats_t *stats)
+{
+    if (!stats) return;
+
+    if (stats_shared) {
+        munmap(stats, sizeof(frame_stats_t));
+        shm_unlink(stats_shm_name);
+    } else {
+        free(stats);
+    }
+}
+
+/**
+ * 当前CLOCK_MONOTONIC时间（纳秒）
+ */
+uint64_t frame_stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * 记录一个延迟样本
+ */
+void frame_stats_record(latency_hist_t *hist, uint64_t start_ns, uint64_t end_ns)
+{
+    if (!hist || start_ns == 0 || end_ns < start_ns) {
+        return;
+    }
+
+    uint64_t us = (end_ns - start_ns) / 1000;
+
+    __atomic_fetch_add(&hist->buckets[frame_stats_bucket(us)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELEASE);
+
+    /* 只有一个写入线程，直接比较后写入 */
+    if (us > __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&hist->max_us, us, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * 计数器原子加
+ */
+void frame_stats_add(uint64_t *counter, uint64_t n)
+{
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+/**
+ * 记录丢帧
+ */
+void frame_stats_drop(frame_stats_t *stats, frame_drop_cause_t cause, uint64_t n)
+{
+    if (n == 0) {
+        return;
+    }
+
+    __atomic_fetch_add(&stats->frames_dropped, n, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->drops[cause], n, __ATOMIC_RELAXED);
+}
+
+/**
+ * 计算百分位延迟
+ */
+uint64_t frame_stats_percentile(const latency_hist_t *hist, double percentile)
+{
+    uint64_t total = 0;
+    uint64_t counts[FRAME_STATS_BUCKETS];
+
+    /* 先拷贝一份快照，写入线程并发更新时各桶之和与count可能略有出入 */
+    for (int i = 0; i < FRAME_STATS_BUCKETS; i++) {
+        counts[i] = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        total += counts[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)(total * percentile / 100.0 + 0.5);
+    if (target < 1) target = 1;
+
+    uint64_t max_us = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+    uint64_t seen = 0;
+    for (int i = 0; i < FRAME_STATS_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= target) {
+            uint64_t upper = frame_stats_bucket_upper(i);
+            return upper < max_us ? upper : max_us;
+        }
+    }
+
+    return max_us;
+}
+
+/**
+ * 打开运行中进程的统计页并打印
+ */
+int frame_stats_dump(int instance)
+{
+    char name[64];
+
+    static const char *stage_names[STAGE_COUNT] = {
+        [STAGE_CAPTURE]  = "帧完成→持有",
+        [STAGE_PROCESS]  = "持有→交给UVC",
+        [STAGE_TRANSFER] = "USB传输",
+        [STAGE_TOTAL]    = "帧完成→主机",
+        [STAGE_RECOVERY] = "故障恢复",
+    };
+
+    frame_stats_shm_name(instance, name, sizeof(name));
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "打开统计页%s失败: %s（uvc-camera-app是否在运行？）\n", name, strerror(errno));
+        return -1;
+    }
+
+    const frame_stats_t *stats = mmap(NULL, sizeof(frame_stats_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED) {
+        fprintf(stderr, "映射统计页失败: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (stats->magic != FRAME_STATS_MAGIC || stats->version != FRAME_STATS_VERSION) {
+        fprintf(stderr, "统计页版本不匹配\n");
+        munmap((void *)stats, sizeof(frame_stats_t));
+        return -1;
+    }
+
+    printf("采集 %llu  发送 %llu  丢弃 %llu  重复 %llu  撕裂 %llu  节流 %llu  静止 %llu  漏中断 %llu\n",
+           (unsigned long long)stats->frames_captured,
+           (unsigned long long)stats->frames_sent,
+           (unsigned long long)stats->frames_dropped,
+           (unsigned long long)stats->frames_duplicated,
+           (unsigned long long)stats->frames_torn,
+           (unsigned long long)stats->frames_paced,
+           (unsigned long long)stats->frames_static,
+           (unsigned long long)stats->irqs_missed);
+    printf("完整性校验: 检查 %llu  损坏 %llu\n",
+           (unsigned long long)stats->frames_verified,
+           (unsigned long long)stats->frames_corrupt);
+    printf("PL故障: 帧错误 %llu  VDMA恢复 %llu  VPSS恢复 %llu  停顿 %llu\n",
+           (unsigned long long)stats->pl_frame_errors,
+           (unsigned long long)stats->vdma_faults,
+           (unsigned long long)stats->vpss_faults,
+           (unsigned long long)stats->pl_stalls);
+    printf("丢弃原因: 无空闲帧缓冲 %llu  采集队列 %llu  UVC队列满 %llu  编码器 %llu\n",
+           (unsigned long long)stats->drops[DROP_NO_BUFFER],
+           (unsigned long long)stats->drops[DROP_QUEUE],
+           (unsigned long long)stats->drops[DROP_BACKPRESSURE],
+           (unsigned long long)stats->drops[DROP_ENCODER]);
+
+    printf("%-16s %10s %10s %10s %10s %10s\n", "阶段(us)", "样本", "p50", "p99", "p99.9", "最大");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const latency_hist_t *hist = &stats->hist[i];
+        printf("%-16s %10llu %10llu %10llu %10llu %10llu\n", stage_names[i],
+               (unsigned long long)hist->count,
+               (unsigned long long)frame_stats_percentile(hist, 50.0),
+               (unsigned long long)frame_stats_percentile(hist, 99.0),
+               (unsigned long long)frame_stats_percentile(hist, 99.9),
+               (unsigned long long)hist->max_us);
+    }
+
+    munmap((void *)stats, sizeof(frame_stats_t));
+    return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file frame_stats.h
+ * @brief 逐帧延迟统计与共享内存统计页
+ *
+ * 每帧记录各阶段时间戳（CLOCK_MONOTONIC）：
+ * - VDMA帧完成（中断处理时刻）
+ * - 采集线程持有该帧
+ * - 交给UVC（入队或write完成）
+ * - UVC Gadget归还缓冲（USB传输完成）
+ *
+ * 相邻阶段的差值写入HDR风格的对数-线性直方图（每个2的幂区间16个子桶，
+ * 相对误差约6%），可以计算p50/p99/p99.9。每个直方图只有一个写入线程，
+ * 计数用原子加，读者无需加锁。
+ *
+ * 统计结构放在POSIX共享内存 FRAME_STATS_SHM_NAME（/dev/shm下）中，
+ * 运行中可用 `uvc-camera-app --stats` 查看，不影响视频流。多路采集时每个
+ * 实例一个统计页，实例n（n>0）的名称加后缀".n"。
+ */
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdint.h>
+
+/* 共享内存名称 */
+#define FRAME_STATS_SHM_NAME   "/uvc-camera-stats"
+#define FRAME_STATS_MAGIC      0x53435655   /* "UVCS" */
+#define FRAME_STATS_VERSION    5
+
+/* 直方图参数：数值单位为微秒，覆盖 0 ~ 2^32 us */
+#define FRAME_STATS_SUB_BITS   4
+#define FRAME_STATS_SUB_COUNT  (1 << FRAME_STATS_SUB_BITS)
+#define FRAME_STATS_BUCKETS    ((32 - FRAME_STATS_SUB_BITS + 1) * FRAME_STATS_SUB_COUNT)
+
+/**
+ * 延迟阶段
+ */
+typedef enum {
+    STAGE_CAPTURE = 0,    /* VDMA帧完成 → 采集线程持有 */
+    STAGE_PROCESS,        /* 采集线程持有 → 交给UVC（含格式转换和排队） */
+    STAGE_TRANSFER,       /* 交给UVC → Gadget归还缓冲 */
+    STAGE_TOTAL,          /* VDMA帧完成 → Gadget归还缓冲 */
+    STAGE_RECOVERY,       /* 检测到PL故障 → 恢复后的第一帧 */
+    STAGE_COUNT,
+} frame_stage_t;
+
+/**
+ * 丢帧原因
+ */
+typedef enum {
+    DROP_NO_BUFFER = 0,   /* VDMA没有空闲帧缓冲，新帧原地覆盖 */
+    DROP_QUEUE,           /* 发送线程来不及取：采集队列挤出，或一次取到多帧只发最新的 */
+    DROP_BACKPRESSURE,    /* UVC队列满，等待期间被更新的帧取代 */
+    DROP_ENCODER,         /* 编码器没有空闲输入、没有输出或码流超过UVC缓冲 */
+    DROP_CAUSE_COUNT,
+} frame_drop_cause_t;
+
+/**
+ * 延迟直方图
+ */
+typedef struct {
+    uint64_t count;                          /* 样本数 */
+    uint64_t max_us;                         /* 最大值 */
+    uint64_t buckets[FRAME_STATS_BUCKETS];   /* 各桶计数 */
+} latency_hist_t;
+
+/**
+ * 共享内存统计页
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frames_captured;     /* 采集线程持有的新帧 */
+    uint64_t frames_sent;         /* 交给UVC的帧 */
+    uint64_t frames_dropped;      /* 丢弃总数（各原因之和） */
+    uint64_t drops[DROP_CAUSE_COUNT]; /* 按原因分类的丢弃数 */
+    uint64_t frames_duplicated;   /* 帧完成但内容没有更新（同一序号） */
+    uint64_t frames_torn;         /* 停靠指针切换晚于下一帧开始，可能撕裂 */
+    uint64_t frames_paced;        /* 按主机帧间隔节流跳过 */
+    uint64_t frames_static;       /* 画面静止，按保活帧率跳过 */
+    uint64_t irqs_missed;         /* 漏掉的VDMA中断 */
+    uint64_t frames_verified;     /* 校验模式：发送完毕后检查过的帧 */
+    uint64_t frames_corrupt;      /* 校验模式：持有期间被DMA改写的帧 */
+    uint64_t pl_frame_errors;     /* VDMA报告的非致命帧错误（行/帧长度不符等） */
+    uint64_t vdma_faults;         /* VDMA通道停止或出现致命错误，已软复位恢复 */
+    uint64_t vpss_faults;         /* VPSS报告错误，已软复位恢复 */
+    uint64_t pl_stalls;           /* 流水线长时间没有产生新帧，两个IP核都已恢复 */
+    latency_hist_t hist[STAGE_COUNT];
+} frame_stats_t;
+
+/**
+ * 创建共享内存统计页
+ *
+ * 共享内存不可用时退回进程内存，统计仍然有效但外部无法查看。
+ *
+ * @param instance 采集实例编号（0为FRAME_STATS_SHM_NAME本身）
+ * @return 统计页指针，失败返回NULL
+ */
+frame_stats_t *frame_stats_open(int instance);
+
+/**
+ * 释放统计页并删除共享内存
+ *
+ * @param stats 统计页指针
+ */
+void frame_stats_close(frame_stats_t *stats);
+
+/**
+ * 当前CLOCK_MONOTONIC时间（纳秒）
+ */
+uint64_t frame_stats_now(void);
+
+/**
+ * 记录一个延迟样本
+ *
+ * @param hist 直方图
+ * @param start_ns 起始时间戳（纳秒，0表示没有记录，忽略）
+ * @param end_ns 结束时间戳（纳秒）
+ */
+void frame_stats_record(latency_hist_t *hist, uint64_t start_ns, uint64_t end_ns);
+
+/**
+ * 计数器原子加
+ *
+ * @param counter 计数器
+ * @param n 增量
+ */
+void frame_stats_add(uint64_t *counter, uint64_t n);
+
+/**
+ * 记录丢帧（同时计入总数和对应原因）
+ *
+ * @param stats 统计页
+ * @param cause 丢帧原因
+ * @param n 丢弃帧数
+ */
+void frame_stats_drop(frame_stats_t *stats, frame_drop_cause_t cause, uint64_t n);
+
+/**
+ * 计算百分位延迟
+ *
+ * @param hist 直方图
+ * @param percentile 百分位（如99.9）
+ * @return 延迟（微秒，桶的上界，不超过最大值），没有样本返回0
+ */
+uint64_t frame_stats_percentile(const latency_hist_t *hist, double percentile);
+
+/**
+ * 打开运行中进程的统计页并打印
+ *
+ * @param instance 采集实例编号
+ * @return 0成功，-1失败（进程没有运行）
+ */
+int frame_stats_dump(int instance);
+
+#endif /* FRAME_STATS_H */
@@ -0,0 +1,858 @@
+/**
+ * @file uvc_host_bench.c
+ * @brief 主机端接收基准测试：以V4L2 mmap方式从UVC摄像头取流，统计帧率、带宽、帧间隔抖动和丢帧
+ *
+ * 在连接开发板的Linux主机上运行（uvcvideo驱动），每种格式/分辨率取流一段时间后打印：
+ * - 实测帧率和带宽（按缓冲的bytesused统计）
+ * - 帧间隔的最小/平均/最大值，相对标称帧间隔（VIDIOC_G_PARM）的抖动百分位和分布
+ * - 丢帧：主机侧按帧序号统计，设备侧按帧间隔估计，另计传输出错和不完整的帧
+ *
+ * 帧序号和时间戳：设备端在v4l2_buffer中填写的VDMA帧序号不会传到主机，时间戳也只在
+ * 支持PTS/SCR负载头的f_uvc上作为PTS发出。主机uvcvideo按FID翻转给每帧编号（没有空闲
+ * 缓冲而丢掉的帧也占一个序号），缓冲时间戳为主机时间（由PTS/SCR换算，或收到第一个包的
+ * 时间）。因此：
+ * - uvcvideo序号不连续表示主机没来得及取（缓冲太少或本程序被调度延迟）
+ * - 设备以--stamp运行时，帧数据开头带VDMA帧序号和设备时间（frame_stamp.h）：
+ *   设备序号的缺口扣除主机侧丢失即为设备少发的帧（VDMA丢帧、UVC队列满、节流或
+ *   静止画面按保活帧率跳过），设备时间给出传感器帧率
+ * - 没有帧内时间戳时，帧间隔约为标称间隔的k倍（扣除序号缺口后）估计为设备少发了k-1帧
+ * 两种结果都可以和设备统计页（uvc-camera-app --stats）对照。
+ */
+
+#define _GNU_SOURCE
+#include "frame_stats.h"
+#include "frame_stamp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+/* 默认参数 */
+#define DEFAULT_DEVICE      "/dev/video0"
+#define DEFAULT_SECONDS     10
+#define DEFAULT_BUFFERS     4
+
+/* mmap缓冲数上限 */
+#define BENCH_MAX_BUFFERS   16
+
+/* 遍历所有格式/分辨率时最多测试的组合数 */
+#define BENCH_MAX_CONFIGS   64
+
+/* 等待一帧的超时：超过后计一次超时继续等待 */
+#define FRAME_TIMEOUT_MS    2000
+
+/* 帧间隔超过标称间隔的这个倍数才认为中间少了帧 */
+#define GAP_FACTOR          1.5
+
+/* 抖动分布的区间上界（微秒），最后一个区间为超过最大值 */
+static const uint64_t jitter_bins_us[] = { 100, 250, 500, 1000, 2000, 5000, 10000 };
+#define JITTER_BIN_COUNT    (sizeof(jitter_bins_us) / sizeof(jitter_bins_us[0]) + 1)
+
+/**
+ * 一次测试的格式
+ */
+typedef struct {
+    uint32_t fourcc;          /* 像素格式，0表示沿用设备当前格式 */
+    int width;                /* 宽度，0表示沿用当前值 */
+    int height;               /* 高度，0表示沿用当前值 */
+    uint32_t interval_num;    /* 帧间隔（秒）= num/den，den为0表示沿用当前帧率 */
+    uint32_t interval_den;
+} bench_config_t;
+
+/**
+ * 一次测试的结果
+ */
+typedef struct {
+    bench_config_t config;        /* 驱动实际采用的格式 */
+    uint32_t sizeimage;           /* 一帧的最大字节数 */
+    uint64_t nominal_ns;          /* 标称帧间隔，0表示未知 */
+    uint64_t frames;              /* 收到的帧 */
+    uint64_t bytes;               /* 收到的字节 */
+    uint64_t errors;              /* 驱动标记出错的帧（V4L2_BUF_FLAG_ERROR） */
+    uint64_t short_frames;        /* 未压缩格式数据不足一帧 */
+    uint64_t host_lost;           /* 序号缺口：主机侧丢失 */
+    uint64_t device_lost;         /* 设备侧少发：按帧内序号，没有时按帧间隔估计 */
+    uint64_t stamped;             /* 带帧内时间戳的帧 */
+    int last_stamped;             /* 上一帧带帧内时间戳 */
+    uint32_t dev_first_seq;       /* 第一个/最近一个帧内序号 */
+    uint32_t dev_last_seq;
+    uint64_t dev_first_ns;        /* 第一个/最近一个帧内时间戳（设备时钟） */
+    uint64_t dev_last_ns;
+    uint64_t timeouts;            /* 超过FRAME_TIMEOUT_MS没有收到帧 */
+    uint64_t first_ns;            /* 第一帧时间戳 */
+    uint64_t last_ns;             /* 最后一帧时间戳 */
+    uint64_t interval_min_ns;
+    uint64_t interval_max_ns;
+    uint64_t jitter_bins[JITTER_BIN_COUNT];
+    latency_hist_t jitter;        /* 与最近的标称帧时刻之差 */
+} bench_result_t;
+
+/* mmap缓冲 */
+static struct {
+    void *start;
+    size_t length;
+} buffers[BENCH_MAX_BUFFERS];
+static int num_buffers = 0;
+
+/* 运行参数 */
+static const char *device = DEFAULT_DEVICE;
+static int run_seconds = DEFAULT_SECONDS;
+static uint64_t run_frames = 0;
+static int buffer_count = DEFAULT_BUFFERS;
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+/**
+ * ioctl，被信号打断时重试
+ */
+static int xioctl(int fd, unsigned long request, void *arg)
+{
+    int ret;
+
+    do {
+        ret = ioctl(fd, request, arg);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+
+/**
+ * 四字符码转字符串
+ */
+static const char *fourcc_str(uint32_t fourcc, char buf[5])
+{
+    for (int i = 0; i < 4; i++) {
+        char c = (fourcc >> (8 * i)) & 0xFF;
+        buf[i] = c >= 0x20 && c < 0x7F ? c : '?';
+    }
+    buf[4] = '\0';
+    return buf;
+}
+
+/**
+ * 解析四字符码（不足4个字符时补空格，如 "Y16"）
+ *
+ * @param str 字符串
+ * @param fourcc 解析结果
+ * @return 0成功，-1失败
+ */
+static int parse_fourcc(const char *str, uint32_t *fourcc)
+{
+    char code[4] = { ' ', ' ', ' ', ' ' };
+    size_t len = strlen(str);
+
+    if (len == 0 || len > 4) {
+        fprintf(stderr, "无效的像素格式: %s（应为四字符码，如 YUYV、NV12、MJPG）\n", str);
+        return -1;
+    }
+    memcpy(code, str, len);
+    *fourcc = v4l2_fourcc(code[0], code[1], code[2], code[3]);
+    return 0;
+}
+
+/**
+ * 压缩格式没有固定的帧大小，不检查数据是否完整
+ */
+static int is_compressed(uint32_t fourcc)
+{
+    return fourcc == V4L2_PIX_FMT_MJPEG || fourcc == V4L2_PIX_FMT_JPEG ||
+           fourcc == V4L2_PIX_FMT_H264;
+}
+
+/**
+ * 列出设备支持的格式、分辨率和帧间隔
+ */
+static void list_formats(int fd)
+{
+    struct v4l2_fmtdesc fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+    char name[5];
+
+    for (fmt.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0; fmt.index++) {
+        printf("%s  %s\n", fourcc_str(fmt.pixelformat, name), fmt.description);
+
+        struct v4l2_frmsizeenum size = { .pixel_format = fmt.pixelformat };
+        for (size.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0; size.index++) {
+            if (size.type != V4L2_FRMSIZE_TYPE_DISCRETE) {
+                printf("    %u-%ux%u-%u\n", size.stepwise.min_width, size.stepwise.max_width,
+                       size.stepwise.min_height, size.stepwise.max_height);
+                break;
+            }
+            printf("    %ux%u:", size.discrete.width, size.discrete.height);
+
+            struct v4l2_frmivalenum ival = {
+                .pixel_format = fmt.pixelformat,
+                .width = size.discrete.width,
+                .height = size.discrete.height,
+            };
+            for (ival.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival) == 0; ival.index++) {
+                if (ival.type != V4L2_FRMIVAL_TYPE_DISCRETE) {
+                    break;
+                }
+                printf(" %.2ffps", (double)ival.discrete.denominator / ival.discrete.numerator);
+            }
+            printf("\n");
+        }
+    }
+}
+
+/**
+ * 枚举所有格式和离散分辨率，每个组合取最高帧率
+ *
+ * @param fd 设备
+ * @param configs 输出数组（BENCH_MAX_CONFIGS项）
+ * @return 组合数
+ */
+static int enum_configs(int fd, bench_config_t *configs)
+{
+    struct v4l2_fmtdesc fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+    int count = 0;
+
+    for (fmt.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0; fmt.index++) {
+        struct v4l2_frmsizeenum size = { .pixel_format = fmt.pixelformat };
+        for (size.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0; size.index++) {
+            if (size.type != V4L2_FRMSIZE_TYPE_DISCRETE) {
+                break;
+            }
+            if (count >= BENCH_MAX_CONFIGS) {
+                fprintf(stderr, "警告: 组合超过%d个，只测试前%d个\n", BENCH_MAX_CONFIGS, BENCH_MAX_CONFIGS);
+                return count;
+            }
+
+            bench_config_t *config = &configs[count++];
+            memset(config, 0, sizeof(bench_config_t));
+            config->fourcc = fmt.pixelformat;
+            config->width = size.discrete.width;
+            config->height = size.discrete.height;
+
+            struct v4l2_frmivalenum ival = {
+                .pixel_format = fmt.pixelformat,
+                .width = size.discrete.width,
+                .height = size.discrete.height,
+            };
+            for (ival.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival) == 0; ival.index++) {
+                if (ival.type != V4L2_FRMIVAL_TYPE_DISCRETE) {
+                    break;
+                }
+                /* 最短的帧间隔：num/den 最小 */
+                if (config->interval_den == 0 ||
+                    (uint64_t)ival.discrete.numerator * config->interval_den <
+                    (uint64_t)config->interval_num * ival.discrete.denominator) {
+                    config->interval_num = ival.discrete.numerator;
+                    config->interval_den = ival.discrete.denominator;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+/**
+ * 设置格式和帧率，读回驱动实际采用的值
+ *
+ * @param fd 设备
+ * @param config 请求的格式
+ * @param result 写入实际格式、帧大小和标称帧间隔
+ * @return 0成功，-1失败
+ */
+static int configure(int fd, const bench_config_t *config, bench_result_t *result)
+{
+    struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+
+    if (xioctl(fd, VIDIOC_G_FMT, &fmt) < 0) {
+        perror("VIDIOC_G_FMT失败");
+        return -1;
+    }
+    if (config->fourcc) {
+        fmt.fmt.pix.pixelformat = config->fourcc;
+    }
+    if (config->width > 0 && config->height > 0) {
+        fmt.fmt.pix.width = config->width;
+        fmt.fmt.pix.height = config->height;
+    }
+    if (xioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
+        perror("VIDIOC_S_FMT失败");
+        return -1;
+    }
+
+    struct v4l2_streamparm parm = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+    if (config->interval_den) {
+        parm.parm.capture.timeperframe.numerator = config->interval_num;
+        parm.parm.capture.timeperframe.denominator = config->interval_den;
+        if (xioctl(fd, VIDIOC_S_PARM, &parm) < 0) {
+            perror("VIDIOC_S_PARM失败");
+            return -1;
+        }
+    }
+    if (xioctl(fd, VIDIOC_G_PARM, &parm) < 0) {
+        memset(&parm, 0, sizeof(parm));
+    }
+
+    result->config.fourcc = fmt.fmt.pix.pixelformat;
+    result->config.width = fmt.fmt.pix.width;
+    result->config.height = fmt.fmt.pix.height;
+    result->config.interval_num = parm.parm.capture.timeperframe.numerator;
+    result->config.interval_den = parm.parm.capture.timeperframe.denominator;
+    result->sizeimage = fmt.fmt.pix.sizeimage;
+    result->nominal_ns = result->config.interval_den ?
+        (uint64_t)result->config.interval_num * 1000000000ULL / result->config.interval_den : 0;
+    return 0;
+}
+
+/**
+ * 释放mmap缓冲
+ */
+static void free_buffers(int fd)
+{
+    struct v4l2_requestbuffers req = {
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .memory = V4L2_MEMORY_MMAP,
+    };
+
+    for (int i = 0; i < num_buffers; i++) {
+        munmap(buffers[i].start, buffers[i].length);
+    }
+    num_buffers = 0;
+    xioctl(fd, VIDIOC_REQBUFS, &req);
+}
+
+/**
+ * 申请、映射mmap缓冲并全部入队
+ *
+ * @param fd 设备
+ * @return 0成功，-1失败
+ */
+static int alloc_buffers(int fd)
+{
+    struct v4l2_requestbuffers req = {
+        .count = buffer_count,
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .memory = V4L2_MEMORY_MMAP,
+    };
+
+    if (xioctl(fd, VIDIOC_REQBUFS, &req) < 0) {
+        perror("VIDIOC_REQBUFS失败");
+        return -1;
+    }
+    if (req.count < 2 || req.count > BENCH_MAX_BUFFERS) {
+        fprintf(stderr, "驱动分配了%u个缓冲（需要2~%d）\n", req.count, BENCH_MAX_BUFFERS);
+        free_buffers(fd);
+        return -1;
+    }
+
+    for (num_buffers = 0; num_buffers < (int)req.count; num_buffers++) {
+        struct v4l2_buffer buf = {
+            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .memory = V4L2_MEMORY_MMAP,
+            .index = num_buffers,
+        };
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            perror("VIDIOC_QUERYBUF失败");
+            free_buffers(fd);
+            return -1;
+        }
+
+        void *start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+        if (start == MAP_FAILED) {
+            perror("映射缓冲失败");
+            free_buffers(fd);
+            return -1;
+        }
+        buffers[num_buffers].start = start;
+        buffers[num_buffers].length = buf.length;
+
+        if (xioctl(fd, VIDIOC_QBUF, &buf) < 0) {
+            perror("VIDIOC_QBUF失败");
+            num_buffers++;
+            free_buffers(fd);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * 读取帧内时间戳，按设备序号统计设备少发的帧
+ *
+ * @param result 测试结果
+ * @param data 帧数据
+ * @param len 帧数据长度
+ * @param seq_delta 与上一帧的uvcvideo序号差（主机侧丢失为seq_delta-1）
+ * @return 1本帧和上一帧都带时间戳（设备少发已按序号统计），0没有
+ */
+static int account_stamp(bench_result_t *result, const uint8_t *data, size_t len, uint32_t seq_delta)
+{
+    uint32_t dev_seq;
+    uint64_t dev_ns;
+    int prev_stamped = result->last_stamped;
+
+    result->last_stamped = frame_stamp_read(data, len, &dev_seq, &dev_ns) == 0;
+    if (!result->last_stamped) {
+        return 0;
+    }
+
+    if (result->stamped++ == 0) {
+        result->dev_first_seq = dev_seq;
+        result->dev_first_ns = dev_ns;
+    }
+
+    uint32_t dev_delta = dev_seq - result->dev_last_seq;
+    int counted = prev_stamped && seq_delta > 0 && dev_delta < 0x80000000U;
+    if (counted && dev_delta > seq_delta) {
+        result->device_lost += dev_delta - seq_delta;
+    }
+    result->dev_last_seq = dev_seq;
+    result->dev_last_ns = dev_ns;
+    return counted;
+}
+
+/**
+ * 统计一帧：序号缺口、帧间隔和抖动
+ */
+static void account_frame(bench_result_t *result, const struct v4l2_buffer *buf, const uint8_t *data,
+                          uint64_t ts_ns, uint32_t *prev_seq, uint64_t *prev_ns)
+{
+    result->bytes += buf->bytesused;
+    if (buf->flags & V4L2_BUF_FLAG_ERROR) {
+        result->errors++;
+    }
+    if (!is_compressed(result->config.fourcc) && buf->bytesused < result->sizeimage) {
+        result->short_frames++;
+    }
+
+    if (result->frames++ == 0) {
+        result->first_ns = ts_ns;
+        result->last_ns = ts_ns;
+        *prev_seq = buf->sequence;
+        *prev_ns = ts_ns;
+        account_stamp(result, data, buf->bytesused, 0);
+        return;
+    }
+
+    /* 序号缺口：主机没有空闲缓冲时驱动丢掉的帧 */
+    uint32_t seq_delta = buf->sequence - *prev_seq;
+    if (seq_delta > 1 && seq_delta < 0x80000000U) {
+        result->host_lost += seq_delta - 1;
+    } else if (seq_delta == 0 || seq_delta >= 0x80000000U) {
+        seq_delta = 1;
+    }
+    *prev_seq = buf->sequence;
+    int stamp_counted = account_stamp(result, data, buf->bytesused, seq_delta);
+
+    uint64_t prev = *prev_ns;
+    *prev_ns = ts_ns;
+    if (ts_ns <= prev) {
+        return;
+    }
+    uint64_t interval = ts_ns - prev;
+    result->last_ns = ts_ns;
+
+    if (result->interval_min_ns == 0 || interval < result->interval_min_ns) {
+        result->interval_min_ns = interval;
+    }
+    if (interval > result->interval_max_ns) {
+        result->interval_max_ns = interval;
+    }
+
+    if (result->nominal_ns == 0) {
+        return;
+    }
+
+    /* 帧间隔约为标称值的k倍：中间有k-1帧没有发出，其中seq_delta-1帧已计入主机侧 */
+    uint64_t slots = 1;
+    if (interval > result->nominal_ns * GAP_FACTOR) {
+        slots = (interval + result->nominal_ns / 2) / result->nominal_ns;
+        if (!stamp_counted && slots > seq_delta) {
+            result->device_lost += slots - seq_delta;
+        }
+    }
+
+    /* 抖动：与最近的标称帧时刻之差 */
+    uint64_t expected = prev + slots * result->nominal_ns;
+    if (ts_ns >= expected) {
+        frame_stats_record(&result->jitter, expected, ts_ns);
+    } else {
+        frame_stats_record(&result->jitter, ts_ns, expected);
+    }
+
+    uint64_t deviation_us = (ts_ns >= expected ? ts_ns - expected : expected - ts_ns) / 1000;
+    size_t bin = 0;
+    while (bin < JITTER_BIN_COUNT - 1 && deviation_us >= jitter_bins_us[bin]) {
+        bin++;
+    }
+    result->jitter_bins[bin]++;
+}
+
+/**
+ * 取流一段时间并统计
+ *
+ * @param fd 设备
+ * @param config 请求的格式
+ * @param result 测试结果
+ * @return 0成功，-1失败
+ */
+static int run_bench(int fd, const bench_config_t *config, bench_result_t *result)
+{
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    uint32_t prev_seq = 0;
+    uint64_t prev_ns = 0;
+    int ret = 0;
+
+    memset(result, 0, sizeof(bench_result_t));
+    result->config = *config;
+    if (configure(fd, config, result) < 0 || alloc_buffers(fd) < 0) {
+        return -1;
+    }
+
+    if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+        perror("VIDIOC_STREAMON失败");
+        free_buffers(fd);
+        return -1;
+    }
+
+    uint64_t deadline = frame_stats_now() + (uint64_t)run_seconds * 1000000000ULL;
+    while (running && frame_stats_now() < deadline &&
+           (run_frames == 0 || result->frames < run_frames)) {
+        int n = poll(&pfd, 1, FRAME_TIMEOUT_MS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll失败");
+            ret = -1;
+            break;
+        }
+        if (n == 0) {
+            result->timeouts++;
+            continue;
+        }
+
+        struct v4l2_buffer buf = {
+            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .memory = V4L2_MEMORY_MMAP,
+        };
+        if (xioctl(fd, VIDIOC_DQBUF, &buf) < 0) {
+            if (errno == EAGAIN) {
+                continue;
+            }
+            perror("VIDIOC_DQBUF失败");
+            ret = -1;
+            break;
+        }
+
+        /* 驱动没有填写时间戳时用出队时间 */
+        uint64_t ts_ns = (uint64_t)buf.timestamp.tv_sec * 1000000000ULL +
+                         (uint64_t)buf.timestamp.tv_usec * 1000;
+        if (ts_ns == 0) {
+            ts_ns = frame_stats_now();
+        }
+        account_frame(result, &buf, buffers[buf.index].start, ts_ns, &prev_seq, &prev_ns);
+
+        if (xioctl(fd, VIDIOC_QBUF, &buf) < 0) {
+            perror("VIDIOC_QBUF失败");
+            ret = -1;
+            break;
+        }
+    }
+
+    if (xioctl(fd, VIDIOC_STREAMOFF, &type) < 0) {
+        perror("VIDIOC_STREAMOFF失败");
+    }
+    free_buffers(fd);
+    return ret;
+}
+
+/**
+ * 格式描述，如 "YUYV 640x480@60.00fps"
+ */
+static const char *config_str(const bench_result_t *result, char *buf, size_t len)
+{
+    char name[5];
+    const bench_config_t *config = &result->config;
+
+    if (config->interval_num) {
+        snprintf(buf, len, "%s %dx%d@%.2ffps", fourcc_str(config->fourcc, name),
+                 config->width, config->height, (double)config->interval_den / config->interval_num);
+    } else {
+        snprintf(buf, len, "%s %dx%d", fourcc_str(config->fourcc, name), config->width, config->height);
+    }
+    return buf;
+}
+
+/**
+ * 实测帧率（按首末帧时间戳）
+ */
+static double result_fps(const bench_result_t *result)
+{
+    if (result->frames < 2 || result->last_ns <= result->first_ns) {
+        return 0;
+    }
+    return (result->frames - 1) * 1e9 / (result->last_ns - result->first_ns);
+}
+
+/**
+ * 实测带宽（MB/s）
+ */
+static double result_mbps(const bench_result_t *result)
+{
+    if (result->frames < 2 || result->last_ns <= result->first_ns) {
+        return 0;
+    }
+    return result->bytes * (result->frames - 1) / (double)result->frames /
+           ((result->last_ns - result->first_ns) / 1e9) / 1e6;
+}
+
+/**
+ * 打印一次测试的详细结果
+ */
+static void print_result(const bench_result_t *result)
+{
+    char desc[64];
+
+    printf("%s: %llu帧 %.1f秒  实测 %.2f fps  %.1f MB/s (%.1f Mbit/s)\n",
+           config_str(result, desc, sizeof(desc)), (unsigned long long)result->frames,
+           (result->last_ns - result->first_ns) / 1e9, result_fps(result),
+           result_mbps(result), result_mbps(result) * 8);
+    if (result->frames < 2) {
+        printf("  没有收到足够的帧\n");
+        return;
+    }
+
+    printf("  帧间隔 min/avg/max: %.3f/%.3f/%.3fms",
+           result->interval_min_ns / 1e6,
+           (result->last_ns - result->first_ns) / 1e6 / (result->frames - 1),
+           result->interval_max_ns / 1e6);
+    if (result->nominal_ns) {
+        printf("（标称 %.3fms）", result->nominal_ns / 1e6);
+    }
+    printf("\n");
+
+    if (result->stamped > 1 && result->dev_last_ns > result->dev_first_ns) {
+        printf("  帧内时间戳: %llu帧  设备序号 %u-%u  传感器 %.2f fps（设备时钟）\n",
+               (unsigned long long)result->stamped, result->dev_first_seq, result->dev_last_seq,
+               (uint32_t)(result->dev_last_seq - result->dev_first_seq) * 1e9 /
+               (result->dev_last_ns - result->dev_first_ns));
+    }
+
+    printf("  丢帧: 主机侧(序号) %llu  设备侧(%s) %llu  出错 %llu  不完整 %llu  超时 %llu\n",
+           (unsigned long long)result->host_lost, result->stamped ? "帧内序号" : "间隔估计",
+           (unsigned long long)result->device_lost,
+           (unsigned long long)result->errors, (unsigned long long)result->short_frames,
+           (unsigned long long)result->timeouts);
+
+    if (result->jitter.count == 0) {
+        printf("  驱动没有报告帧率，不统计抖动\n");
+        return;
+    }
+
+    printf("  抖动 p50/p99/p99.9/max: %llu/%llu/%llu/%lluus\n",
+           (unsigned long long)frame_stats_percentile(&result->jitter, 50.0),
+           (unsigned long long)frame_stats_percentile(&result->jitter, 99.0),
+           (unsigned long long)frame_stats_percentile(&result->jitter, 99.9),
+           (unsigned long long)result->jitter.max_us);
+
+    for (size_t i = 0; i < JITTER_BIN_COUNT; i++) {
+        char label[16];
+        double percent = result->jitter_bins[i] * 100.0 / result->jitter.count;
+
+        if (i < JITTER_BIN_COUNT - 1) {
+            snprintf(label, sizeof(label), "<%lluus", (unsigned long long)jitter_bins_us[i]);
+        } else {
+            snprintf(label, sizeof(label), ">=%lluus", (unsigned long long)jitter_bins_us[i - 1]);
+        }
+        printf("    %-9s %8llu %5.1f%% ", label, (unsigned long long)result->jitter_bins[i], percent);
+        for (int bar = 0; bar < (int)(percent / 2 + 0.5); bar++) {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+}
+
+/**
+ * 遍历测试后打印汇总表
+ */
+static void print_summary(const bench_result_t *results, int count)
+{
+    char desc[64];
+
+    printf("\n%-26s %8s %8s %10s %8s %8s %8s %8s\n",
+           "格式", "帧", "fps", "MB/s", "p99(us)", "主机丢", "设备丢", "出错");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *result = &results[i];
+        printf("%-26s %8llu %8.2f %10.1f %8llu %8llu %8llu %8llu\n",
+               config_str(result, desc, sizeof(desc)), (unsigned long long)result->frames,
+               result_fps(result), result_mbps(result),
+               (unsigned long long)frame_stats_percentile(&result->jitter, 99.0),
+               (unsigned long long)result->host_lost, (unsigned long long)result->device_lost,
+               (unsigned long long)(result->errors + result->short_frames));
+    }
+}
+
+static void print_usage(const char *prog)
+{
+    printf("用法: %s [选项]\n", prog);
+    printf("  -d, --device <dev>     UVC摄像头设备（默认 %s）\n", DEFAULT_DEVICE);
+    printf("  -f, --format <fourcc>  像素格式，如 YUYV、NV12、MJPG、H264（默认沿用当前格式）\n");
+    printf("  -w, --width <n>        宽度（与 -H 一起指定）\n");
+    printf("  -H, --height <n>       高度\n");
+    printf("  -r, --fps <n>          帧率（默认沿用当前帧率）\n");
+    printf("  -t, --time <s>         每种格式的取流时间（默认 %d 秒）\n", DEFAULT_SECONDS);
+    printf("  -n, --frames <n>       收到n帧后结束（默认按时间）\n");
+    printf("  -b, --buffers <n>      mmap缓冲数（默认 %d，最多 %d）\n", DEFAULT_BUFFERS, BENCH_MAX_BUFFERS);
+    printf("  -a, --all              依次测试所有格式和分辨率（各取最高帧率）并打印汇总\n");
+    printf("  -l, --list             列出支持的格式、分辨率和帧率\n");
+    printf("  -h, --help             显示帮助\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option long_opts[] = {
+        { "device",  required_argument, NULL, 'd' },
+        { "format",  required_argument, NULL, 'f' },
+        { "width",   required_argument, NULL, 'w' },
+        { "height",  required_argument, NULL, 'H' },
+        { "fps",     required_argument, NULL, 'r' },
+        { "time",    required_argument, NULL, 't' },
+        { "frames",  required_argument, NULL, 'n' },
+        { "buffers", required_argument, NULL, 'b' },
+        { "all",     no_argument,       NULL, 'a' },
+        { "list",    no_argument,       NULL, 'l' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    bench_config_t config = { 0 };
+    int sweep = 0;
+    int list = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "d:f:w:H:r:t:n:b:alh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'd':
+            device = optarg;
+            break;
+        case 'f':
+            if (parse_fourcc(optarg, &config.fourcc) < 0) {
+                return 1;
+            }
+            break;
+        case 'w':
+            config.width = atoi(optarg);
+            break;
+        case 'H':
+            config.height = atoi(optarg);
+            break;
+        case 'r':
+            config.interval_num = 1;
+            config.interval_den = atoi(optarg);
+            break;
+        case 't':
+            run_seconds = atoi(optarg);
+            break;
+        case 'n':
+            run_frames = strtoull(optarg, NULL, 0);
+            break;
+        case 'b':
+            buffer_count = atoi(optarg);
+            break;
+        case 'a':
+            sweep = 1;
+            break;
+        case 'l':
+            list = 1;
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (run_seconds <= 0 || buffer_count < 2 || buffer_count > BENCH_MAX_BUFFERS) {
+        fprintf(stderr, "无效的参数\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    int fd = open(device, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        fprintf(stderr, "打开%s失败: %s\n", device, strerror(errno));
+        return 1;
+    }
+
+    struct v4l2_capability cap;
+    if (xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0) {
+        perror("VIDIOC_QUERYCAP失败");
+        close(fd);
+        return 1;
+    }
+    uint32_t caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+        fprintf(stderr, "%s不是支持流式采集的视频设备\n", device);
+        close(fd);
+        return 1;
+    }
+    printf("设备: %s（%s，驱动 %s）\n", device, cap.card, cap.driver);
+
+    if (list) {
+        list_formats(fd);
+        close(fd);
+        return 0;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    static bench_config_t configs[BENCH_MAX_CONFIGS];
+    static bench_result_t results[BENCH_MAX_CONFIGS];
+    int count = 1;
+    int ret = 0;
+
+    if (sweep) {
+        count = enum_configs(fd, configs);
+        if (count == 0) {
+            fprintf(stderr, "设备没有列出离散的格式/分辨率\n");
+            close(fd);
+            return 1;
+        }
+    } else {
+        configs[0] = config;
+    }
+
+    int done = 0;
+    for (int i = 0; i < count && running; i++) {
+        if (run_bench(fd, &configs[i], &results[i]) < 0) {
+            ret = 1;
+            if (!sweep) {
+                break;
+            }
+            continue;
+        }
+        print_result(&results[i]);
+        done = i + 1;
+    }
+
+    if (sweep && done > 0) {
+        print_summary(results, done);
+    }
+
+    close(fd);
+    return ret;
+}
@@ -4,14 +4,33 @@
  * 
  * 功能：
  * 1. 初始化VPSS和VDMA
- * 2. 从DDR读取视频帧（RGBA格式，A固定为FF）
- * 3. 直接输出RGBA格式到UVC（不进行格式转换）
- * 4. 通过UVC Gadget发送到PC端（640x480@60fps，USB3.0）
+ * 2. 处理主机的PROBE/COMMIT协商，收到STREAMON后按提交的分辨率重配PL并开始发送
+ * 3. 采集线程等待VDMA帧完成中断，通过无锁队列把最新帧交给发送线程；
+ *    发送线程（主线程）用epoll同时等待新帧、UVC事件/缓冲完成和统计定时器，
+ *    从DDR读取视频帧（RGBA格式，A固定为FF）
+ * 4. 直接输出RGBA，或转换为YUYV/NV12后输出到UVC，或转换为NV12后经VCU编码为H.264输出
+ * 5. 按主机提交的帧间隔节流，通过UVC Gadget发送到PC端（640x480@60fps，USB3.0）
+ * 6. 逐帧记录各阶段延迟，统计页放在共享内存中（--stats 查看）
  * 
- * 数据流：
- * CameraLink(PL) → VPSS(YUV422→RGB) → VDMA → DDR(RGBA) → 应用程序 → UVC(RGBA) → PC
+ * 数据流（-p 选项选择流水线）：
+ * rgba:   CameraLink(PL) → VPSS(YUV422→RGB) → VDMA → DDR(RGBA) → 应用程序 → UVC(RGBA/YUYV/NV12) → PC
+ * yuv422: CameraLink(PL) → VPSS(直通) → VDMA → DDR(YUYV, 2字节/像素) → 应用程序 → UVC(YUYV/NV12) → PC
+ *
+ * 传输方式（-m 选项）：
+ * - userptr（RGBA默认）：VDMA帧缓冲直接以USERPTR入队UVC输出队列，
+ *   USB控制器从VDMA写入的同一块DDR读取，CPU不拷贝；帧缓冲须为u-dma-buf（-u），
+ *   /dev/mem映射的保留区域不能入队，自动改为mmap
+ * - mmap（YUYV/NV12默认）：CPU把帧转换到驱动分配的缓冲
+ * - write：write()拷贝方式（旧流程），不携带时间戳
+ *
+ * 入队的缓冲带VDMA帧完成时间（CLOCK_MONOTONIC）和VDMA帧序号（跳过或漏掉的帧也占序号），
+ * 它们只在Gadget内部使用：序号不会传到主机，时间戳只有支持PTS/SCR负载头的f_uvc版本
+ * 才会发出。--stamp把两者写进帧数据开头（frame_stamp.h），主机端（host/）据此按设备
+ * 序号统计丢帧、按设备时钟对齐时序。
  */
 
+#define _GNU_SOURCE     /* pthread_setaffinity_np / CPU_SET */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,33 +41,249 @@
 #include <linux/videodev2.h>
 #include <errno.h>
 #include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+#include <getopt.h>
 
 #include "vpss_control.h"
 #include "vdma_control.h"
+#include "uvc_control.h"
+#include "uvc_descriptor.h"
+#include "format_convert.h"
+#include "frame_ring.h"
+#include "frame_stats.h"
+#include "frame_pacer.h"
+#include "frame_diff.h"
+#include "frame_pool.h"
+#include "frame_stamp.h"
+#include "venc_control.h"
+#include "config_file.h"
+
+/* 以下为默认值，可通过命令行或配置文件修改 */
 
 /* 视频参数 - 640x480@60fps */
 #define VIDEO_WIDTH     640
 #define VIDEO_HEIGHT    480
-#define BYTES_PER_PIXEL 4    /* RGBA格式：32位，A固定为FF */
-#define NUM_FRAMES      3    /* 三缓冲（避免读写冲突） */
-#define FRAME_SIZE      (VIDEO_WIDTH * VIDEO_HEIGHT * BYTES_PER_PIXEL)
+#define NUM_FRAMES      3    /* 三缓冲：VDMA写入1帧 + 最新完成1帧 + UVC持有1帧 */
 
-/* 帧缓冲物理地址（必须与设备树中reserved-memory一致） */
-#define FRAME_BUFFER_PHYS   0x20000000
+/* 帧缓冲物理地址，0表示由vdma_init()从设备树reserved-memory或u-dma-buf自动选择 */
+#define FRAME_BUFFER_PHYS   0
 
 /* UVC设备节点 */
 #define UVC_DEVICE      "/dev/video0"
 
-/* 目标帧率（fps）- 60fps for USB3.0 */
-#define TARGET_FPS      60
-#define FRAME_INTERVAL_US  (1000000 / TARGET_FPS)
+/* VCU编码器（allegro-dvt驱动的V4L2 M2M设备）和默认码率 */
+#define ENCODER_DEVICE       "/dev/video1"
+#define ENCODER_BITRATE_KBPS 8000
+#define ENCODER_TIMEOUT_MS   100
+
+/* 统计信息打印周期（ms），同时用于检测VDMA断流 */
+#define STATS_INTERVAL_MS      1000
+
+/* UIO设备没有中断时轮询VDMA状态的周期（ms） */
+#define VDMA_POLL_INTERVAL_MS  1
+
+/* 采集线程交给发送线程排队的帧数（每帧占用一个VDMA帧缓冲） */
+#define FRAME_QUEUE_DEPTH      1
+
+/* UVC输出队列中最多同时交给驱动的帧数，0表示不限制（全部缓冲）；越少延迟越低，越多越能吸收USB抖动 */
+#define UVC_QUEUE_LIMIT        0
+
+/* 静止画面检测：抽样块内每个样本的平均变化阈值（8位分量或16位原始样本单位） */
+#define SCENE_THRESHOLD        2
+
+/* 校验模式下每次取流最多打印的损坏帧数 */
+#define VERIFY_REPORT_LIMIT    10
+
+/* 中间缓冲池槽位：write方式的转换输出 + 合并中间结果 */
+#define CONVERT_POOL_SLOTS     2
+
+/* 看门狗：超过这个时间没有新帧认为流水线停顿；两次恢复之间至少间隔同样的时间 */
+#define WATCHDOG_STALL_MS      500
+
+/* 常驻模式下等待UVC Gadget设备出现的检查间隔 */
+#define UVC_WAIT_INTERVAL_MS   100
+
+/* 默认配置文件 */
+#define CONFIG_FILE            "/etc/uvc-camera.conf"
+
+/* 发送线程epoll事件来源 */
+enum {
+    EV_SRC_RING = 0,      /* 采集线程入队了新帧（eventfd） */
+    EV_SRC_UVC,           /* UVC控制事件（POLLPRI）和缓冲完成（POLLOUT） */
+    EV_SRC_STATS,         /* 统计定时器 */
+};
+
+/**
+ * UVC输出格式（Gadget描述符由 --descriptors 按此表生成）
+ */
+typedef enum {
+    OUT_FMT_RGBA = 0,     /* VDMA帧直接输出 */
+    OUT_FMT_YUYV,         /* RGBA -> YUV 4:2:2，带宽减半 */
+    OUT_FMT_NV12,         /* RGBA -> YUV 4:2:0 */
+    OUT_FMT_H264,         /* 转换为NV12后由VCU编码，帧大小可变 */
+    OUT_FMT_Y16,          /* 原始16位样本（raw16流水线） */
+    OUT_FMT_COUNT,
+} out_format_t;
+
+/* Linux UVC用 BA81EB33-... 表示RGB32（主机端uvcvideo识别为ABGR32），其余为标准FourCC GUID */
+static const uvc_format_info_t out_formats[OUT_FMT_COUNT] = {
+    [OUT_FMT_RGBA] = { "rgba", V4L2_PIX_FMT_ABGR32, 32, "{ba81eb33-49c3-4f3e-9b5d-ba1d5e004344}", 0 },
+    [OUT_FMT_YUYV] = { "yuyv", V4L2_PIX_FMT_YUYV,   16, "{32595559-0000-0010-8000-00aa00389b71}", 0 },
+    [OUT_FMT_NV12] = { "nv12", V4L2_PIX_FMT_NV12,   12, "{3231564e-0000-0010-8000-00aa00389b71}", 0 },
+    /* 压缩格式的bits_per_pixel只用于每帧大小上限（按NV12原始帧计） */
+    [OUT_FMT_H264] = { "h264", V4L2_PIX_FMT_H264,   12, "{34363248-0000-0010-8000-00aa00389b71}", 1 },
+    [OUT_FMT_Y16]  = { "y16",  V4L2_PIX_FMT_Y16,    16, "{20363159-0000-0010-8000-00aa00389b71}", 0 },
+};
+
+/**
+ * PL流水线模式：决定VPSS配置、VDMA每像素字节数和帧缓冲中的原生格式
+ */
+typedef enum {
+    PIPE_RGBA = 0,        /* VPSS YUV422→RGB，VDMA写RGBA（A固定为FF） */
+    PIPE_YUV422,          /* VPSS直通，VDMA写YUYV */
+    PIPE_RAW16,           /* VPSS 1:1单位矩阵直通，VDMA写传感器原始16位样本 */
+} pipeline_mode_t;
+
+static const struct {
+    const char *name;
+    vpss_mode_t vpss_mode;
+    int bytes_per_pixel;
+    out_format_t native_format;   /* 不需要CPU转换、可零拷贝发送的输出格式 */
+} pipelines[] = {
+    [PIPE_RGBA]   = { "rgba",   VPSS_MODE_RGB,    4, OUT_FMT_RGBA },
+    [PIPE_YUV422] = { "yuv422", VPSS_MODE_YUV422, 2, OUT_FMT_YUYV },
+    [PIPE_RAW16]  = { "raw16",  VPSS_MODE_RAW16,  2, OUT_FMT_Y16 },
+};
+
+/* 通告给主机的帧描述符（每个格式相同）：第一个为采集尺寸（使用ROI时为ROI输出尺寸），
+ * 比特流带VPSS缩放器时再通告1/2和1/4缩放尺寸，见add_scaled_frames() */
+#define MAX_UVC_FRAMES  3
+static uvc_frame_info_t uvc_frames[MAX_UVC_FRAMES] = {
+    { VIDEO_WIDTH, VIDEO_HEIGHT, { 166666, 333333, 400000, 500000, 666666 }, 5 },
+};
+static int num_uvc_frames = 1;
 
 /* 全局变量 */
+/* 运行参数（默认值见上面的宏） */
+static int capture_width = VIDEO_WIDTH;
+static int capture_height = VIDEO_HEIGHT;
+static int num_frames = NUM_FRAMES;
+static uint32_t frame_buffer_phys = FRAME_BUFFER_PHYS;
+static const char *uvc_device = UVC_DEVICE;
+static int queue_depth = FRAME_QUEUE_DEPTH;
+static int uvc_queue_limit = UVC_QUEUE_LIMIT;
+static int bulk_transfer = 0;             /* 视频流端点使用批量传输（setup_uvc.sh按--descriptors配置） */
+static int keep_pl_running = 0;           /* --keep-pl：不取流时PL流水线继续运行 */
+static int pl_suspended = 0;              /* PL流水线已停止（不取流期间不写DDR） */
+static int daemon_mode = 0;               /* --daemon：后台常驻，PL流水线先启动，再等待UVC Gadget出现 */
+static volatile int pipeline_status = 1;  /* PL流水线启动线程：1进行中，0完成，-1失败 */
+static int instance = 0;                  /* 多路采集的实例编号：统计页名称和UVC功能（uvc.N） */
+static const char *vdma_device = NULL;    /* VDMA/VPSS实例，NULL为默认基地址 */
+static const char *vpss_device = NULL;
+static int max_fps = 0;                   /* 0：只按主机提交的帧间隔节流 */
+static int idle_fps = 0;                  /* 画面静止时的保活帧率，0表示不检测静止画面 */
+static int scene_threshold = SCENE_THRESHOLD;
+static int verify_frames = 0;             /* --verify：检查帧在持有期间是否被VDMA改写 */
+static int stamp_frames = 0;              /* --stamp：帧数据开头写入VDMA帧序号和帧完成时间 */
+
 static vpss_control_t vpss;
 static vdma_control_t vdma;
-static int uvc_fd = -1;
+static uvc_control_t uvc = { .fd = -1 };
+static venc_control_t venc = { .fd = -1 };
+static const char *encoder_device = ENCODER_DEVICE;
+static uint32_t encoder_bitrate = ENCODER_BITRATE_KBPS * 1000;
+static uvc_io_mode_t io_mode = UVC_IO_USERPTR;   /* 本次取流的传输方式 */
+static uvc_io_mode_t io_mode_option = UVC_IO_USERPTR;
+static int io_mode_set = 0;               /* 是否通过-m指定了传输方式 */
+static const char *udmabuf_name = NULL;   /* NULL：通过/dev/mem非缓存映射帧缓冲 */
+static pipeline_mode_t pipeline = PIPE_RGBA;
+static out_format_t out_format = OUT_FMT_RGBA;
+static int out_format_set = 0;            /* 是否通过-F指定了输出格式 */
+static uvc_format_info_t uvc_formats[OUT_FMT_COUNT];  /* 通告给主机的格式，第一个为-F选择的格式 */
+static int num_uvc_formats = 0;
+static uvc_streaming_ep_t streaming_ep;  /* 视频流等时端点参数（与Gadget描述符一致） */
+static csc_standard_t csc_standard = CSC_BT601;
+static frame_pool_t convert_pool;         /* CPU处理阶段的中间缓冲（大页，预分配） */
+static int staging_slot = -1;             /* write方式下格式转换的输出缓冲（池槽位） */
+static uint8_t *staging_buffer = NULL;
+
+/* ROI裁剪和2x2合并：只发送采集帧中的一个窗口（width为0表示发送整帧） */
+static struct {
+    int x, y;             /* 窗口左上角 */
+    int width, height;    /* 窗口尺寸（合并前） */
+    int binning;          /* 1不合并，2为2x2合并 */
+} roi = { 0, 0, 0, 0, 1 };
+static int bin_slot = -1;                 /* 合并后再做格式转换时的中间缓冲（池槽位） */
+static uint8_t *bin_buffer = NULL;
+static int stream_active = 0;             /* 主机是否已STREAMON */
+static frame_pacer_t pacer;               /* 按传感器帧节拍节流到主机帧间隔 */
+static frame_diff_t scene;                /* 静止画面检测（与上一次发送的帧比较） */
+static uint64_t scene_sent_ns = 0;        /* 上一次发送的帧的VDMA完成时间，用于保活间隔 */
+static int pending_frame = -1;            /* UVC队列满时等待发送的帧（已持有），-1表示没有 */
+static int epoll_fd = -1;
+static uint32_t uvc_epoll_events = 0;     /* 当前在epoll中关注的UVC事件 */
+
+/* 本次取流的统计 */
+static struct {
+    int frames;           /* 已发送 */
+    int skipped;          /* UVC队列满，等待期间被更新的帧取代 */
+    int paced;            /* 节流跳过 */
+    int still;            /* 画面静止跳过 */
+    int corrupt;          /* 校验模式：持有期间被改写 */
+    int last_frame;       /* 最近发送的VDMA帧编号 */
+    uint32_t last_seq;    /* 最近发送帧的序号 */
+    uint32_t tick_seq;    /* 上次统计时的VDMA帧序号 */
+    uint64_t bytes;       /* 已发送的字节数 */
+    struct timespec start_time;
+    struct rusage start_usage;    /* 开始取流时的进程CPU时间 */
+} stats;
 static volatile int running = 1;
 
+/* 采集线程（持有vdma_control_t，等待帧完成）与发送线程（持有UVC设备）之间的状态 */
+static frame_ring_t frame_ring;
+static pthread_t capture_tid;
+static int capture_started = 0;
+static int frame_event_fd = -1;           /* 采集线程 → 发送线程：有新帧 */
+static int capture_stop_fd = -1;          /* 发送线程 → 采集线程：停止 */
+static volatile int capture_failed = 0;
+
+/* 延迟统计：采集线程写frame_acquire_ns，发送线程经队列取得帧后读取 */
+static frame_stats_t *frame_stats = NULL;
+static uint64_t frame_acquire_ns[VDMA_MAX_FRAME_STORES];
+static uint64_t buf_frame_done_ns[UVC_MAX_BUFFERS];   /* 各UVC缓冲中帧的VDMA完成时间 */
+static uint64_t buf_queued_ns[UVC_MAX_BUFFERS];       /* 各UVC缓冲入队时间 */
+static struct {
+    uint32_t dropped;
+    uint32_t torn;
+    uint32_t missed;
+} vdma_published;                                     /* 已计入统计页的VDMA计数 */
+
+/* 看门狗状态（只在采集线程中访问） */
+static struct {
+    uint64_t fault_ns;        /* 检测到故障的时间，0表示没有待恢复的故障 */
+    uint64_t last_frame_ns;   /* 最近一次帧完成 */
+    uint64_t last_recover_ns; /* 最近一次恢复 */
+} watchdog;
+
+/* 校验模式：采集线程持有帧时的快照，发送完毕归还VDMA前再比较一次 */
+static struct {
+    uint32_t head;        /* 首行哈希 */
+    uint32_t tail;        /* 末行哈希 */
+    uint32_t seq;         /* 帧序号 */
+    uint32_t vdma_seq;    /* 持有时VDMA已完成的帧数 */
+} frame_snapshot[VDMA_MAX_FRAME_STORES];
+
+/* 线程调度（-1表示不绑定CPU，0表示不使用SCHED_FIFO） */
+static int capture_cpu = -1;
+static int transmit_cpu = -1;
+static int rt_priority = 0;
+
 /**
  * 信号处理函数
  */
@@ -58,197 +293,2201 @@ void signal_handler(int signum)
     running = 0;
 }
 
-/* 
- * 注意：不再需要格式转换函数
- * 直接发送RGBA数据到UVC设备
+/**
+ * 打印用法
  */
+static void print_usage(const char *prog)
+{
+    printf("用法: %s [选项]\n", prog);
+    printf("      --config <文件> key=value配置文件（默认%s，键名同长选项），命令行选项优先\n",
+           CONFIG_FILE);
+    printf("  -w, --width <n>    采集宽度（默认%d）\n", VIDEO_WIDTH);
+    printf("  -H, --height <n>   采集高度（默认%d）\n", VIDEO_HEIGHT);
+    printf("  -f, --fps <n>      发送帧率上限，0表示只按主机协商的帧率（默认0）\n");
+    printf("      --idle-fps <n> 画面静止时只按此帧率发送（保活），0表示不检测（默认0）\n");
+    printf("      --scene-threshold <n> 静止判定阈值：抽样块内每个样本的平均变化（默认%d）\n",
+           SCENE_THRESHOLD);
+    printf("  -n, --frames <n>   VDMA帧缓冲数（默认%d）\n", NUM_FRAMES);
+    printf("      --fb-phys <addr> 帧缓冲物理地址（默认从设备树reserved-memory自动选择）\n");
+    printf("  -d, --uvc-device <dev> UVC Gadget设备（默认%s）\n", UVC_DEVICE);
+    printf("      --instance <n> 多路采集的实例编号：使用第n个UVC功能（uvc.n）和独立的统计页（默认0）\n");
+    printf("      --vdma <dev>   VDMA实例：寄存器物理地址、设备树标签或UIO设备名（默认0x%08X）\n",
+           VDMA_BASE_ADDR);
+    printf("      --vpss <dev>   VPSS实例（同上，默认按UIO设备名查找）\n");
+    printf("      --queue-depth <n> 采集到发送的排队帧数（默认%d）\n", FRAME_QUEUE_DEPTH);
+    printf("      --uvc-queue <n> UVC队列中最多同时排队的帧数（默认不限制，越少延迟越低）\n");
+    printf("      --transfer <t> 视频流端点: iso(默认，预留等时带宽) | bulk(批量传输，需要内核支持streaming_bulk)\n");
+    printf("  -p, --pipeline <p> PL流水线: rgba(默认，VPSS转RGB) | yuv422(VPSS直通，2字节/像素)\n");
+    printf("                     | raw16(传感器原始16位数据，只能输出y16)\n");
+    printf("  -m, --io <mode>    传输方式: userptr(原生格式且u-dma-buf时默认，零拷贝) | mmap(转换格式默认) | write(不带时间戳)\n");
+    printf("  -F, --format <fmt> 输出格式: rgba | yuyv | nv12 | h264 | y16（默认为流水线原生格式）\n");
+    printf("  -c, --csc <std>    色彩矩阵（CPU转换与VPSS CSC共用）: bt601(默认) | bt709\n");
+    printf("  -u, --udmabuf <名称> 帧缓冲使用u-dma-buf可缓存映射（如udmabuf0）\n");
+    printf("  -r, --roi <x,y,w,h> 只发送采集帧中的窗口（setup_uvc.sh需传入相同的选项）\n");
+    printf("  -B, --binning      2x2像素合并，输出尺寸减半\n");
+    printf("  -E, --encoder <dev> h264输出使用的VCU编码器设备（默认%s）\n", ENCODER_DEVICE);
+    printf("  -b, --bitrate <kbps> h264目标码率（默认%d）\n", ENCODER_BITRATE_KBPS);
+    printf("  -C, --capture-cpu <n>  采集线程绑定的CPU核\n");
+    printf("  -T, --tx-cpu <n>   发送线程绑定的CPU核\n");
+    printf("  -R, --rt-prio <n>  两个线程使用SCHED_FIFO实时优先级（1-99，采集线程高1级）\n");
+    printf("      --verify       校验模式：检查发送的帧在持有期间是否被VDMA改写，计入统计页\n");
+    printf("      --stamp        在每帧开头写入VDMA帧序号和时间戳（主机端uvc-host-bench读取），不支持h264\n");
+    printf("      --keep-pl      没有主机取流时不停止VPSS/VDMA（默认停止，省DDR带宽）\n");
+    printf("      --daemon       后台常驻：先启动PL流水线并保持运行（USB挂起时停止），UVC Gadget设备出现后再应答主机\n");
+    printf("      --stats        打印运行中进程的延迟统计后退出\n");
+    printf("      --descriptors  按当前参数输出UVC Gadget描述符后退出（setup_uvc.sh使用）\n");
+    printf("      --help         显示帮助\n");
+}
 
 /**
- * 初始化UVC设备
- * 
- * @param device UVC设备路径（通常是/dev/video0）
- * @return 0成功，-1失败
+ * 检查ROI窗口并换算UVC帧描述符
+ *
+ * 只合并不裁剪时窗口为整帧；窗口必须在采集帧内，x和宽度按YUYV宏像素对齐，
+ * 合并后的尺寸仍须为偶数（NV12）。
+ *
+ * @return 0成功，-1窗口无效
  */
-int uvc_init(const char *device)
+static int check_roi(void)
 {
-    struct v4l2_format fmt;
+    if (roi.width == 0 && roi.binning == 1) {
+        return 0;
+    }
     
-    printf("打开UVC设备: %s\n", device);
+    if (roi.width == 0) {
+        roi.width = capture_width;
+        roi.height = capture_height;
+    }
     
-    uvc_fd = open(device, O_RDWR | O_NONBLOCK);
-    if (uvc_fd < 0) {
-        perror("打开UVC设备失败");
-        fprintf(stderr, "提示: 请先运行 setup_uvc.sh 配置UVC Gadget\n");
+    int align = 2 * roi.binning;
+    if (roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0 ||
+        roi.x + roi.width > capture_width || roi.y + roi.height > capture_height) {
+        fprintf(stderr, "ROI %d,%d,%dx%d 超出采集帧 %dx%d\n", roi.x, roi.y,
+                roi.width, roi.height, capture_width, capture_height);
+        return -1;
+    }
+    if (roi.x % 2 || roi.width % align || roi.height % align) {
+        fprintf(stderr, "ROI的x须为偶数，宽度和高度须为%d的倍数\n", align);
         return -1;
     }
     
-    /* 设置视频格式 - RGBA格式（不压缩） */
-    memset(&fmt, 0, sizeof(fmt));
-    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
-    fmt.fmt.pix.width = VIDEO_WIDTH;
-    fmt.fmt.pix.height = VIDEO_HEIGHT;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_ABGR32;  /* RGBA格式 */
-    fmt.fmt.pix.field = V4L2_FIELD_NONE;
-    fmt.fmt.pix.sizeimage = VIDEO_WIDTH * VIDEO_HEIGHT * 4;  /* RGBA: 4 bytes/pixel */
+    uvc_frames[0].width = roi.width / roi.binning;
+    uvc_frames[0].height = roi.height / roi.binning;
+    
+    return 0;
+}
+
+/**
+ * 是否启用ROI（裁剪或合并）
+ */
+static int roi_active(void)
+{
+    return roi.width > 0;
+}
+
+/**
+ * 比特流带VPSS缩放器时通告采集尺寸的1/2和1/4（宽高取偶数），主机选择后
+ * start_streaming()按提交的尺寸重配PL
+ *
+ * ROI模式只通告ROI输出尺寸；raw16是传感器原始样本，不经缩放器插值。
+ * 只读sysfs判断，--descriptors在没有加载PL时也能生成同样的描述符。
+ */
+static void add_scaled_frames(void)
+{
+    num_uvc_frames = 1;
+    
+    if (roi_active() || pipeline == PIPE_RAW16 || vpss_probe_scaler(vpss_device) != 1) {
+        return;
+    }
+    
+    for (int div = 2; div <= 4 && num_uvc_frames < MAX_UVC_FRAMES; div *= 2) {
+        uvc_frame_info_t *frame = &uvc_frames[num_uvc_frames];
+        
+        *frame = uvc_frames[0];
+        frame->width = capture_width / div & ~1;
+        frame->height = capture_height / div & ~1;
+        if (frame->width < 2 || frame->height < 2) {
+            break;
+        }
+        num_uvc_frames++;
+    }
+}
+
+/**
+ * 帧缓冲中的数据能否原样发送：原生格式，行跨度没有填充，且ROI（如有）是整行的连续区域
+ */
+static int frame_passthrough(void)
+{
+    int bpp = pipelines[pipeline].bytes_per_pixel;
+    int width = vdma.frame_buffer ? vdma.width : capture_width;
+    
+    if (out_format != pipelines[pipeline].native_format ||
+        vdma_calc_stride(width, bpp) != (uint32_t)width * bpp) {
+        return 0;
+    }
+    
+    return !roi_active() || (roi.binning == 1 && roi.width == capture_width);
+}
+
+/**
+ * 发送给主机的宽度和高度
+ */
+static int out_width(void)
+{
+    return roi_active() ? roi.width / roi.binning : vdma.width;
+}
+
+static int out_height(void)
+{
+    return roi_active() ? roi.height / roi.binning : vdma.height;
+}
+
+/**
+ * 帧缓冲中发送窗口的起始地址
+ */
+static const uint8_t *roi_source(const uint8_t *src_frame)
+{
+    if (!roi_active()) {
+        return src_frame;
+    }
+    
+    int bpp = pipelines[pipeline].bytes_per_pixel;
+    return src_frame + (size_t)roi.y * vdma.stride + (size_t)roi.x * bpp;
+}
+
+/* 命令行长选项，配置文件的键名与之相同 */
+static const struct option long_opts[] = {
+    { "config",  required_argument, NULL, 'K' },
+    { "width",   required_argument, NULL, 'w' },
+    { "height",  required_argument, NULL, 'H' },
+    { "fps",     required_argument, NULL, 'f' },
+    { "idle-fps", required_argument, NULL, 'Z' },
+    { "scene-threshold", required_argument, NULL, 'J' },
+    { "frames",  required_argument, NULL, 'n' },
+    { "fb-phys", required_argument, NULL, 'P' },
+    { "uvc-device", required_argument, NULL, 'd' },
+    { "instance", required_argument, NULL, 'I' },
+    { "vdma",    required_argument, NULL, 'V' },
+    { "vpss",    required_argument, NULL, 'Y' },
+    { "queue-depth", required_argument, NULL, 'Q' },
+    { "uvc-queue", required_argument, NULL, 'U' },
+    { "transfer", required_argument, NULL, 'X' },
+    { "pipeline", required_argument, NULL, 'p' },
+    { "io",      required_argument, NULL, 'm' },
+    { "udmabuf", required_argument, NULL, 'u' },
+    { "format",  required_argument, NULL, 'F' },
+    { "csc",     required_argument, NULL, 'c' },
+    { "roi",     required_argument, NULL, 'r' },
+    { "binning", no_argument,       NULL, 'B' },
+    { "encoder", required_argument, NULL, 'E' },
+    { "bitrate", required_argument, NULL, 'b' },
+    { "capture-cpu", required_argument, NULL, 'C' },
+    { "tx-cpu",  required_argument, NULL, 'T' },
+    { "rt-prio", required_argument, NULL, 'R' },
+    { "verify",  no_argument,       NULL, 'W' },
+    { "stamp",   no_argument,       NULL, 'M' },
+    { "daemon",  no_argument,       NULL, 'D' },
+    { "keep-pl", no_argument,       NULL, 'L' },
+    { "stats",   no_argument,       NULL, 'S' },
+    { "descriptors", no_argument,   NULL, 'G' },
+    { "help",    no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+};
+#define SHORT_OPTS "w:H:f:n:d:p:m:u:F:c:r:BE:b:C:T:R:"
+
+/**
+ * 解析一个整数参数
+ *
+ * @param arg 参数字符串（支持0x前缀）
+ * @param min 最小值
+ * @param max 最大值
+ * @param name 参数名（出错时打印）
+ * @param val 解析结果
+ * @return 0成功，-1无效
+ */
+static int parse_int(const char *arg, long min, long max, const char *name, long *val)
+{
+    char *end;
     
-    if (ioctl(uvc_fd, VIDIOC_S_FMT, &fmt) < 0) {
-        perror("设置视频格式失败");
-        close(uvc_fd);
-        uvc_fd = -1;
+    errno = 0;
+    *val = strtol(arg, &end, 0);
+    if (errno || end == arg || *end != '\0' || *val < min || *val > max) {
+        fprintf(stderr, "%s无效: %s（%ld ~ %ld）\n", name, arg, min, max);
         return -1;
     }
     
-    printf("UVC格式设置完成: %dx%d RGBA\n", 
-           fmt.fmt.pix.width, fmt.fmt.pix.height);
+    return 0;
+}
+
+/**
+ * 应用一个选项（命令行和配置文件共用）
+ *
+ * @param opt 选项字符
+ * @param arg 选项参数（配置文件中的字符串会被复制）
+ * @return 0成功，-1参数错误
+ */
+static int apply_option(int opt, const char *arg)
+{
+    long val;
+    
+    switch (opt) {
+    case 'w':
+        if (parse_int(arg, 16, VPSS_SCALER_MAX_WIDTH, "宽度", &val) < 0) return -1;
+        capture_width = val;
+        break;
+    case 'H':
+        if (parse_int(arg, 16, 2160, "高度", &val) < 0) return -1;
+        capture_height = val;
+        break;
+    case 'f':
+        if (parse_int(arg, 0, 240, "帧率上限", &val) < 0) return -1;
+        max_fps = val;
+        break;
+    case 'Z':
+        if (parse_int(arg, 0, 240, "保活帧率", &val) < 0) return -1;
+        idle_fps = val;
+        break;
+    case 'J':
+        if (parse_int(arg, 0, 65535, "静止判定阈值", &val) < 0) return -1;
+        scene_threshold = val;
+        break;
+    case 'n':
+        if (parse_int(arg, 2, VDMA_MAX_FRAME_STORES < UVC_MAX_BUFFERS ?
+                      VDMA_MAX_FRAME_STORES : UVC_MAX_BUFFERS, "帧缓冲数", &val) < 0) return -1;
+        num_frames = val;
+        break;
+    case 'P':
+        if (parse_int(arg, 0, 0xFFFFFFFFL, "帧缓冲物理地址", &val) < 0) return -1;
+        frame_buffer_phys = (uint32_t)val;
+        break;
+    case 'd':
+        uvc_device = strdup(arg);
+        break;
+    case 'I':
+        if (parse_int(arg, 0, 7, "实例编号", &val) < 0) return -1;
+        instance = val;
+        break;
+    case 'V':
+        vdma_device = strdup(arg);
+        break;
+    case 'Y':
+        vpss_device = strdup(arg);
+        break;
+    case 'Q':
+        if (parse_int(arg, 1, FRAME_RING_SLOTS, "队列深度", &val) < 0) return -1;
+        queue_depth = val;
+        break;
+    case 'U':
+        if (parse_int(arg, 0, UVC_MAX_BUFFERS, "UVC队列深度", &val) < 0) return -1;
+        uvc_queue_limit = val;
+        break;
+    case 'X':
+        if (strcmp(arg, "iso") == 0) {
+            bulk_transfer = 0;
+        } else if (strcmp(arg, "bulk") == 0) {
+            bulk_transfer = 1;
+        } else {
+            fprintf(stderr, "未知传输类型: %s\n", arg);
+            return -1;
+        }
+        break;
+    case 'm':
+        if (strcmp(arg, "userptr") == 0) {
+            io_mode_option = UVC_IO_USERPTR;
+        } else if (strcmp(arg, "mmap") == 0) {
+            io_mode_option = UVC_IO_MMAP;
+        } else if (strcmp(arg, "write") == 0) {
+            io_mode_option = UVC_IO_WRITE;
+        } else {
+            fprintf(stderr, "未知传输方式: %s\n", arg);
+            return -1;
+        }
+        io_mode_set = 1;
+        break;
+    case 'p':
+        if (strcmp(arg, "rgba") == 0) {
+            pipeline = PIPE_RGBA;
+        } else if (strcmp(arg, "yuv422") == 0) {
+            pipeline = PIPE_YUV422;
+        } else if (strcmp(arg, "raw16") == 0) {
+            pipeline = PIPE_RAW16;
+        } else {
+            fprintf(stderr, "未知流水线模式: %s\n", arg);
+            return -1;
+        }
+        break;
+    case 'F': {
+        int found = 0;
+        for (int i = 0; i < OUT_FMT_COUNT; i++) {
+            if (strcmp(arg, out_formats[i].name) == 0) {
+                out_format = (out_format_t)i;
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "未知输出格式: %s\n", arg);
+            return -1;
+        }
+        out_format_set = 1;
+        break;
+    }
+    case 'c':
+        if (strcmp(arg, "bt601") == 0) {
+            csc_standard = CSC_BT601;
+        } else if (strcmp(arg, "bt709") == 0) {
+            csc_standard = CSC_BT709;
+        } else {
+            fprintf(stderr, "未知色彩矩阵: %s\n", arg);
+            return -1;
+        }
+        break;
+    case 'u':
+        udmabuf_name = strdup(arg);
+        break;
+    case 'r':
+        if (sscanf(arg, "%d,%d,%d,%d", &roi.x, &roi.y, &roi.width, &roi.height) != 4) {
+            fprintf(stderr, "ROI格式应为 x,y,w,h: %s\n", arg);
+            return -1;
+        }
+        break;
+    case 'B':
+        roi.binning = 2;
+        break;
+    case 'W':
+        verify_frames = 1;
+        break;
+    case 'M':
+        stamp_frames = 1;
+        break;
+    case 'D':
+        daemon_mode = 1;
+        break;
+    case 'L':
+        keep_pl_running = 1;
+        break;
+    case 'E':
+        encoder_device = strdup(arg);
+        break;
+    case 'b':
+        if (parse_int(arg, 1, 1000000, "码率", &val) < 0) return -1;
+        encoder_bitrate = (uint32_t)val * 1000;
+        break;
+    case 'C':
+        if (parse_int(arg, -1, CPU_SETSIZE - 1, "采集线程CPU", &val) < 0) return -1;
+        capture_cpu = val;
+        break;
+    case 'T':
+        if (parse_int(arg, -1, CPU_SETSIZE - 1, "发送线程CPU", &val) < 0) return -1;
+        transmit_cpu = val;
+        break;
+    case 'R':
+        if (parse_int(arg, 0, 98, "实时优先级", &val) < 0) return -1;
+        rt_priority = val;
+        break;
+    default:
+        return -1;
+    }
     
     return 0;
 }
 
 /**
- * 主循环：读取帧并发送到UVC
+ * 按输出格式选择本次取流的传输方式
+ *
+ * 需要格式转换、水平裁剪或合并时无法直接入队VDMA帧缓冲，userptr改为mmap；
+ * 帧缓冲通过/dev/mem映射时也不能USERPTR入队（见vdma_userptr_capable()）。
+ *
+ * @param verbose -m指定的传输方式被改变时是否提示
  */
-int main_loop()
+static void select_io_mode(int verbose)
 {
-    /* 不再需要额外的缓冲区，直接从VDMA帧缓冲发送RGBA数据 */
+    io_mode = io_mode_option;
     
-    int frame_count = 0;
-    int last_vdma_frame = -1;
-    struct timespec start_time, current_time;
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    if (!frame_passthrough() && io_mode == UVC_IO_USERPTR) {
+        if (verbose) {
+            fprintf(stderr, "提示: %s输出需要CPU处理，传输方式改为mmap\n",
+                    out_formats[out_format].name);
+        }
+        io_mode = UVC_IO_MMAP;
+    }
     
-    printf("\n开始视频流传输...\n");
-    printf("分辨率: %dx%d@%dfps (RGBA格式)\n", VIDEO_WIDTH, VIDEO_HEIGHT, TARGET_FPS);
-    printf("按Ctrl+C退出\n\n");
+    if (io_mode == UVC_IO_USERPTR && vdma.frame_buffer && !vdma_userptr_capable(&vdma)) {
+        io_mode = UVC_IO_MMAP;
+    }
+}
+
+/**
+ * 流水线能否输出该格式
+ *
+ * yuv422流水线不能还原RGB，原始样本不是像素颜色不能做任何格式转换；
+ * h264需要打开VCU编码器，只在-F h264时通告。
+ */
+static int format_supported(out_format_t format)
+{
+    if (format == OUT_FMT_H264) {
+        return out_format == OUT_FMT_H264;
+    }
+    if ((pipeline == PIPE_RAW16) != (format == OUT_FMT_Y16)) {
+        return 0;
+    }
+    return !(pipeline == PIPE_YUV422 && format == OUT_FMT_RGBA);
+}
+
+/**
+ * 生成通告给主机的格式表：-F选择的格式排第一（主机默认），其后是流水线能输出的其他格式
+ */
+static void build_uvc_formats(void)
+{
+    num_uvc_formats = 0;
+    uvc_formats[num_uvc_formats++] = out_formats[out_format];
     
-    while (running) {
-        /* 获取VDMA当前写入的帧 */
-        int current_vdma_frame = vdma_get_current_frame(&vdma);
-        
-        /* 选择一个不同的帧读取（避免读写冲突） */
-        int read_frame = (current_vdma_frame + 1) % NUM_FRAMES;
-        
-        /* 如果帧没有变化，跳过（避免重复读取） */
-        if (current_vdma_frame == last_vdma_frame && frame_count > 0) {
-            usleep(1000);  /* 短暂等待 */
+    for (int i = 0; i < OUT_FMT_COUNT; i++) {
+        if (i != (int)out_format && format_supported((out_format_t)i)) {
+            uvc_formats[num_uvc_formats++] = out_formats[i];
+        }
+    }
+}
+
+/**
+ * 配置文件中的一项：按长选项名查找后应用
+ */
+static int apply_config_entry(const char *key, const char *value)
+{
+    for (const struct option *o = long_opts; o->name; o++) {
+        if (strcmp(o->name, key) != 0) {
             continue;
         }
-        last_vdma_frame = current_vdma_frame;
         
-        /* 从帧缓冲读取RGBA数据 */
-        const uint8_t *rgba_frame = (uint8_t*)vdma.frame_buffer + (read_frame * FRAME_SIZE);
-        
-        /* 直接发送RGBA数据到UVC设备 */
-        ssize_t written = write(uvc_fd, rgba_frame, FRAME_SIZE);
-        if (written < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                /* 非阻塞写入，缓冲区满，稍后重试 */
-                usleep(1000);
-                continue;
-            } else {
-                perror("写入UVC设备失败");
-                break;
-            }
+        /* 只影响当前进程的动作不能写在配置文件里 */
+        if (o->val == 'K' || o->val == 'S' || o->val == 'G' || o->val == 'h') {
+            return -1;
         }
         
-        frame_count++;
-        
-        /* 每60帧打印一次统计信息 */
-        if (frame_count % 60 == 0) {
-            clock_gettime(CLOCK_MONOTONIC, &current_time);
-            double elapsed = (current_time.tv_sec - start_time.tv_sec) + 
-                           (current_time.tv_nsec - start_time.tv_nsec) / 1e9;
-            double fps = frame_count / elapsed;
-            
-            printf("已发送 %d 帧 (读取帧%d, VDMA写帧%d, 实际FPS: %.1f)\n", 
-                   frame_count, read_frame, current_vdma_frame, fps);
+        if (o->has_arg == no_argument) {
+            /* 开关选项：1/yes/true打开，0/no/false保持默认 */
+            if (strcmp(value, "1") == 0 || strcmp(value, "yes") == 0 || strcmp(value, "true") == 0) {
+                return apply_option(o->val, value);
+            }
+            return strcmp(value, "0") == 0 || strcmp(value, "no") == 0 ||
+                   strcmp(value, "false") == 0 ? 0 : -1;
         }
         
-        /* 控制帧率（60fps = 16666us per frame） */
-        usleep(FRAME_INTERVAL_US);
+        return apply_option(o->val, value);
     }
     
-    printf("\n总共发送 %d 帧\n", frame_count);
-    
-    return 0;
+    fprintf(stderr, "未知配置项: %s\n", key);
+    return -1;
 }
 
 /**
- * 主函数
+ * 解析命令行参数
+ *
+ * 先读取配置文件（--config指定，默认CONFIG_FILE，不存在时忽略），
+ * 命令行选项再覆盖配置文件中的值。
+ *
+ * @return 0继续运行，1已显示帮助，-1参数错误
  */
-int main(int argc, char **argv)
+static int parse_args(int argc, char **argv)
 {
-    int ret = 0;
+    const char *config_path = CONFIG_FILE;
+    int config_set = 0;
+    int dump_stats = 0;
+    int print_descriptors = 0;
+    int opt;
+
+    /* 忽略未识别的选项（run_uvc.sh会传入--test等参数） */
+    opterr = 0;
+
+    /* 第一遍只找--config */
+    while ((opt = getopt_long(argc, argv, SHORT_OPTS, long_opts, NULL)) != -1) {
+        if (opt == 'K') {
+            config_path = optarg;
+            config_set = 1;
+        }
+    }
     
-    printf("========================================\n");
-    printf("USB UVC Camera Application\n");
-    printf("Xilinx Zynq UltraScale+ MPSoC\n");
-    printf("IR Camera over USB3.0\n");
-    printf("========================================\n\n");
+    int ret = config_file_load(config_path, apply_config_entry);
+    if (ret < 0 || (ret == 1 && config_set)) {
+        if (ret == 1) {
+            fprintf(stderr, "配置文件不存在: %s\n", config_path);
+        }
+        return -1;
+    }
+    if (ret == 0) {
+        printf("已读取配置文件: %s\n", config_path);
+    }
+
+    optind = 0;
+    while ((opt = getopt_long(argc, argv, SHORT_OPTS, long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'K':
+            break;
+        case 'S':
+            dump_stats = 1;
+            break;
+        case 'G':
+            print_descriptors = 1;
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 1;
+        case '?':
+            fprintf(stderr, "警告: 忽略未识别的选项 %s\n", argv[optind - 1]);
+            break;
+        default:
+            if (apply_option(opt, optarg) < 0) {
+                return -1;
+            }
+            break;
+        }
+    }
+
+    if (dump_stats) {
+        return frame_stats_dump(instance) < 0 ? -1 : 1;
+    }
     
-    /* 注册信号处理 */
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    if (!out_format_set) {
+        out_format = pipelines[pipeline].native_format;
+    }
     
-    /* 初始化VPSS */
-    printf("[1/4] 初始化VPSS...\n");
-    if (vpss_init(&vpss, VIDEO_WIDTH, VIDEO_HEIGHT) < 0) {
-        fprintf(stderr, "VPSS初始化失败\n");
-        ret = 1;
-        goto cleanup;
+    if (pipeline == PIPE_YUV422 && out_format == OUT_FMT_RGBA) {
+        fprintf(stderr, "yuv422流水线不支持rgba输出\n");
+        return -1;
     }
     
-    /* 初始化VDMA */
-    printf("\n[2/4] 初始化VDMA...\n");
-    if (vdma_init(&vdma, VIDEO_WIDTH, VIDEO_HEIGHT, 
-                  BYTES_PER_PIXEL, NUM_FRAMES,
-                  FRAME_BUFFER_PHYS) < 0) {
-        fprintf(stderr, "VDMA初始化失败\n");
-        ret = 1;
-        goto cleanup;
+    /* 原始样本不是像素颜色，不做任何格式转换 */
+    if ((pipeline == PIPE_RAW16) != (out_format == OUT_FMT_Y16)) {
+        fprintf(stderr, "y16输出只能配合raw16流水线，raw16流水线也只能输出y16\n");
+        return -1;
     }
     
-    /* 先启动VDMA（接收端） */
-    printf("\n[3/4] 启动VDMA...\n");
-    if (vdma_start(&vdma) < 0) {
-        fprintf(stderr, "VDMA启动失败\n");
-        ret = 1;
-        goto cleanup;
+    if (out_format == OUT_FMT_H264 && io_mode_option == UVC_IO_WRITE) {
+        fprintf(stderr, "h264输出只支持mmap传输方式\n");
+        return -1;
     }
     
-    /* 再启动VPSS（发送端） */
-    printf("\n[4/4] 启动VPSS...\n");
-    usleep(10000);
-    if (vpss_start(&vpss) < 0) {
-        fprintf(stderr, "VPSS启动失败\n");
-        ret = 1;
-        goto cleanup;
+    if (stamp_frames && out_format == OUT_FMT_H264) {
+        fprintf(stderr, "h264码流不能写入帧内时间戳（--stamp）\n");
+        return -1;
+    }
+    
+    if (capture_width % 2) {
+        fprintf(stderr, "宽度必须为偶数: %d\n", capture_width);
+        return -1;
     }
     
-    /* 等待数据流稳定 */
-    printf("\n等待视频流稳定...\n");
-    sleep(1);
+    /* VDMA写入1帧、发送线程持有1帧，其余用于排队 */
+    if (queue_depth > num_frames - 2) {
+        fprintf(stderr, "队列深度%d需要至少%d个帧缓冲\n", queue_depth, queue_depth + 2);
+        return -1;
+    }
     
-    /* 初始化UVC */
-    printf("\n初始化UVC设备...\n");
-    if (uvc_init(UVC_DEVICE) < 0) {
-        fprintf(stderr, "UVC初始化失败\n");
-        fprintf(stderr, "提示: 请先运行 setup_uvc.sh 配置UVC Gadget\n");
-        ret = 1;
-        goto cleanup;
+    uvc_frames[0].width = capture_width;
+    uvc_frames[0].height = capture_height;
+    
+    if (check_roi() < 0) {
+        return -1;
     }
+    add_scaled_frames();
     
-    /* 主循环 */
-    ret = main_loop();
+    select_io_mode(io_mode_set);
+    build_uvc_formats();
     
-cleanup:
-    printf("\n清理资源...\n");
+    /* 批量端点没有预留带宽，只有一帧在驱动中时传完到下一帧入队之间端点空闲，
+     * 至少保持两帧排队；USERPTR下排队的帧都占用VDMA帧缓冲 */
+    if (bulk_transfer) {
+        if (uvc_queue_limit == 1) {
+            fprintf(stderr, "提示: 批量传输至少需要2帧排队，--uvc-queue改为2\n");
+            uvc_queue_limit = 2;
+        }
+        int queued = uvc_queue_limit > 0 ? uvc_queue_limit : 2;
+        if (io_mode == UVC_IO_USERPTR && num_frames < queue_depth + queued + 2) {
+            fprintf(stderr, "提示: USERPTR批量传输建议至少%d个帧缓冲（-n），否则VDMA可能没有空闲帧缓冲\n",
+                    queue_depth + queued + 2);
+        }
+    }
+    
+    if (uvc_descriptor_calc_ep(uvc_formats, num_uvc_formats, uvc_frames, num_uvc_frames,
+                               encoder_bitrate, bulk_transfer, &streaming_ep) > 0) {
+        fprintf(stderr, "警告: 最大码率%.1f MB/s超过超高速等时端点上限\n",
+                streaming_ep.bytes_per_sec / 1e6);
+    }
+    
+    if (print_descriptors) {
+        uvc_descriptor_print(stdout, uvc_formats, num_uvc_formats, uvc_frames, num_uvc_frames,
+                             encoder_bitrate, &streaming_ep);
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * 一行数据的哈希（FNV-1a，按32位字）
+ */
+static uint32_t line_hash(const uint8_t *line, int bytes)
+{
+    const uint32_t *word = (const uint32_t *)line;
+    uint32_t hash = 2166136261u;
+    
+    for (int i = 0; i < bytes / 4; i++) {
+        hash = (hash ^ word[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * 校验用的行哈希：--stamp写在帧缓冲里的帧内时间戳不计入
+ */
+static uint32_t verify_line_hash(const uint8_t *line, int bytes)
+{
+    int skip = stamp_frames ? FRAME_STAMP_SIZE : 0;
+    
+    return line_hash(line + skip, bytes - skip);
+}
+
+/**
+ * 校验模式：记录帧的首行、末行哈希和帧序号（采集线程持有帧后调用）
+ *
+ * 这时还在帧消隐期内，新的停靠指针要到下一帧开始才生效，WrFrmStore仍指向刚完成的
+ * 这个帧缓冲，不能用来判断是否正在被写入。
+ *
+ * @param frame VDMA帧编号
+ */
+static void snapshot_frame(int frame)
+{
+    const uint8_t *src_frame = (uint8_t*)vdma.frame_buffer + (frame * vdma.frame_size);
+    int row_bytes = vdma.width * vdma.bytes_per_pixel;
+    
+    frame_snapshot[frame].vdma_seq = vdma.sequence;
+    vdma_cache_invalidate(&vdma, frame);
+    frame_snapshot[frame].head = verify_line_hash(src_frame, row_bytes);
+    frame_snapshot[frame].tail = verify_line_hash(src_frame + (size_t)(vdma.height - 1) * vdma.stride, row_bytes);
+    frame_snapshot[frame].seq = vdma.frame_seq[frame];
+}
+
+/**
+ * 帧已发送完毕，归还VDMA
+ *
+ * 校验模式下先与持有时的快照比较：首行或末行内容变化、帧序号变化，或持有之后
+ * VDMA又完成过帧而WrFrmStore仍指向这个帧缓冲（下一帧开始后停靠指针已经生效，
+ * DMA不应再写它），说明帧在发送期间被DMA改写（停靠/持有逻辑失效），计为损坏帧。
+ *
+ * @param frame VDMA帧编号
+ */
+static void release_sent_frame(int frame)
+{
+    if (verify_frames) {
+        const uint8_t *src_frame = (uint8_t*)vdma.frame_buffer + (frame * vdma.frame_size);
+        int row_bytes = vdma.width * vdma.bytes_per_pixel;
+        int writing = vdma.sequence != frame_snapshot[frame].vdma_seq &&
+                      vdma_get_current_frame(&vdma) == frame;
+        
+        vdma_cache_invalidate(&vdma, frame);
+        int head = verify_line_hash(src_frame, row_bytes) != frame_snapshot[frame].head;
+        int tail = verify_line_hash(src_frame + (size_t)(vdma.height - 1) * vdma.stride, row_bytes) !=
+                   frame_snapshot[frame].tail;
+        int seq = vdma.frame_seq[frame] != frame_snapshot[frame].seq;
+        
+        frame_stats_add(&frame_stats->frames_verified, 1);
+        if (writing || head || tail || seq) {
+            stats.corrupt++;
+            frame_stats_add(&frame_stats->frames_corrupt, 1);
+            if (stats.corrupt <= VERIFY_REPORT_LIMIT) {
+                fprintf(stderr, "校验失败: 帧缓冲%d 序号%u%s%s%s%s\n", frame,
+                        frame_snapshot[frame].seq, head ? " 首行变化" : "", tail ? " 末行变化" : "",
+                        seq ? " 序号变化" : "", writing ? " VDMA正在写入" : "");
+            }
+        }
+    }
+    
+    vdma_release(&vdma, frame);
+}
+
+/**
+ * 回收USB传输完成的UVC缓冲
+ */
+static void reclaim_buffers(void)
+{
+    int index;
     
-    if (uvc_fd >= 0) {
-        close(uvc_fd);
+    /* 缓冲编号即VDMA帧编号，发送完毕后交还给VDMA */
+    while ((index = uvc_dequeue(&uvc)) >= 0) {
+        uint64_t now = frame_stats_now();
+        frame_stats_record(&frame_stats->hist[STAGE_TRANSFER], buf_queued_ns[index], now);
+        frame_stats_record(&frame_stats->hist[STAGE_TOTAL], buf_frame_done_ns[index], now);
+        
+        if (io_mode == UVC_IO_USERPTR) {
+            release_sent_frame(index);
+        }
     }
+}
+
+/**
+ * 输出帧大小（字节）
+ */
+static size_t out_frame_size(void)
+{
+    return (size_t)out_width() * out_height() * out_formats[out_format].bits_per_pixel / 8;
+}
+
+/**
+ * 按流水线模式配置VPSS：YUV422输入，输出RGB或直通，输出分辨率可由缩放器调整
+ *
+ * @param out_width 输出宽度
+ * @param out_height 输出高度
+ * @return 0成功，-1失败
+ */
+static int configure_vpss(int out_width, int out_height)
+{
+    vpss_config_t config = {
+        .in_width = capture_width,
+        .in_height = capture_height,
+        .out_width = out_width,
+        .out_height = out_height,
+        .in_format = VPSS_FORMAT_YUV422,
+    };
+    
+    if (pipeline == PIPE_YUV422 || pipeline == PIPE_RAW16) {
+        config.out_format = VPSS_FORMAT_YUV422;
+        config.matrix = VPSS_CSC_IDENTITY;
+    } else {
+        config.out_format = VPSS_FORMAT_RGB;
+        config.matrix = csc_standard == CSC_BT709 ? VPSS_CSC_BT709 : VPSS_CSC_BT601;
+    }
+    
+    return vpss_configure(&vpss, &config);
+}
+
+/**
+ * 把帧缓冲中的原生格式转换为输出格式（h264输出时转换为编码器的NV12输入）
+ *
+ * 先按ROI裁剪和合并：输出为原生格式时直接写入dst，否则合并到中间缓冲后再转换。
+ *
+ * @param dst 输出缓冲
+ * @param uv_offset NV12色度平面在输出缓冲中的偏移
+ * @param src_frame VDMA帧
+ */
+static void convert_frame(uint8_t *dst, size_t uv_offset, const uint8_t *src_frame)
+{
+    int width = out_width();
+    int height = out_height();
+    int bpp = pipelines[pipeline].bytes_per_pixel;
+    int stride = vdma.stride;
+    const uint8_t *src = roi_source(src_frame);
+    uint8_t *dst_uv = dst + uv_offset;
+    int native = out_format == pipelines[pipeline].native_format;
+    
+    if (roi.binning == 2) {
+        uint8_t *binned = native ? dst : bin_buffer;
+        if (pipeline == PIPE_RAW16) {
+            convert_bin2x2_y16(binned, src, width, height, stride);
+        } else if (pipeline == PIPE_YUV422) {
+            convert_bin2x2_yuyv(binned, src, width, height, stride);
+        } else {
+            convert_bin2x2_rgba(binned, src, width, height, stride);
+        }
+        if (native) {
+            return;
+        }
+        src = bin_buffer;
+        stride = width * bpp;
+    } else if (native) {
+        convert_copy_rows(dst, src, width * bpp, height, stride);
+        return;
+    }
+    
+    if (pipeline == PIPE_YUV422) {
+        /* 原生YUYV只需要转换到NV12 */
+        convert_yuyv_to_nv12(dst, dst_uv, src, width, height, stride);
+    } else if (out_format == OUT_FMT_YUYV) {
+        convert_rgba_to_yuyv(dst, src, width, height, stride, csc_standard);
+    } else {
+        convert_rgba_to_nv12(dst, dst_uv, src, width, height, stride, csc_standard);
+    }
+}
+
+/**
+ * 记录一帧交给UVC的时间
+ *
+ * @param index UVC缓冲编号，write方式下为-1
+ * @param done_ns 帧的VDMA完成时间
+ * @param acquire_ns 帧被采集线程持有的时间
+ * @param bytes 帧数据长度
+ */
+static void note_queued(int index, uint64_t done_ns, uint64_t acquire_ns, size_t bytes)
+{
+    uint64_t now = frame_stats_now();
+    
+    stats.bytes += bytes;
+    frame_stats_record(&frame_stats->hist[STAGE_PROCESS], acquire_ns, now);
+    if (index >= 0) {
+        buf_frame_done_ns[index] = done_ns;
+        buf_queued_ns[index] = now;
+    }
+}
+
+/**
+ * 编码一帧并把码流放入UVC缓冲（帧由调用者持有，这里负责释放）
+ *
+ * 先确认UVC有空闲缓冲再送入编码器：UVC队列满时等待的是原始帧，
+ * 码流连续，不需要等待下一个IDR帧。
+ *
+ * @param read_frame VDMA帧编号
+ * @return 0已发送，1 UVC队列满（帧仍由调用者持有），2编码器丢弃了这一帧，-1失败
+ */
+static int encode_frame(int read_frame)
+{
+    const uint8_t *src_frame = (uint8_t*)vdma.frame_buffer + (read_frame * vdma.frame_size);
+    uint64_t done_ns = vdma.frame_time_ns[read_frame];
+    uint64_t acquire_ns = frame_acquire_ns[read_frame];
+    uint32_t sequence = vdma.frame_seq[read_frame];
+    venc_packet_t packet;
+    
+    int index = uvc_get_free_buffer(&uvc);
+    if (index < 0) {
+        return 1;
+    }
+    
+    int input = venc_get_input(&venc);
+    if (input < 0) {
+        vdma_release(&vdma, read_frame);
+        frame_stats_drop(frame_stats, DROP_ENCODER, 1);
+        return 2;
+    }
+    
+    /* CPU转换直接写入编码器输入缓冲，之后即可归还VDMA帧 */
+    vdma_cache_invalidate(&vdma, read_frame);
+    convert_frame(venc.in_mem[input], venc.uv_offset, src_frame);
+    release_sent_frame(read_frame);
+    
+    int ret = venc_encode(&venc, input, done_ns, ENCODER_TIMEOUT_MS, &packet);
+    if (ret < 0) {
+        return -1;
+    } else if (ret > 0) {
+        frame_stats_drop(frame_stats, DROP_ENCODER, 1);
+        return 2;
+    }
+    
+    if (packet.length > uvc.mem_length[index]) {
+        /* 丢弃一帧码流后后续P帧无法解码，下一帧强制IDR */
+        fprintf(stderr, "警告: 码流%zu字节超过UVC缓冲%zu字节，丢弃\n",
+                packet.length, uvc.mem_length[index]);
+        venc_release_packet(&venc, &packet);
+        venc_force_keyframe(&venc);
+        frame_stats_drop(frame_stats, DROP_ENCODER, 1);
+        return 2;
+    }
+    
+    memcpy(uvc.mem[index], packet.data, packet.length);
+    venc_release_packet(&venc, &packet);
+    
+    if (uvc_queue_buffer(&uvc, index, packet.length, done_ns, sequence) < 0) {
+        return -1;
+    }
+    note_queued(index, done_ns, acquire_ns, packet.length);
+    return uvc_stream_on(&uvc);
+}
+
+/**
+ * --stamp：在转换后的发送数据开头写入帧内时间戳
+ *
+ * @param dst 发送数据
+ * @param read_frame VDMA帧编号
+ */
+static void stamp_output(uint8_t *dst, int read_frame)
+{
+    if (stamp_frames) {
+        frame_stamp_write(dst, vdma.frame_seq[read_frame], vdma.frame_time_ns[read_frame]);
+    }
+}
+
+/**
+ * --stamp：原样发送VDMA帧缓冲时，把帧内时间戳写进帧缓冲中发送窗口的开头
+ *
+ * @param read_frame VDMA帧编号
+ * @param src_frame 帧缓冲映射地址
+ */
+static void stamp_vdma_frame(int read_frame, const uint8_t *src_frame)
+{
+    uint8_t stamp[FRAME_STAMP_SIZE];
+    
+    if (stamp_frames) {
+        frame_stamp_write(stamp, vdma.frame_seq[read_frame], vdma.frame_time_ns[read_frame]);
+        vdma_frame_write(&vdma, read_frame, roi_source(src_frame) - src_frame, stamp, sizeof(stamp));
+    }
+}
+
+/**
+ * 发送一帧（帧由调用者持有，这里负责释放或交给reclaim_buffers()释放）
+ * 
+ * @param read_frame VDMA帧编号
+ * @return 0已发送，1 UVC队列满（帧仍由调用者持有），2编码器丢弃了这一帧，-1失败
+ */
+static int send_frame(int read_frame)
+{
+    const uint8_t *src_frame = (uint8_t*)vdma.frame_buffer + (read_frame * vdma.frame_size);
+    size_t out_size = out_frame_size();
+    uint64_t done_ns = vdma.frame_time_ns[read_frame];
+    uint64_t acquire_ns = frame_acquire_ns[read_frame];
+    uint32_t sequence = vdma.frame_seq[read_frame];
+    int ret;
+    
+    if (out_format == OUT_FMT_H264) {
+        return encode_frame(read_frame);
+    }
+    
+    if (io_mode == UVC_IO_USERPTR) {
+        /* 直接入队VDMA帧缓冲（ROI为整行窗口时从窗口起始行开始），
+         * USB控制器从DDR读取，无CPU拷贝；帧在reclaim_buffers()回收时释放 */
+        stamp_vdma_frame(read_frame, src_frame);
+        if (uvc_queue_userptr(&uvc, read_frame, roi_source(src_frame), out_size,
+                              done_ns, sequence) < 0) {
+            vdma_release(&vdma, read_frame);
+            return -1;
+        }
+        note_queued(read_frame, done_ns, acquire_ns, out_size);
+        return uvc_stream_on(&uvc);
+    }
+    
+    if (io_mode == UVC_IO_MMAP) {
+        int index = uvc_get_free_buffer(&uvc);
+        if (index < 0) {
+            return 1;
+        }
+        
+        /* CPU读取帧，可缓存映射下先丢弃Cache中的旧数据；转换完即可归还VDMA帧 */
+        vdma_cache_invalidate(&vdma, read_frame);
+        convert_frame(uvc.mem[index], (size_t)out_width() * out_height(), src_frame);
+        stamp_output(uvc.mem[index], read_frame);
+        release_sent_frame(read_frame);
+        
+        if (uvc_queue_buffer(&uvc, index, out_size, done_ns, sequence) < 0) {
+            return -1;
+        }
+        note_queued(index, done_ns, acquire_ns, out_size);
+        return uvc_stream_on(&uvc);
+    }
+    
+    /* write()由CPU拷贝，可缓存映射下先丢弃Cache中的旧数据 */
+    vdma_cache_invalidate(&vdma, read_frame);
+    if (frame_passthrough()) {
+        stamp_vdma_frame(read_frame, src_frame);
+        ret = uvc_write_frame(&uvc, roi_source(src_frame), out_size);
+    } else {
+        convert_frame(staging_buffer, (size_t)out_width() * out_height(), src_frame);
+        stamp_output(staging_buffer, read_frame);
+        ret = uvc_write_frame(&uvc, staging_buffer, out_size);
+    }
+    if (ret == 1) {
+        /* 设备忙（EAGAIN），POLLOUT后重试 */
+        return 1;
+    }
+    release_sent_frame(read_frame);
+    
+    if (ret == 0) {
+        note_queued(-1, done_ns, acquire_ns, out_size);
+    }
+    return ret;
+}
+
+/**
+ * 创建周期定时器并加入epoll
+ *
+ * @param interval_ms 周期（毫秒）
+ * @param source 事件来源编号
+ * @return timerfd，失败返回-1
+ */
+static int add_timer(int interval_ms, uint32_t source)
+{
+    struct itimerspec its = {
+        .it_interval = { interval_ms / 1000, (interval_ms % 1000) * 1000000L },
+        .it_value = { interval_ms / 1000, (interval_ms % 1000) * 1000000L },
+    };
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = source };
+    
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        perror("创建定时器失败");
+        return -1;
+    }
+    
+    if (timerfd_settime(fd, 0, &its, NULL) < 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("设置定时器失败");
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+/**
+ * 读取定时器到期次数，清除可读状态
+ */
+static void drain_timer(int fd)
+{
+    uint64_t expirations;
+    
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        perror("读取定时器失败");
+    }
+}
+
+/**
+ * VDMA按IP支持的帧缓冲数减少了帧缓冲时，同步到num_frames并重新检查队列深度
+ *
+ * @return 0成功，-1帧缓冲不够当前的队列深度
+ */
+static int apply_frame_store_limit(void)
+{
+    if (vdma.num_frames == num_frames) {
+        return 0;
+    }
+    
+    num_frames = vdma.num_frames;
+    if (queue_depth > num_frames - 2) {
+        fprintf(stderr, "VDMA只有%d个帧缓冲，队列深度%d需要至少%d个\n",
+                num_frames, queue_depth, queue_depth + 2);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 按新的输出分辨率重配PL：VPSS缩放到目标尺寸，VDMA按新帧大小重新初始化
+ *
+ * @param width 输出宽度
+ * @param height 输出高度
+ * @return 0成功，-1失败
+ */
+static int reconfigure_pipeline(int width, int height)
+{
+    printf("重新配置PL流水线: %dx%d -> %dx%d\n", vdma.width, vdma.height, width, height);
+    
+    vpss_stop(&vpss);
+    vdma_cleanup(&vdma);
+    
+    if (configure_vpss(width, height) < 0) {
+        return -1;
+    }
+    
+    if (vdma_init(&vdma, width, height,
+                  pipelines[pipeline].bytes_per_pixel, num_frames,
+                  frame_buffer_phys, udmabuf_name, vdma_device) < 0) {
+        return -1;
+    }
+    
+    if (apply_frame_store_limit() < 0) {
+        return -1;
+    }
+    
+    if (vdma_start(&vdma) < 0) {
+        return -1;
+    }
+    
+    return vpss_start(&vpss);
+}
+
+/**
+ * 设置线程的CPU亲和性和SCHED_FIFO优先级
+ *
+ * 失败只打印警告（普通用户没有实时调度权限时退回默认调度）。
+ *
+ * @param thread 线程
+ * @param cpu 绑定的CPU核，-1不绑定
+ * @param priority SCHED_FIFO优先级，0不修改
+ * @param name 线程名（用于日志）
+ */
+static void set_thread_sched(pthread_t thread, int cpu, int priority, const char *name)
+{
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (err) {
+            fprintf(stderr, "警告: %s线程绑定CPU%d失败: %s\n", name, cpu, strerror(err));
+        }
+    }
+    
+    if (priority > 0) {
+        struct sched_param param = { .sched_priority = priority };
+        int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (err) {
+            fprintf(stderr, "警告: %s线程设置SCHED_FIFO失败: %s\n", name, strerror(err));
+        }
+    }
+}
+
+/**
+ * 看门狗：检查VDMA/VPSS的错误状态和帧间隔，出错时只复位出错的IP核
+ *
+ * VDMA通道停止或出现致命错误时软复位S2MM通道并重新写入寄存器，VPSS报告错误时
+ * 复位并重配VPSS；长时间没有新帧（VPSS的HLS子核没有错误寄存器，上游停住时也是如此）
+ * 两个都恢复。被持有的帧缓冲、采集队列和UVC取流都不受影响，主机只会看到帧间隔
+ * 变长。从检测到故障到恢复后第一帧的时间记入STAGE_RECOVERY。
+ *
+ * @param now 当前时间（纳秒）
+ * @return 0成功，-1恢复失败
+ */
+static int watchdog_check(uint64_t now)
+{
+    uint32_t vdma_errors, vpss_errors;
+    int vdma_fault = vdma_check_health(&vdma, &vdma_errors);
+    int vpss_fault = vpss_check_health(&vpss, &vpss_errors);
+    int stalled = now - watchdog.last_frame_ns > WATCHDOG_STALL_MS * 1000000ULL;
+    
+    if (!vdma_fault && vdma_errors) {
+        frame_stats_add(&frame_stats->pl_frame_errors, 1);
+    }
+    if (!vdma_fault && !vpss_fault && !stalled) {
+        return 0;
+    }
+    
+    /* 刚恢复过：等待新帧，不反复复位 */
+    if (watchdog.last_recover_ns &&
+        now - watchdog.last_recover_ns < WATCHDOG_STALL_MS * 1000000ULL) {
+        return 0;
+    }
+    
+    if (!watchdog.fault_ns) {
+        watchdog.fault_ns = now;
+        fprintf(stderr, "看门狗: %s（VDMA状态0x%08X，VPSS错误0x%08X），开始恢复\n",
+                vdma_fault ? "VDMA通道故障" : vpss_fault ? "VPSS故障" : "流水线停顿",
+                vdma_errors, vpss_errors);
+    }
+    
+    if (vdma_fault) {
+        frame_stats_add(&frame_stats->vdma_faults, 1);
+    }
+    if (vpss_fault) {
+        frame_stats_add(&frame_stats->vpss_faults, 1);
+    }
+    if (stalled && !vdma_fault && !vpss_fault) {
+        frame_stats_add(&frame_stats->pl_stalls, 1);
+    }
+    
+    /* 先让VDMA能接收数据，再重启VPSS输出 */
+    if ((vdma_fault || stalled) && vdma_recover(&vdma) < 0) {
+        fprintf(stderr, "看门狗: VDMA恢复失败\n");
+        return -1;
+    }
+    if ((vpss_fault || stalled) && vpss_recover(&vpss) < 0) {
+        fprintf(stderr, "看门狗: VPSS恢复失败\n");
+        return -1;
+    }
+    
+    watchdog.last_recover_ns = frame_stats_now();
+    watchdog.last_frame_ns = watchdog.last_recover_ns;
+    return 0;
+}
+
+/**
+ * 看门狗：收到新帧，结束待恢复的故障
+ *
+ * @param now 当前时间（纳秒）
+ */
+static void watchdog_frame(uint64_t now)
+{
+    if (watchdog.fault_ns) {
+        frame_stats_record(&frame_stats->hist[STAGE_RECOVERY], watchdog.fault_ns, now);
+        printf("看门狗: 流水线已恢复，用时%lluus\n",
+               (unsigned long long)((now - watchdog.fault_ns) / 1000));
+        watchdog.fault_ns = 0;
+    }
+    watchdog.last_frame_ns = now;
+}
+
+/**
+ * 采集线程：等待VDMA帧完成，持有最新帧并交给发送线程
+ *
+ * 发送线程来不及取走时队列挤掉旧帧并立即释放，VDMA总能拿到空闲帧缓冲。
+ */
+static void *capture_thread(void *arg)
+{
+    int vdma_fd = vdma_get_fd(&vdma);
+    uint32_t last_seq = 0;
+    uint64_t one = 1;
+    struct pollfd pfd[2] = {
+        { .fd = capture_stop_fd, .events = POLLIN },
+        { .fd = vdma_fd, .events = POLLIN },
+    };
+    
+    (void)arg;
+    
+    memset(&watchdog, 0, sizeof(watchdog));
+    watchdog.last_frame_ns = frame_stats_now();
+    
+    for (;;) {
+        /* 没有UIO中断时每毫秒检查一次VDMA状态位；有中断时超时用于看门狗检查 */
+        int n = poll(pfd, vdma_fd >= 0 ? 2 : 1, vdma_fd >= 0 ? WATCHDOG_STALL_MS : VDMA_POLL_INTERVAL_MS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("采集线程poll失败");
+            break;
+        }
+        
+        if (pfd[0].revents & POLLIN) {
+            return NULL;
+        }
+        
+        if (vdma_fd >= 0 && !(pfd[1].revents & POLLIN)) {
+            if (watchdog_check(frame_stats_now()) < 0) {
+                break;
+            }
+            continue;
+        }
+        
+        int ret = vdma_handle_frame_event(&vdma);
+        if (ret < 0) {
+            break;
+        }
+        
+        uint64_t now = frame_stats_now();
+        if (ret == 0) {
+            watchdog_frame(now);
+        }
+        if (watchdog_check(now) < 0) {
+            break;
+        }
+        if (ret > 0) {
+            continue;
+        }
+        
+        /* 取最新完成的帧，持有期间VDMA不会覆盖它；帧没有变化（新帧被丢弃）时跳过 */
+        int frame = vdma_acquire_latest(&vdma);
+        if (frame < 0) {
+            continue;
+        }
+        uint32_t seq = vdma.frame_seq[frame];
+        if (seq == last_seq) {
+            vdma_release(&vdma, frame);
+            frame_stats_add(&frame_stats->frames_duplicated, 1);
+            continue;
+        }
+        last_seq = seq;
+        
+        frame_acquire_ns[frame] = frame_stats_now();
+        frame_stats_record(&frame_stats->hist[STAGE_CAPTURE],
+                           vdma.frame_time_ns[frame], frame_acquire_ns[frame]);
+        frame_stats_add(&frame_stats->frames_captured, 1);
+        if (verify_frames) {
+            snapshot_frame(frame);
+        }
+        
+        int evicted = frame_ring_push(&frame_ring, frame);
+        if (evicted >= 0) {
+            vdma_release(&vdma, evicted);
+            frame_stats_drop(frame_stats, DROP_QUEUE, 1);
+        }
+        
+        if (write(frame_event_fd, &one, sizeof(one)) != sizeof(one)) {
+            perror("通知发送线程失败");
+            break;
+        }
+    }
+    
+    /* 出错退出：通知发送线程结束 */
+    capture_failed = 1;
+    if (write(frame_event_fd, &one, sizeof(one)) < 0) {
+        perror("通知发送线程失败");
+    }
+    return NULL;
+}
+
+/**
+ * 启动采集线程
+ *
+ * @return 0成功，-1失败
+ */
+static int start_capture(void)
+{
+    uint64_t val;
+    
+    frame_ring_init(&frame_ring, queue_depth);
+    capture_failed = 0;
+    
+    /* 清掉上一次停止时留下的停止请求 */
+    if (read(capture_stop_fd, &val, sizeof(val)) < 0 && errno != EAGAIN) {
+        perror("读取停止事件失败");
+    }
+    
+    int err = pthread_create(&capture_tid, NULL, capture_thread, NULL);
+    if (err) {
+        fprintf(stderr, "创建采集线程失败: %s\n", strerror(err));
+        return -1;
+    }
+    capture_started = 1;
+    
+    /* 采集线程比发送线程高一级，帧完成后要赶在下一帧开始前切换停靠指针 */
+    set_thread_sched(capture_tid, capture_cpu, rt_priority > 0 ? rt_priority + 1 : 0, "采集");
+    
+    return 0;
+}
+
+/**
+ * 停止采集线程并释放队列中剩余的帧
+ */
+static void stop_capture(void)
+{
+    uint64_t one = 1;
+    int frame;
+    
+    if (!capture_started) {
+        return;
+    }
+    
+    if (write(capture_stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        perror("通知采集线程停止失败");
+    }
+    pthread_join(capture_tid, NULL);
+    capture_started = 0;
+    
+    while ((frame = frame_ring_pop(&frame_ring)) >= 0) {
+        vdma_release(&vdma, frame);
+    }
+}
+
+/**
+ * 不取流时停止PL流水线：先停VPSS（数据源），VDMA写完当前帧后再停，DDR不再有视频写入
+ *
+ * @param reason 停止原因（打印用）
+ */
+static void suspend_pipeline(const char *reason)
+{
+    if (pl_suspended || keep_pl_running) {
+        return;
+    }
+    
+    vpss_stop(&vpss);
+    vdma_stop(&vdma);
+    pl_suspended = 1;
+    printf("PL流水线已停止（%s）\n", reason);
+}
+
+/**
+ * 恢复停止的PL流水线
+ *
+ * 完整配置下停止VPSS的复位脉冲清零了子核寄存器，先重新写入配置；
+ * VDMA的帧缓冲地址和行跨度在停止期间保留，只需重新启动。
+ *
+ * @return 0成功，-1失败
+ */
+static int resume_pipeline(void)
+{
+    if (!pl_suspended) {
+        return 0;
+    }
+    
+    if (configure_vpss(vdma.width, vdma.height) < 0 || vdma_start(&vdma) < 0 ||
+        vpss_start(&vpss) < 0) {
+        return -1;
+    }
+    pl_suspended = 0;
+    printf("PL流水线已恢复\n");
+    return 0;
+}
+
+/**
+ * 主机STREAMON：按提交的格式准备PL和UVC输出队列
+ *
+ * 失败时已准备的部分由调用者用release_streaming()归还。
+ *
+ * @return 0成功，-1失败
+ */
+static int start_streaming(void)
+{
+    /* 主机可以选择通告的任一格式 */
+    for (int i = 0; i < OUT_FMT_COUNT; i++) {
+        if (out_formats[i].pixelformat == uvc.pixelformat) {
+            out_format = (out_format_t)i;
+        }
+    }
+    if (roi_active()) {
+        /* ROI模式不使用缩放器，描述符只有ROI输出尺寸这一种 */
+        if (uvc.width != out_width() || uvc.height != out_height()) {
+            fprintf(stderr, "主机提交的分辨率%dx%d与ROI输出%dx%d不一致\n",
+                    uvc.width, uvc.height, out_width(), out_height());
+            return -1;
+        }
+    } else if (!vdma.base_addr || uvc.width != vdma.width || uvc.height != vdma.height) {
+        /* 上一次重配失败时VDMA已释放，同样尺寸也要重新初始化 */
+        if (reconfigure_pipeline(uvc.width, uvc.height) < 0) {
+            fprintf(stderr, "PL流水线重配失败\n");
+            pl_suspended = 1;
+            return -1;
+        }
+        pl_suspended = 0;
+    }
+    
+    if (resume_pipeline() < 0) {
+        fprintf(stderr, "PL流水线恢复失败\n");
+        return -1;
+    }
+    
+    /* 缩放后的宽度可能需要行跨度填充，USERPTR会把填充一起发出去，按重配后的帧选择 */
+    select_io_mode(0);
+    
+    if (uvc_set_format(&uvc) < 0) {
+        return -1;
+    }
+    
+    /* 申请UVC输出队列缓冲，USERPTR方式下与VDMA帧缓冲一一对应：缓冲编号就是帧编号，
+     * 驱动给的缓冲少于帧缓冲数时编号大的帧无法入队，改用mmap */
+    int granted = uvc_request_buffers(&uvc, io_mode, num_frames);
+    if (granted >= 0 && io_mode == UVC_IO_USERPTR && granted < num_frames) {
+        fprintf(stderr, "提示: USERPTR需要%d个UVC缓冲（每个VDMA帧缓冲一个），驱动只给了%d个，"
+                "传输方式改为mmap\n", num_frames, granted);
+        uvc_release_buffers(&uvc);
+        io_mode = UVC_IO_MMAP;
+        granted = uvc_request_buffers(&uvc, io_mode, num_frames);
+    }
+    if (granted < 0) {
+        fprintf(stderr, "UVC缓冲申请失败，可使用 -m write 切换到拷贝方式\n");
+        return -1;
+    }
+    
+    /* 中间缓冲从缓冲池取用，池只在需要更大的槽位时重新映射 */
+    int need_bin = roi.binning == 2 && out_format != pipelines[pipeline].native_format;
+    int need_staging = io_mode == UVC_IO_WRITE && !frame_passthrough();
+    if (need_bin || need_staging) {
+        size_t slot_size = out_frame_size();
+        size_t bin_size = (size_t)out_width() * out_height() * pipelines[pipeline].bytes_per_pixel;
+        if (bin_size > slot_size) {
+            slot_size = bin_size;
+        }
+        if (frame_pool_reserve(&convert_pool, slot_size, CONVERT_POOL_SLOTS) < 0) {
+            fprintf(stderr, "分配中间缓冲失败\n");
+            return -1;
+        }
+    }
+    if (need_bin) {
+        bin_slot = frame_pool_acquire(&convert_pool);
+        bin_buffer = frame_pool_data(&convert_pool, bin_slot);
+    }
+    if (need_staging) {
+        staging_slot = frame_pool_acquire(&convert_pool);
+        staging_buffer = frame_pool_data(&convert_pool, staging_slot);
+    }
+    
+    /* 编码器按本次提交的分辨率和帧率打开，第一帧为IDR */
+    if (out_format == OUT_FMT_H264 &&
+        venc_init(&venc, encoder_device, out_width(), out_height(),
+                  uvc.frame_interval, encoder_bitrate) < 0) {
+        fprintf(stderr, "VCU编码器初始化失败，可使用 -E 指定编码器设备\n");
+        return -1;
+    }
+    
+    /* --fps 上限低于主机帧率时按上限发送 */
+    uint64_t interval_ns = (uint64_t)uvc.frame_interval * 100;
+    if (max_fps > 0 && interval_ns < 1000000000ULL / max_fps) {
+        interval_ns = 1000000000ULL / max_fps;
+    }
+    frame_pacer_init(&pacer, interval_ns);
+    frame_diff_init(&scene, pipeline == PIPE_RAW16 ? 2 : 1, scene_threshold);
+    scene_sent_ns = 0;
+    
+    if (start_capture() < 0) {
+        return -1;
+    }
+    stream_active = 1;
+    
+    printf("\n开始视频流传输...\n");
+    printf("分辨率: %dx%d@%.1ffps (%s流水线, %s格式, %s)\n", uvc.width, uvc.height,
+           1e7 / uvc.frame_interval,
+           pipelines[pipeline].name, out_formats[out_format].name,
+           io_mode == UVC_IO_USERPTR ? "USERPTR零拷贝" :
+           io_mode == UVC_IO_MMAP ? "MMAP" : "write拷贝");
+    if (roi_active()) {
+        printf("ROI: %d,%d %dx%d%s\n", roi.x, roi.y, roi.width, roi.height,
+               roi.binning == 2 ? "，2x2合并" : "");
+    }
+    
+    return 0;
+}
+
+/**
+ * 停止采集线程，归还本次取流占用的VDMA帧、UVC缓冲、编码器和中间缓冲
+ *
+ * 各步骤都可以重复调用，start_streaming()中途失败时也用它回到空闲状态。
+ */
+static void release_streaming(void)
+{
+    stop_capture();
+    
+    if (pending_frame >= 0) {
+        vdma_release(&vdma, pending_frame);
+        pending_frame = -1;
+    }
+    
+    /* USERPTR方式下仍在驱动队列中的缓冲就是VDMA帧，STREAMOFF后不会再出队 */
+    if (io_mode == UVC_IO_USERPTR) {
+        for (int i = 0; i < uvc.num_buffers; i++) {
+            if (uvc.queued[i]) {
+                vdma_release(&vdma, i);
+            }
+        }
+    }
+    
+    uvc_stream_off(&uvc);
+    uvc_release_buffers(&uvc);
+    venc_cleanup(&venc);
+    
+    if (staging_slot >= 0) {
+        frame_pool_release(&convert_pool, staging_slot);
+        staging_slot = -1;
+        staging_buffer = NULL;
+    }
+    if (bin_slot >= 0) {
+        frame_pool_release(&convert_pool, bin_slot);
+        bin_slot = -1;
+        bin_buffer = NULL;
+    }
+    stream_active = 0;
+}
+
+/**
+ * 主机STREAMOFF或断开：归还所有缓冲并停止PL流水线（--keep-pl时继续运行）
+ */
+static void stop_streaming(void)
+{
+    if (!stream_active) {
+        return;
+    }
+    
+    release_streaming();
+    printf("主机停止取流\n");
+    suspend_pipeline("主机停止取流");
+}
+
+/**
+ * UVC输出队列是否已满（达到--uvc-queue上限或全部缓冲都在驱动中）
+ *
+ * write方式没有队列，只能由write()返回EAGAIN得知。
+ */
+static int uvc_queue_full(void)
+{
+    if (io_mode == UVC_IO_WRITE) {
+        return 0;
+    }
+    
+    int limit = uvc.num_buffers;
+    if (uvc_queue_limit > 0 && uvc_queue_limit < limit) {
+        limit = uvc_queue_limit;
+    }
+    
+    return uvc.num_queued >= limit;
+}
+
+/**
+ * 按当前状态更新UVC描述符关注的事件
+ *
+ * 队列没满时不需要等缓冲完成（下一帧到达时顺便回收），所以只在队列满时
+ * 关注POLLOUT，等USB传输完成一个缓冲时唤醒回收并发送待发送帧；
+ * write方式下只在有待发送帧时关注POLLOUT（设备可写）。
+ */
+static void update_uvc_events(void)
+{
+    uint32_t events = EPOLLPRI;
+    
+    if (stream_active &&
+        (io_mode == UVC_IO_WRITE ? pending_frame >= 0 : uvc.num_buffers > 0 && uvc_queue_full())) {
+        events |= EPOLLOUT;
+    }
+    
+    if (events != uvc_epoll_events) {
+        struct epoll_event ev = { .events = events, .data.u32 = EV_SRC_UVC };
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, uvc.fd, &ev);
+        uvc_epoll_events = events;
+    }
+}
+
+/**
+ * 打印本次取流的汇总：持续吞吐量、进程CPU占用（相对单核）和各阶段延迟百分位
+ * （延迟直方图是统计页中进程启动以来的累计值）
+ *
+ * 在没有PL的板子上用uvc-camera-bench（make bench）运行时，可以直接对比
+ * 不同传输方式和输出格式下发送路径的开销。
+ */
+static void print_summary(void)
+{
+    static const char *stage_names[STAGE_COUNT] = {
+        [STAGE_CAPTURE]  = "采集",
+        [STAGE_PROCESS]  = "处理",
+        [STAGE_TRANSFER] = "传输",
+        [STAGE_TOTAL]    = "总计",
+        [STAGE_RECOVERY] = "故障恢复",
+    };
+    struct timespec now;
+    struct rusage usage;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    getrusage(RUSAGE_SELF, &usage);
+    
+    double elapsed = (now.tv_sec - stats.start_time.tv_sec) +
+                     (now.tv_nsec - stats.start_time.tv_nsec) / 1e9;
+    if (elapsed <= 0) {
+        return;
+    }
+    double user = (usage.ru_utime.tv_sec - stats.start_usage.ru_utime.tv_sec) +
+                  (usage.ru_utime.tv_usec - stats.start_usage.ru_utime.tv_usec) / 1e6;
+    double sys = (usage.ru_stime.tv_sec - stats.start_usage.ru_stime.tv_sec) +
+                 (usage.ru_stime.tv_usec - stats.start_usage.ru_stime.tv_usec) / 1e6;
+    
+    printf("本次共发送 %d 帧，%.1f 秒，%.1f fps，%.1f MB/s，CPU %.1f%%（用户%.1f%% 内核%.1f%%）\n",
+           stats.frames, elapsed, stats.frames / elapsed, stats.bytes / elapsed / 1e6,
+           (user + sys) * 100 / elapsed, user * 100 / elapsed, sys * 100 / elapsed);
+    
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const latency_hist_t *hist = &frame_stats->hist[i];
+        if (hist->count == 0) {
+            continue;
+        }
+        printf("  %s延迟 p50/p99/p99.9/max: %llu/%llu/%llu/%lluus\n", stage_names[i],
+               (unsigned long long)frame_stats_percentile(hist, 50.0),
+               (unsigned long long)frame_stats_percentile(hist, 99.0),
+               (unsigned long long)frame_stats_percentile(hist, 99.9),
+               (unsigned long long)hist->max_us);
+    }
+}
+
+/**
+ * 处理所有待处理的UVC事件
+ *
+ * STREAMON准备失败只拒绝本次取流：归还已准备的资源回到空闲，等待主机下一次
+ * PROBE/COMMIT（主机取不到帧会超时并STREAMOFF），进程继续运行。
+ *
+ * @return 0成功，-1失败
+ */
+static int handle_uvc_events(void)
+{
+    int ev;
+    
+    while ((ev = uvc_handle_event(&uvc)) > 0) {
+        if (ev == UVC_EV_STREAMON) {
+            if (start_streaming() < 0) {
+                fprintf(stderr, "本次取流准备失败，等待主机重新协商\n");
+                release_streaming();
+                suspend_pipeline("取流准备失败");
+                continue;
+            }
+            memset(&stats, 0, sizeof(stats));
+            stats.last_frame = -1;
+            stats.tick_seq = vdma.sequence;
+            clock_gettime(CLOCK_MONOTONIC, &stats.start_time);
+            getrusage(RUSAGE_SELF, &stats.start_usage);
+        } else if (ev == UVC_EV_STREAMOFF) {
+            if (stream_active) {
+                print_summary();
+            }
+            stop_streaming();
+        }
+    }
+    
+    return ev;
+}
+
+/**
+ * 发送一帧；UVC队列满时留作待发送帧，空出缓冲后由flush_pending()发送
+ *
+ * @param frame VDMA帧编号（已持有）
+ * @return 0成功，-1失败
+ */
+static int transmit_frame(int frame)
+{
+    uint32_t seq = vdma.frame_seq[frame];
+    int ret = uvc_queue_full() ? 1 : send_frame(frame);
+    
+    if (ret == 1) {
+        pending_frame = frame;
+        return 0;
+    } else if (ret == 2) {
+        return 0;
+    } else if (ret < 0) {
+        return -1;
+    }
+    
+    frame_stats_add(&frame_stats->frames_sent, 1);
+    stats.last_seq = seq;
+    stats.last_frame = frame;
+    stats.frames++;
+    return 0;
+}
+
+/**
+ * UVC队列空出位置后发送待发送帧
+ *
+ * @return 0成功，-1失败
+ */
+static int flush_pending(void)
+{
+    if (pending_frame < 0 || uvc_queue_full()) {
+        return 0;
+    }
+    
+    int frame = pending_frame;
+    pending_frame = -1;
+    return transmit_frame(frame);
+}
+
+/**
+ * 帧是否需要发送：与上一次发送的帧相比画面有变化，或距上一次发送已超过保活间隔
+ *
+ * 只抽样读取发送窗口内的少量cache line；静止帧不做格式转换，也不占用USB带宽。
+ *
+ * @param frame VDMA帧编号
+ * @return 1发送，0跳过
+ */
+static int scene_changed(int frame)
+{
+    const uint8_t *src_frame = (uint8_t*)vdma.frame_buffer + (frame * vdma.frame_size);
+    uint64_t done_ns = vdma.frame_time_ns[frame];
+    int bpp = pipelines[pipeline].bytes_per_pixel;
+    int width = roi_active() ? roi.width : vdma.width;
+    int height = roi_active() ? roi.height : vdma.height;
+    
+    vdma_cache_invalidate(&vdma, frame);
+    if (!frame_diff_check(&scene, roi_source(src_frame), width * bpp, height, vdma.stride) &&
+        done_ns - scene_sent_ns < 1000000000ULL / idle_fps) {
+        return 0;
+    }
+    
+    frame_diff_accept(&scene);
+    scene_sent_ns = done_ns;
+    return 1;
+}
+
+/**
+ * 采集线程入队了新帧：取最新一帧，节流后发送到UVC
+ *
+ * 背压策略：UVC队列满时不发送旧帧，也不重试已经过时的帧编号。最新的帧留作
+ * 待发送帧（仍然持有，VDMA不会覆盖），等待期间再来新帧就取代它，
+ * 队列一空出位置就发送当时最新的帧。
+ *
+ * @return 0成功，-1失败
+ */
+static int handle_ring_frame(void)
+{
+    uint64_t count;
+    
+    if (read(frame_event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("读取帧事件失败");
+        return -1;
+    }
+    
+    if (capture_failed) {
+        fprintf(stderr, "采集线程异常退出\n");
+        return -1;
+    }
+    
+    if (!stream_active) {
+        return 0;
+    }
+    
+    if (io_mode != UVC_IO_WRITE) {
+        reclaim_buffers();
+    }
+    
+    /* 只发送最新的一帧，更旧的直接释放 */
+    int read_frame = frame_ring_pop(&frame_ring);
+    int newer;
+    while ((newer = frame_ring_pop(&frame_ring)) >= 0) {
+        vdma_release(&vdma, read_frame);
+        frame_stats_drop(frame_stats, DROP_QUEUE, 1);
+        read_frame = newer;
+    }
+    if (read_frame < 0) {
+        return flush_pending();
+    }
+    
+    /* 还在等UVC队列：新帧取代待发送帧，占用的是同一个节流时隙 */
+    if (pending_frame >= 0) {
+        vdma_release(&vdma, pending_frame);
+        stats.skipped++;
+        frame_stats_drop(frame_stats, DROP_BACKPRESSURE, 1);
+        pending_frame = read_frame;
+        return flush_pending();
+    }
+    
+    /* 主机帧率低于传感器帧率，按帧完成时间抽帧 */
+    if (!frame_pacer_accept(&pacer, vdma.frame_time_ns[read_frame], vdma.frame_seq[read_frame])) {
+        vdma_release(&vdma, read_frame);
+        stats.paced++;
+        frame_stats_add(&frame_stats->frames_paced, 1);
+        return 0;
+    }
+    
+    /* 画面静止时只按保活帧率发送 */
+    if (idle_fps > 0 && !scene_changed(read_frame)) {
+        vdma_release(&vdma, read_frame);
+        stats.still++;
+        frame_stats_add(&frame_stats->frames_static, 1);
+        return 0;
+    }
+    
+    return transmit_frame(read_frame);
+}
+
+/**
+ * 把VDMA自己维护的计数增量计入统计页（VDMA重新初始化后计数从0开始）
+ */
+static void publish_vdma_counters(void)
+{
+    if (vdma.frames_dropped < vdma_published.dropped ||
+        vdma.late_parks < vdma_published.torn ||
+        vdma.frames_missed < vdma_published.missed) {
+        memset(&vdma_published, 0, sizeof(vdma_published));
+    }
+    
+    frame_stats_drop(frame_stats, DROP_NO_BUFFER, vdma.frames_dropped - vdma_published.dropped);
+    frame_stats_add(&frame_stats->frames_torn, vdma.late_parks - vdma_published.torn);
+    frame_stats_add(&frame_stats->irqs_missed, vdma.frames_missed - vdma_published.missed);
+    
+    vdma_published.dropped = vdma.frames_dropped;
+    vdma_published.torn = vdma.late_parks;
+    vdma_published.missed = vdma.frames_missed;
+}
+
+/**
+ * 统计定时器：打印统计信息，检测VDMA断流
+ */
+static void print_stats(void)
+{
+    struct timespec current_time;
+    
+    publish_vdma_counters();
+    
+    if (!stream_active) {
+        return;
+    }
+    
+    if (vdma.sequence == stats.tick_seq) {
+        fprintf(stderr, "警告: %dms内没有收到VDMA帧\n", STATS_INTERVAL_MS);
+    }
+    stats.tick_seq = vdma.sequence;
+    
+    clock_gettime(CLOCK_MONOTONIC, &current_time);
+    double elapsed = (current_time.tv_sec - stats.start_time.tv_sec) + 
+                   (current_time.tv_nsec - stats.start_time.tv_nsec) / 1e9;
+    double fps = stats.frames / elapsed;
+    
+    /* write方式没有缓冲归还时间，用交给UVC之前的延迟 */
+    const latency_hist_t *hist = &frame_stats->hist[io_mode == UVC_IO_WRITE ? STAGE_PROCESS : STAGE_TOTAL];
+    
+    printf("已发送 %d 帧 (读取帧%d, VDMA写帧%d, 实际FPS: %.1f, 传感器FPS: %.2f, UVC队列满%d, 节流%d, 静止%d, 挤出%u, 丢弃%u, 漏中断%u, 停靠延迟%u, 延迟p50/p99 %llu/%lluus)\n", 
+           stats.frames, stats.last_frame, vdma.write_frame, fps, frame_pacer_sensor_fps(&pacer),
+           stats.skipped, stats.paced, stats.still, frame_ring.evicted, vdma.frames_dropped,
+           vdma.frames_missed, vdma.late_parks,
+           (unsigned long long)frame_stats_percentile(hist, 50.0),
+           (unsigned long long)frame_stats_percentile(hist, 99.0));
+    if (verify_frames) {
+        printf("  完整性校验: 损坏%d帧\n", stats.corrupt);
+    }
+    if (frame_stats->vdma_faults || frame_stats->vpss_faults || frame_stats->pl_stalls) {
+        printf("  PL故障恢复: VDMA %llu次, VPSS %llu次, 停顿 %llu次\n",
+               (unsigned long long)frame_stats->vdma_faults,
+               (unsigned long long)frame_stats->vpss_faults,
+               (unsigned long long)frame_stats->pl_stalls);
+    }
+}
+
+/**
+ * 主循环（发送线程）：epoll同时等待采集线程的新帧、UVC事件/缓冲完成和统计定时器
+ */
+int main_loop()
+{
+    struct epoll_event events[4];
+    int stats_fd = -1;
+    int ret = 0;
+    
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("创建epoll失败");
+        return -1;
+    }
+    
+    struct epoll_event ev = { .events = EPOLLPRI, .data.u32 = EV_SRC_UVC };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, uvc.fd, &ev) < 0) {
+        perror("UVC设备加入epoll失败");
+        ret = -1;
+        goto out;
+    }
+    uvc_epoll_events = EPOLLPRI;
+    
+    frame_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    capture_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (frame_event_fd < 0 || capture_stop_fd < 0) {
+        perror("创建eventfd失败");
+        ret = -1;
+        goto out;
+    }
+    
+    ev.events = EPOLLIN;
+    ev.data.u32 = EV_SRC_RING;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, frame_event_fd, &ev) < 0) {
+        perror("帧事件加入epoll失败");
+        ret = -1;
+        goto out;
+    }
+    
+    set_thread_sched(pthread_self(), transmit_cpu, rt_priority, "发送");
+    
+    if ((stats_fd = add_timer(STATS_INTERVAL_MS, EV_SRC_STATS)) < 0) {
+        ret = -1;
+        goto out;
+    }
+    
+    printf("\n等待主机开始取流...\n");
+    printf("按Ctrl+C退出\n\n");
+    
+    while (running && ret == 0) {
+        int n = epoll_wait(epoll_fd, events, sizeof(events) / sizeof(events[0]), -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait失败");
+            ret = -1;
+            break;
+        }
+        
+        for (int i = 0; i < n && ret == 0; i++) {
+            switch (events[i].data.u32) {
+            case EV_SRC_UVC:
+                /* 没有STREAMON之前不发送任何帧 */
+                if ((events[i].events & EPOLLOUT) && stream_active) {
+                    if (io_mode != UVC_IO_WRITE) {
+                        reclaim_buffers();
+                    }
+                    ret = flush_pending();
+                }
+                if (ret == 0 && (events[i].events & EPOLLPRI)) {
+                    ret = handle_uvc_events();
+                    /* STREAMON/STREAMOFF可能重启了采集线程，本批剩余事件作废（水平触发，下一轮会再报告） */
+                    n = 0;
+                }
+                break;
+            case EV_SRC_RING:
+                ret = handle_ring_frame();
+                break;
+            case EV_SRC_STATS:
+                drain_timer(stats_fd);
+                /* 没有取流（主机已枚举但没有STREAMON、取流启动失败等）时停止PL；
+                 * 常驻模式保持流水线就绪，只在USB链路挂起或拔出时停止 */
+                if (!stream_active && !pl_suspended) {
+                    if (!daemon_mode) {
+                        suspend_pipeline("没有主机取流");
+                    } else if (uvc_link_suspended()) {
+                        suspend_pipeline("USB链路挂起");
+                    }
+                }
+                print_stats();
+                break;
+            }
+        }
+        
+        update_uvc_events();
+    }
+    
+    if (stream_active) {
+        printf("\n");
+        print_summary();
+    }
+    stop_streaming();
+    
+out:
+    if (stats_fd >= 0) close(stats_fd);
+    if (frame_event_fd >= 0) {
+        close(frame_event_fd);
+        frame_event_fd = -1;
+    }
+    if (capture_stop_fd >= 0) {
+        close(capture_stop_fd);
+        capture_stop_fd = -1;
+    }
+    close(epoll_fd);
+    epoll_fd = -1;
+    
+    return ret;
+}
+
+/**
+ * 启动PL流水线：初始化并配置VPSS，初始化VDMA，先启动VDMA（接收端）再启动VPSS（发送端）
+ *
+ * @return 0成功，-1失败
+ */
+static int bring_up_pipeline(void)
+{
+    /* 初始化VPSS */
+    printf("[1/4] 初始化VPSS...\n");
+    if (vpss_init(&vpss, capture_width, capture_height, pipelines[pipeline].vpss_mode,
+                  vpss_device) < 0) {
+        fprintf(stderr, "VPSS初始化失败\n");
+        return -1;
+    }
+    
+    if (configure_vpss(capture_width, capture_height) < 0) {
+        fprintf(stderr, "VPSS配置失败\n");
+        return -1;
+    }
+    
+    /* 初始化VDMA */
+    printf("\n[2/4] 初始化VDMA...\n");
+    if (vdma_init(&vdma, capture_width, capture_height, 
+                  pipelines[pipeline].bytes_per_pixel, num_frames,
+                  frame_buffer_phys, udmabuf_name, vdma_device) < 0) {
+        fprintf(stderr, "VDMA初始化失败\n");
+        return -1;
+    }
+    
+    if (apply_frame_store_limit() < 0) {
+        return -1;
+    }
+    
+    if (io_mode_option == UVC_IO_USERPTR && !vdma_userptr_capable(&vdma)) {
+        fprintf(stderr, "提示: 帧缓冲通过/dev/mem映射，不能USERPTR入队，传输方式改为mmap"
+                "（零拷贝需要u-dma-buf，见 -u）\n");
+    }
+    
+    /* 先启动VDMA（接收端） */
+    printf("\n[3/4] 启动VDMA...\n");
+    if (vdma_start(&vdma) < 0) {
+        fprintf(stderr, "VDMA启动失败\n");
+        return -1;
+    }
+    
+    /* 再启动VPSS（发送端），VDMA已在等待数据，不需要额外延时 */
+    printf("\n[4/4] 启动VPSS...\n");
+    if (vpss_start(&vpss) < 0) {
+        fprintf(stderr, "VPSS启动失败\n");
+        return -1;
+    }
+    
+    return 0;
+}
+
+/**
+ * PL流水线启动线程，与打开UVC设备并行
+ */
+static void *pipeline_thread(void *arg)
+{
+    (void)arg;
+    pipeline_status = bring_up_pipeline();
+    return NULL;
+}
+
+/**
+ * 打开UVC Gadget设备
+ *
+ * 常驻模式下设备还不存在（setup_uvc.sh还没有运行）时每UVC_WAIT_INTERVAL_MS检查一次，
+ * PL流水线已经在运行，Gadget一出现即可应答主机。
+ *
+ * @return 0成功，-1失败
+ */
+static int open_uvc(void)
+{
+    if (daemon_mode && access(uvc_device, F_OK) < 0) {
+        printf("等待UVC Gadget设备 %s ...\n", uvc_device);
+        while (running && pipeline_status >= 0 && access(uvc_device, F_OK) < 0) {
+            usleep(UVC_WAIT_INTERVAL_MS * 1000);
+        }
+        if (!running || pipeline_status < 0) {
+            return -1;
+        }
+    }
+    
+    /* 格式在主机COMMIT之后STREAMON时设置 */
+    printf("初始化UVC设备...\n");
+    if (uvc_init(&uvc, uvc_device, uvc_formats, num_uvc_formats,
+                 uvc_frames, num_uvc_frames) < 0) {
+        fprintf(stderr, "UVC初始化失败\n");
+        fprintf(stderr, "提示: 请先运行 setup_uvc.sh 配置UVC Gadget\n");
+        return -1;
+    }
+    
+    /* 第instance个UVC功能的接口编号由内核绑定时分配，读不到ConfigFS时按
+     * setup_uvc.sh的布局（只有UVC功能，每个功能两个接口）推算 */
+    int intf = uvc_streaming_interface(instance);
+    if (intf < 0) {
+        intf = UVC_INTF_STREAMING + 2 * instance;
+        fprintf(stderr, "警告: 读不到uvc.%d的视频流接口编号，按%d处理\n", instance, intf);
+    }
+    uvc.streaming_intf = intf;
+    uvc.max_payload = streaming_ep.payload;
+    uvc.max_payload_hs = streaming_ep.payload_hs;
+    
+    return 0;
+}
+
+/**
+ * 主函数
+ */
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    
+    int parsed = parse_args(argc, argv);
+    if (parsed != 0) {
+        return parsed > 0 ? 0 : 1;
+    }
+    
+    printf("========================================\n");
+    printf("USB UVC Camera Application\n");
+    printf("Xilinx Zynq UltraScale+ MPSoC\n");
+    printf("IR Camera over USB3.0\n");
+    printf("========================================\n\n");
+    
+    /* 常驻模式：脱离终端在后台运行（标准输出保留，由启动脚本重定向到日志） */
+    if (daemon_mode && daemon(0, 1) < 0) {
+        perror("进入后台失败");
+        return 1;
+    }
+    
+    /* 注册信号处理 */
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    
+    frame_stats = frame_stats_open(instance);
+    if (!frame_stats) {
+        fprintf(stderr, "分配统计页失败\n");
+        return 1;
+    }
+    
+    /* PL流水线在单独的线程中启动（复位/启动按状态位轮询，没有固定延时），同时打开UVC设备 */
+    pthread_t pipeline_tid;
+    uvc.fd = -1;
+    if (pthread_create(&pipeline_tid, NULL, pipeline_thread, NULL) != 0) {
+        fprintf(stderr, "创建PL流水线启动线程失败\n");
+        ret = 1;
+        goto cleanup;
+    }
+    int uvc_ret = open_uvc();
+    pthread_join(pipeline_tid, NULL);
+    if (pipeline_status < 0 || uvc_ret < 0) {
+        ret = 1;
+        goto cleanup;
+    }
+    
+    /* 流水线已确认可以启动，STREAMON之前不写DDR（常驻模式保持就绪，取流时立即有帧） */
+    if (!daemon_mode) {
+        suspend_pipeline("等待主机取流");
+    }
+    
+    /* 主循环 */
+    ret = main_loop() < 0 ? 1 : 0;
+    
+cleanup:
+    printf("\n清理资源...\n");
+    
+    uvc_cleanup(&uvc);
+    venc_cleanup(&venc);
+    frame_pool_cleanup(&convert_pool);
     
     vpss_cleanup(&vpss);
     vdma_cleanup(&vdma);
+    frame_stats_close(frame_stats);
     
     printf("程序退出\n");
     return ret;
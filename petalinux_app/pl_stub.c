@@ -0,0 +1,504 @@
+/**
+ * @file pl_stub.c
+ * @brief 不依赖PL比特流的VPSS/VDMA替身（基准测试用）
+ *
+ * 实现vpss_control.h和vdma_control.h的全部接口，与main.c等其余模块一起链接为
+ * uvc-camera-bench（make bench），在没有比特流和CameraLink相机的板子上测量
+ * 发送路径（格式转换、UVC入队、USB传输）：
+ * - 帧缓冲为匿名内存（优先使用大页），内容为测试图案或录制的帧文件
+ * - 用timerfd按固定帧率产生"帧完成"事件，停靠帧选择、持有计数、帧序号
+ *   和丢帧计数与vdma_control.c一致
+ *
+ * 通过环境变量配置：
+ * - VDMA_STUB_FPS   帧率（默认60）
+ * - VDMA_STUB_FILE  录制的原始帧文件（按当前分辨率和每像素字节数紧密排列，
+ *                   依次装入各帧缓冲，随停靠帧轮换回放）；不设置时使用测试图案
+ * - VDMA_STUB_FAULT_EVERY  每N帧报告一次S2MM通道HALTED（默认0不注入），
+ *                   用于检验看门狗的恢复路径和恢复时间统计
+ */
+
+#include "vpss_control.h"
+#include "vdma_control.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+
+/* 默认帧率 */
+#define STUB_DEFAULT_FPS    60
+
+/* 大页大小（aarch64默认2MB），大页映射长度须为其整数倍 */
+#define STUB_HUGEPAGE_SIZE  (2UL * 1024 * 1024)
+
+/* ============ VPSS ============ */
+
+/**
+ * 初始化VPSS（只记录参数）
+ */
+int vpss_init(vpss_control_t *vpss, int width, int height, vpss_mode_t mode,
+              const char *device)
+{
+    (void)device;
+    memset(vpss, 0, sizeof(vpss_control_t));
+    vpss->uio_fd = -1;
+    vpss->has_scaler = 1;
+    vpss->width = width;
+    vpss->height = height;
+    vpss->out_width = width;
+    vpss->out_height = height;
+    vpss->mode = mode;
+
+    printf("VPSS替身: %dx%d，模式%d（没有访问硬件）\n", width, height, mode);
+    return 0;
+}
+
+/**
+ * 替身VPSS按完整配置（带缩放器）处理
+ */
+int vpss_probe_scaler(const char *device)
+{
+    (void)device;
+    return 1;
+}
+
+/**
+ * 配置VPSS（只记录输出尺寸）
+ */
+int vpss_configure(vpss_control_t *vpss, const vpss_config_t *config)
+{
+    vpss->width = config->in_width;
+    vpss->height = config->in_height;
+    vpss->out_width = config->out_width;
+    vpss->out_height = config->out_height;
+    return 0;
+}
+
+int vpss_start(vpss_control_t *vpss)
+{
+    (void)vpss;
+    return 0;
+}
+
+int vpss_stop(vpss_control_t *vpss)
+{
+    (void)vpss;
+    return 0;
+}
+
+int vpss_check_health(vpss_control_t *vpss, uint32_t *errors)
+{
+    (void)vpss;
+    *errors = 0;
+    return 0;
+}
+
+int vpss_recover(vpss_control_t *vpss)
+{
+    (void)vpss;
+    return 0;
+}
+
+void vpss_cleanup(vpss_control_t *vpss)
+{
+    (void)vpss;
+}
+
+/* ============ VDMA ============ */
+
+/* 模拟WrFrmStore：最近一次完成（正在写入）的帧缓冲 */
+static int wr_frm_store = 0;
+
+/**
+ * 填充测试图案：RGBA为8条彩条（A固定为FF），2字节/像素为16位水平灰度渐变
+ *
+ * @param vdma VDMA控制结构指针
+ * @param frame 帧编号
+ */
+static void stub_fill_pattern(vdma_control_t *vdma, int frame)
+{
+    static const uint32_t bars[8] = {
+        0xFFFFFFFF, 0xFF00FFFF, 0xFFFFFF00, 0xFF00FF00,
+        0xFFFF00FF, 0xFF0000FF, 0xFFFF0000, 0xFF000000,
+    };
+    uint8_t *base = (uint8_t *)vdma->frame_buffer + vdma->frame_size * frame;
+
+    for (int y = 0; y < vdma->height; y++) {
+        uint8_t *line = base + (size_t)y * vdma->stride;
+        for (int x = 0; x < vdma->width; x++) {
+            if (vdma->bytes_per_pixel == 4) {
+                ((uint32_t *)line)[x] = bars[x * 8 / vdma->width];
+            } else if (vdma->bytes_per_pixel == 2) {
+                ((uint16_t *)line)[x] = (uint16_t)(x * 65535 / (vdma->width - 1) + frame * 256);
+            } else {
+                memset(line + x * vdma->bytes_per_pixel, (x + frame) & 0xFF, vdma->bytes_per_pixel);
+            }
+        }
+    }
+}
+
+/**
+ * 从录制文件装入各帧缓冲（最多帧缓冲数个帧），文件中的帧不够时循环使用
+ *
+ * @param vdma VDMA控制结构指针
+ * @param path 文件路径
+ * @return 0成功，-1失败
+ */
+static int stub_load_file(vdma_control_t *vdma, const char *path)
+{
+    size_t line_bytes = (size_t)vdma->width * vdma->bytes_per_pixel;
+    int loaded = 0;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "打开帧文件%s失败: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    while (loaded < vdma->num_frames) {
+        uint8_t *base = (uint8_t *)vdma->frame_buffer + vdma->frame_size * loaded;
+        int y;
+
+        for (y = 0; y < vdma->height; y++) {
+            if (fread(base + (size_t)y * vdma->stride, 1, line_bytes, f) != line_bytes) {
+                break;
+            }
+        }
+        if (y < vdma->height) {
+            break;
+        }
+        loaded++;
+    }
+    fclose(f);
+
+    if (loaded == 0) {
+        fprintf(stderr, "帧文件%s不足一帧（每帧%zu字节）\n", path, line_bytes * vdma->height);
+        return -1;
+    }
+
+    for (int i = loaded; i < vdma->num_frames; i++) {
+        memcpy((uint8_t *)vdma->frame_buffer + vdma->frame_size * i,
+               (uint8_t *)vdma->frame_buffer + vdma->frame_size * (i % loaded),
+               vdma->frame_size);
+    }
+
+    printf("VDMA替身: 从%s装入%d帧\n", path, loaded);
+    return 0;
+}
+
+/**
+ * 计算帧缓冲行跨度（与vdma_control.c相同）
+ */
+uint32_t vdma_calc_stride(int width, int bytes_per_pixel)
+{
+    uint32_t hsize = (uint32_t)width * bytes_per_pixel;
+
+    return (hsize + VDMA_STRIDE_ALIGN - 1) & ~(uint32_t)(VDMA_STRIDE_ALIGN - 1);
+}
+
+/**
+ * 初始化VDMA替身：分配帧缓冲并填充内容
+ */
+int vdma_init(vdma_control_t *vdma, int width, int height,
+              int bytes_per_pixel, int num_frames,
+              uint32_t frame_buffer_phys, const char *udmabuf_name,
+              const char *device)
+{
+    (void)frame_buffer_phys;
+    (void)udmabuf_name;
+    (void)device;
+
+    if (num_frames < 1 || num_frames > VDMA_MAX_FRAME_STORES) {
+        fprintf(stderr, "帧缓冲数量无效: %d (1~%d)\n", num_frames, VDMA_MAX_FRAME_STORES);
+        return -1;
+    }
+
+    memset(vdma, 0, sizeof(vdma_control_t));
+    vdma->uio_fd = -1;
+    vdma->width = width;
+    vdma->height = height;
+    vdma->bytes_per_pixel = bytes_per_pixel;
+    vdma->num_frames = num_frames;
+    vdma->stride = vdma_calc_stride(width, bytes_per_pixel);
+    vdma->frame_size = (size_t)vdma->stride * height;
+    vdma->latest_frame = -1;
+
+    /* 先试大页（减少USB控制器和CPU访问帧时的TLB缺失），没有预留大页时退回普通页 */
+    size_t huge_size = (vdma->frame_size * num_frames + STUB_HUGEPAGE_SIZE - 1) &
+                       ~(STUB_HUGEPAGE_SIZE - 1);
+    void *mem = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    const char *kind = "大页";
+    if (mem == MAP_FAILED) {
+        huge_size = vdma->frame_size * num_frames;
+        mem = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        kind = "普通页";
+    }
+    if (mem == MAP_FAILED) {
+        perror("分配帧缓冲失败");
+        return -1;
+    }
+    vdma->frame_buffer = mem;
+    vdma->frame_buffer_size = huge_size;
+
+    const char *path = getenv("VDMA_STUB_FILE");
+    if (path && *path) {
+        if (stub_load_file(vdma, path) < 0) {
+            vdma_cleanup(vdma);
+            return -1;
+        }
+    } else {
+        for (int i = 0; i < num_frames; i++) {
+            stub_fill_pattern(vdma, i);
+        }
+    }
+
+    printf("VDMA替身: %dx%d，行跨度%u，每帧%zu字节，%d帧（%s）\n",
+           width, height, vdma->stride, vdma->frame_size, num_frames, kind);
+    return 0;
+}
+
+/**
+ * 启动帧定时器
+ */
+int vdma_start(vdma_control_t *vdma)
+{
+    const char *env = getenv("VDMA_STUB_FPS");
+    int fps = env ? atoi(env) : STUB_DEFAULT_FPS;
+
+    if (fps <= 0 || fps > 1000) {
+        fprintf(stderr, "VDMA_STUB_FPS无效: %s（1~1000）\n", env);
+        return -1;
+    }
+
+    vdma->uio_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (vdma->uio_fd < 0) {
+        perror("创建帧定时器失败");
+        return -1;
+    }
+
+    long period_ns = 1000000000L / fps;
+    struct itimerspec its = {
+        .it_interval = { period_ns / 1000000000L, period_ns % 1000000000L },
+        .it_value = { period_ns / 1000000000L, period_ns % 1000000000L },
+    };
+    if (timerfd_settime(vdma->uio_fd, 0, &its, NULL) < 0) {
+        perror("设置帧定时器失败");
+        close(vdma->uio_fd);
+        vdma->uio_fd = -1;
+        return -1;
+    }
+
+    vdma->write_frame = 0;
+    vdma->latest_frame = -1;
+    vdma->irq_enabled = 1;
+    wr_frm_store = 0;
+    memset(vdma->refcnt, 0, sizeof(vdma->refcnt));
+
+    printf("VDMA替身启动: %d fps\n", fps);
+    return 0;
+}
+
+/**
+ * 停止帧定时器
+ */
+int vdma_stop(vdma_control_t *vdma)
+{
+    if (!vdma || vdma->uio_fd < 0) {
+        return -1;
+    }
+
+    close(vdma->uio_fd);
+    vdma->uio_fd = -1;
+    vdma->irq_enabled = 0;
+    return 0;
+}
+
+/**
+ * 通道状态：按VDMA_STUB_FAULT_EVERY周期性报告HALTED
+ */
+int vdma_check_health(vdma_control_t *vdma, uint32_t *errors)
+{
+    static uint32_t next_fault = 0;
+    const char *env = getenv("VDMA_STUB_FAULT_EVERY");
+    int every = env ? atoi(env) : 0;
+
+    *errors = 0;
+    if (every <= 0) {
+        return 0;
+    }
+    if (next_fault == 0 || next_fault > vdma->sequence + (uint32_t)every) {
+        next_fault = vdma->sequence + every;
+    }
+    if (vdma->sequence < next_fault) {
+        return 0;
+    }
+
+    next_fault = vdma->sequence + every;
+    *errors = VDMA_STATUS_HALTED;
+    return 1;
+}
+
+/**
+ * 故障恢复：替身没有需要复位的状态，帧定时器继续运行
+ */
+int vdma_recover(vdma_control_t *vdma)
+{
+    (void)vdma;
+    return 0;
+}
+
+/**
+ * 当前"写入"的帧编号：与WrFrmStore寄存器一样，帧完成后到下一帧开始前仍是刚完成的
+ * 帧缓冲（替身的帧在定时器到期时瞬间"写完"，所以总是上一次完成的帧）
+ */
+int vdma_get_current_frame(vdma_control_t *vdma)
+{
+    return vdma ? wr_frm_store : -1;
+}
+
+int vdma_get_fd(vdma_control_t *vdma)
+{
+    return vdma->irq_enabled ? vdma->uio_fd : -1;
+}
+
+/**
+ * 处理一次定时器到期：与vdma_frame_done()相同的停靠帧选择
+ */
+int vdma_handle_frame_event(vdma_control_t *vdma)
+{
+    uint64_t expirations;
+
+    if (read(vdma->uio_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        if (errno == EAGAIN) {
+            return 1;
+        }
+        fprintf(stderr, "读取帧定时器失败: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* 多次到期说明消费者来不及处理，按中断计数跳变计入漏掉的帧 */
+    if (expirations > 1) {
+        vdma->frames_missed += expirations - 1;
+        vdma->sequence += expirations - 1;
+    }
+
+    int done = vdma->write_frame;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    wr_frm_store = done;
+    vdma->sequence++;
+    vdma->frame_seq[done] = vdma->sequence;
+    vdma->frame_time_ns[done] = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+    int next = -1;
+    for (int i = 1; i < vdma->num_frames; i++) {
+        int candidate = (done + i) % vdma->num_frames;
+        if (__atomic_load_n(&vdma->refcnt[candidate], __ATOMIC_ACQUIRE) == 0) {
+            next = candidate;
+            break;
+        }
+    }
+
+    if (next < 0 && vdma->num_frames > 1) {
+        vdma->frames_dropped++;
+        if (vdma->latest_frame == done) {
+            vdma->latest_frame = -1;
+        }
+        return 0;
+    }
+
+    vdma->write_frame = next < 0 ? done : next;
+    vdma->latest_frame = done;
+    return 0;
+}
+
+/**
+ * 等待一帧
+ */
+int vdma_wait_frame(vdma_control_t *vdma, int timeout_ms)
+{
+    if (!vdma || vdma->uio_fd < 0) {
+        return -1;
+    }
+
+    int waited_ms = 0;
+    int ret;
+    while ((ret = vdma_handle_frame_event(vdma)) == 1) {
+        if (waited_ms >= timeout_ms) {
+            return 1;
+        }
+        usleep(1000);
+        waited_ms++;
+    }
+
+    return ret;
+}
+
+int vdma_acquire_latest(vdma_control_t *vdma)
+{
+    if (!vdma || vdma->latest_frame < 0) {
+        return -1;
+    }
+
+    __atomic_add_fetch(&vdma->refcnt[vdma->latest_frame], 1, __ATOMIC_ACQ_REL);
+    return vdma->latest_frame;
+}
+
+void vdma_release(vdma_control_t *vdma, int frame)
+{
+    if (!vdma || frame < 0 || frame >= vdma->num_frames) {
+        return;
+    }
+
+    if (__atomic_load_n(&vdma->refcnt[frame], __ATOMIC_ACQUIRE) > 0) {
+        __atomic_sub_fetch(&vdma->refcnt[frame], 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+/* 匿名内存由CPU写入，不需要Cache维护 */
+void vdma_cache_invalidate(vdma_control_t *vdma, int frame)
+{
+    (void)vdma;
+    (void)frame;
+}
+
+void vdma_cache_clean(vdma_control_t *vdma, int frame)
+{
+    (void)vdma;
+    (void)frame;
+}
+
+void vdma_frame_write(vdma_control_t *vdma, int frame, size_t offset, const void *data, size_t len)
+{
+    if (!vdma || frame < 0 || frame >= vdma->num_frames || offset + len > vdma->frame_size) {
+        return;
+    }
+    memcpy((uint8_t*)vdma->frame_buffer + vdma->frame_size * frame + offset, data, len);
+}
+
+/**
+ * 替身帧缓冲是匿名映射，可以USERPTR入队
+ */
+int vdma_userptr_capable(const vdma_control_t *vdma)
+{
+    return vdma->frame_buffer != NULL;
+}
+
+void vdma_cleanup(vdma_control_t *vdma)
+{
+    if (!vdma || !vdma->frame_buffer) return;
+
+    vdma_stop(vdma);
+
+    if (vdma->frame_buffer) {
+        munmap(vdma->frame_buffer, vdma->frame_buffer_size);
+        vdma->frame_buffer = NULL;
+    }
+}
@@ -0,0 +1,166 @@
+/**
+ * @file uio_device.c
+ * @brief PL IP核UIO设备查找实现
+ */
+
+#include "uio_device.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+
+/* 设备树符号表（标签 → 节点路径） */
+#define UIO_DT_SYMBOLS  "/proc/device-tree/__symbols__"
+
+/* 轮询寄存器的间隔（微秒） */
+#define UIO_POLL_STEP_US  10
+
+/**
+ * 读取一行文本文件（去掉行尾换行）
+ *
+ * @return 0成功，-1失败
+ */
+static int uio_read_line(const char *path, char *buf, size_t len)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+
+    int ok = (fgets(buf, len, f) != NULL);
+    fclose(f);
+    if (!ok) {
+        return -1;
+    }
+
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+/**
+ * 读取UIO设备第一段映射的物理地址
+ *
+ * @return 0成功，-1失败
+ */
+static int uio_map_address(const char *uio, unsigned long *addr)
+{
+    char path[128];
+    char buf[64];
+
+    if (snprintf(path, sizeof(path), "/sys/class/uio/%s/maps/map0/addr", uio) >= (int)sizeof(path) ||
+        uio_read_line(path, buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+
+    *addr = strtoul(buf, NULL, 0);
+    return 0;
+}
+
+/**
+ * 解析实例描述
+ */
+int uio_resolve_address(const char *spec, uint32_t *addr)
+{
+    char path[256];
+    char buf[256];
+    char *end;
+
+    /* 直接给出的物理地址 */
+    unsigned long val = strtoul(spec, &end, 0);
+    if (end != spec && *end == '\0') {
+        *addr = (uint32_t)val;
+        return 0;
+    }
+
+    /* 设备树标签：符号表中是节点路径，如 /amba_pl@0/dma@80030000 */
+    snprintf(path, sizeof(path), "%s/%s", UIO_DT_SYMBOLS, spec);
+    if (uio_read_line(path, buf, sizeof(buf)) == 0) {
+        char *unit = strrchr(buf, '@');
+        if (unit && strchr(unit, '/') == NULL) {
+            val = strtoul(unit + 1, &end, 16);
+            if (end != unit + 1) {
+                *addr = (uint32_t)val;
+                return 0;
+            }
+        }
+        fprintf(stderr, "设备树标签%s的节点%s没有单元地址\n", spec, buf);
+        return -1;
+    }
+
+    /* UIO设备名 */
+    DIR *dp = opendir("/sys/class/uio");
+    if (dp) {
+        struct dirent *entry;
+        while ((entry = readdir(dp))) {
+            if (strncmp(entry->d_name, "uio", 3) != 0) continue;
+
+            if (snprintf(path, sizeof(path), "/sys/class/uio/%s/name", entry->d_name) >= (int)sizeof(path) ||
+                uio_read_line(path, buf, sizeof(buf)) < 0 || strcmp(buf, spec) != 0) {
+                continue;
+            }
+            if (uio_map_address(entry->d_name, &val) == 0) {
+                closedir(dp);
+                *addr = (uint32_t)val;
+                return 0;
+            }
+        }
+        closedir(dp);
+    }
+
+    fprintf(stderr, "无法解析设备%s：不是物理地址、设备树标签或UIO设备名\n", spec);
+    return -1;
+}
+
+/**
+ * 按物理地址查找UIO设备
+ */
+int uio_find_by_address(uint32_t addr)
+{
+    struct dirent *entry;
+    unsigned long val;
+    int index = -1;
+
+    DIR *dp = opendir("/sys/class/uio");
+    if (dp == NULL) {
+        fprintf(stderr, "无法打开 /sys/class/uio 目录\n");
+        return -1;
+    }
+
+    while ((entry = readdir(dp))) {
+        if (strncmp(entry->d_name, "uio", 3) != 0) continue;
+
+        if (uio_map_address(entry->d_name, &val) == 0 && val == addr) {
+            index = atoi(entry->d_name + 3);
+            break;
+        }
+    }
+
+    closedir(dp);
+    return index;
+}
+
+/**
+ * 轮询寄存器直到 (值 & mask) == value
+ */
+int uio_poll_reg(volatile uint32_t *reg, uint32_t mask, uint32_t value, int timeout_us)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        if ((*reg & mask) == value) {
+            return 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed_us = (now.tv_sec - start.tv_sec) * 1000000L +
+                          (now.tv_nsec - start.tv_nsec) / 1000;
+        if (elapsed_us >= timeout_us) {
+            /* 超时前最后再读一次，避免被调度出去后误判 */
+            return (*reg & mask) == value ? 0 : -1;
+        }
+        usleep(UIO_POLL_STEP_US);
+    }
+}
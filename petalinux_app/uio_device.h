@@ -0,0 +1,49 @@
+/**
+ * @file uio_device.h
+ * @brief 按寄存器物理地址或设备树标签查找PL IP核的UIO设备
+ *
+ * 多路采集的比特流中同一种IP核（VDMA、VPSS）有多个实例，各自有一个UIO设备。
+ * 实例可以用以下方式指定：
+ * - 寄存器物理地址（Vivado Address Editor中的基地址），如 0x80020000
+ * - 设备树标签（需要带符号表编译设备树，dtc -@），如 axi_vdma_1，
+ *   从 /proc/device-tree/__symbols__ 找到节点路径，取单元地址
+ * - UIO设备名（/sys/class/uio/uioN/name，即设备树节点名）
+ */
+
+#ifndef UIO_DEVICE_H
+#define UIO_DEVICE_H
+
+#include <stdint.h>
+
+/**
+ * 把实例描述解析为寄存器物理地址
+ *
+ * @param spec 物理地址、设备树标签或UIO设备名
+ * @param addr 解析结果
+ * @return 0成功，-1无法解析
+ */
+int uio_resolve_address(const char *spec, uint32_t *addr);
+
+/**
+ * 查找第一段映射（map0）位于指定物理地址的UIO设备
+ *
+ * @param addr 寄存器物理地址
+ * @return UIO设备编号（/dev/uioN的N），没有找到返回-1
+ */
+int uio_find_by_address(uint32_t addr);
+
+/**
+ * 轮询寄存器直到 (值 & mask) == value
+ *
+ * 用于代替复位、启动、停止之后的固定延时：条件满足立即返回，启动时间取决于
+ * IP核实际需要的时间而不是最坏情况。
+ *
+ * @param reg 映射后的寄存器地址
+ * @param mask 关心的位
+ * @param value 期望值
+ * @param timeout_us 超时（微秒）
+ * @return 0条件满足，-1超时
+ */
+int uio_poll_reg(volatile uint32_t *reg, uint32_t mask, uint32_t value, int timeout_us);
+
+#endif /* UIO_DEVICE_H */
@@ -0,0 +1,715 @@
+/**
+ * @file uvc_control.c
+ * @brief UVC Gadget 视频输出控制实现
+ */
+
+#include "uvc_control.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+#include <linux/usb/ch9.h>
+#include <linux/usb/g_uvc.h>
+#include <errno.h>
+#include <dirent.h>
+
+/**
+ * 传输方式对应的V4L2内存类型
+ */
+static uint32_t uvc_memory(const uvc_control_t *uvc)
+{
+    return uvc->io_mode == UVC_IO_MMAP ? V4L2_MEMORY_MMAP : V4L2_MEMORY_USERPTR;
+}
+
+/**
+ * 映射MMAP模式下驱动分配的缓冲
+ *
+ * @param uvc UVC控制结构指针
+ * @return 0成功，-1失败
+ */
+static int uvc_map_buffers(uvc_control_t *uvc)
+{
+    struct v4l2_buffer buf;
+
+    for (int i = 0; i < uvc->num_buffers; i++) {
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+
+        if (ioctl(uvc->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            perror("查询UVC缓冲失败 (VIDIOC_QUERYBUF)");
+            return -1;
+        }
+
+        uvc->mem[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, uvc->fd, buf.m.offset);
+        if (uvc->mem[i] == MAP_FAILED) {
+            perror("映射UVC缓冲失败");
+            uvc->mem[i] = NULL;
+            return -1;
+        }
+        uvc->mem_length[i] = buf.length;
+    }
+
+    return 0;
+}
+
+/**
+ * 解除MMAP缓冲映射
+ */
+static void uvc_unmap_buffers(uvc_control_t *uvc)
+{
+    for (int i = 0; i < UVC_MAX_BUFFERS; i++) {
+        if (uvc->mem[i]) {
+            munmap(uvc->mem[i], uvc->mem_length[i]);
+            uvc->mem[i] = NULL;
+            uvc->mem_length[i] = 0;
+        }
+    }
+}
+
+/**
+ * 读取第一个UDC（与setup_uvc.sh绑定的UDC一致）的sysfs属性
+ *
+ * @param attr 属性名（如current_speed、state）
+ * @param buf 输出，读不到时为空串
+ * @param len 缓冲长度
+ */
+static void uvc_read_udc_attr(const char *attr, char *buf, size_t len)
+{
+    char path[300];
+    struct dirent *entry;
+    
+    buf[0] = '\0';
+    DIR *dir = opendir("/sys/class/udc");
+    if (!dir) {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/sys/class/udc/%s/%s", entry->d_name, attr);
+        FILE *fp = fopen(path, "r");
+        if (fp) {
+            if (!fgets(buf, len, fp)) {
+                buf[0] = '\0';
+            }
+            fclose(fp);
+        }
+        break;
+    }
+    closedir(dir);
+}
+
+/**
+ * 当前连接速度下的最大负载
+ *
+ * 高速/全速连接时等时端点只有高速描述符的带宽；读不到current_speed时按超高速处理。
+ */
+static uint32_t uvc_link_payload(const uvc_control_t *uvc)
+{
+    char speed[32];
+    
+    uvc_read_udc_attr("current_speed", speed, sizeof(speed));
+    if (strncmp(speed, "high-speed", 10) == 0 || strncmp(speed, "full-speed", 10) == 0) {
+        return uvc->max_payload_hs;
+    }
+    return uvc->max_payload;
+}
+
+/**
+ * 按格式、帧描述符编号和请求的帧间隔填充流控制结构
+ *
+ * 帧间隔取不短于请求值的最近一个通告值，请求比所有值都长时取最长的。
+ *
+ * @param uvc UVC控制结构指针
+ * @param ctrl 待填充的流控制结构
+ * @param format_index 格式描述符编号（从1开始，越界时钳位）
+ * @param frame_index 帧描述符编号（从1开始，越界时钳位）
+ * @param interval 请求的帧间隔（100ns单位，0表示最短）
+ */
+static void uvc_fill_streaming_control(uvc_control_t *uvc, struct uvc_streaming_control *ctrl,
+                                       int format_index, int frame_index, uint32_t interval)
+{
+    if (format_index < 1) format_index = 1;
+    if (format_index > uvc->num_formats) format_index = uvc->num_formats;
+    if (frame_index < 1) frame_index = 1;
+    if (frame_index > uvc->num_frames) frame_index = uvc->num_frames;
+    
+    const uvc_format_info_t *format = &uvc->formats[format_index - 1];
+    const uvc_frame_info_t *frame = &uvc->frames[frame_index - 1];
+    uint32_t chosen = frame->intervals[frame->num_intervals - 1];
+    
+    for (int i = 0; i < frame->num_intervals; i++) {
+        if (frame->intervals[i] >= interval) {
+            chosen = frame->intervals[i];
+            break;
+        }
+    }
+    
+    memset(ctrl, 0, sizeof(*ctrl));
+    ctrl->bmHint = 1;                 /* dwFrameInterval固定 */
+    ctrl->bFormatIndex = format_index;
+    ctrl->bFrameIndex = frame_index;
+    ctrl->dwFrameInterval = chosen;
+    ctrl->dwMaxVideoFrameSize = (uint32_t)frame->width * frame->height * format->bits_per_pixel / 8;
+    ctrl->dwMaxPayloadTransferSize = uvc_link_payload(uvc);
+    ctrl->bmFramingInfo = 3;          /* 负载头包含FID/EOF */
+    ctrl->bPreferedVersion = 1;
+    ctrl->bMinVersion = 1;
+    ctrl->bMaxVersion = 1;
+}
+
+/**
+ * 打开UVC设备并订阅Gadget事件
+ */
+int uvc_init(uvc_control_t *uvc, const char *device,
+             const uvc_format_info_t *formats, int num_formats,
+             const uvc_frame_info_t *frames, int num_frames)
+{
+    static const uint32_t events[] = {
+        UVC_EVENT_SETUP, UVC_EVENT_DATA, UVC_EVENT_STREAMON,
+        UVC_EVENT_STREAMOFF, UVC_EVENT_DISCONNECT,
+    };
+    struct v4l2_event_subscription sub;
+
+    memset(uvc, 0, sizeof(uvc_control_t));
+    uvc->formats = formats;
+    uvc->num_formats = num_formats;
+    uvc->frames = frames;
+    uvc->num_frames = num_frames;
+    uvc->streaming_intf = UVC_INTF_STREAMING;
+    uvc->max_payload = UVC_MAX_PAYLOAD;
+    uvc->max_payload_hs = UVC_MAX_PAYLOAD;
+    uvc->fd = -1;
+
+    if (num_formats < 1 || num_frames < 1) {
+        fprintf(stderr, "没有可通告的UVC格式或帧描述符\n");
+        return -1;
+    }
+    uvc->pixelformat = formats[0].pixelformat;
+    uvc->bits_per_pixel = formats[0].bits_per_pixel;
+
+    printf("打开UVC设备: %s\n", device);
+
+    uvc->fd = open(device, O_RDWR | O_NONBLOCK);
+    if (uvc->fd < 0) {
+        perror("打开UVC设备失败");
+        fprintf(stderr, "提示: 请先运行 setup_uvc.sh 配置UVC Gadget\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+        memset(&sub, 0, sizeof(sub));
+        sub.type = events[i];
+        if (ioctl(uvc->fd, VIDIOC_SUBSCRIBE_EVENT, &sub) < 0) {
+            perror("订阅UVC事件失败 (VIDIOC_SUBSCRIBE_EVENT)");
+            close(uvc->fd);
+            uvc->fd = -1;
+            return -1;
+        }
+    }
+
+    /* 主机COMMIT之前使用第一个格式、第一个帧描述符的最短帧间隔 */
+    uvc_fill_streaming_control(uvc, &uvc->probe, 1, 1, 0);
+    uvc->commit = uvc->probe;
+    uvc->width = frames[0].width;
+    uvc->height = frames[0].height;
+    uvc->frame_interval = uvc->commit.dwFrameInterval;
+
+    return 0;
+}
+
+/**
+ * 应答视频流接口的类请求（PROBE/COMMIT）
+ *
+ * @param uvc UVC控制结构指针
+ * @param req 请求
+ * @param resp 应答数据，length为负表示STALL
+ */
+static void uvc_handle_streaming_request(uvc_control_t *uvc, const struct usb_ctrlrequest *req,
+                                         struct uvc_request_data *resp)
+{
+    int cs = req->wValue >> 8;
+    struct uvc_streaming_control *ctrl = (struct uvc_streaming_control *)resp->data;
+
+    if (cs != UVC_VS_PROBE_CONTROL && cs != UVC_VS_COMMIT_CONTROL) {
+        return;
+    }
+
+    resp->length = sizeof(*ctrl);
+
+    switch (req->bRequest) {
+    case UVC_SET_CUR:
+        /* 数据在随后的UVC_EVENT_DATA中到达 */
+        uvc->pending_control = cs;
+        break;
+    case UVC_GET_CUR:
+        *ctrl = cs == UVC_VS_PROBE_CONTROL ? uvc->probe : uvc->commit;
+        break;
+    case UVC_GET_MIN:
+    case UVC_GET_DEF:
+        uvc_fill_streaming_control(uvc, ctrl, 1, 1, 0);
+        break;
+    case UVC_GET_MAX:
+        uvc_fill_streaming_control(uvc, ctrl, uvc->num_formats, uvc->num_frames, UINT32_MAX);
+        break;
+    case UVC_GET_RES:
+        memset(ctrl, 0, sizeof(*ctrl));
+        break;
+    case UVC_GET_LEN:
+        resp->data[0] = sizeof(*ctrl) & 0xff;
+        resp->data[1] = sizeof(*ctrl) >> 8;
+        resp->length = 2;
+        break;
+    case UVC_GET_INFO:
+        resp->data[0] = 0x03;      /* 支持GET/SET */
+        resp->length = 1;
+        break;
+    default:
+        resp->length = -1;
+        break;
+    }
+}
+
+/**
+ * 处理SETUP事件：只应答视频流接口的类请求，其余请求STALL
+ *
+ * @param uvc UVC控制结构指针
+ * @param req 请求
+ * @return 0成功，-1失败
+ */
+static int uvc_handle_setup(uvc_control_t *uvc, const struct usb_ctrlrequest *req)
+{
+    struct uvc_request_data resp;
+
+    memset(&resp, 0, sizeof(resp));
+    resp.length = -1;
+
+    if ((req->bRequestType & USB_TYPE_MASK) == USB_TYPE_CLASS &&
+        (req->wIndex & 0xff) == uvc->streaming_intf) {
+        uvc_handle_streaming_request(uvc, req, &resp);
+    }
+
+    if (resp.length > req->wLength) {
+        resp.length = req->wLength;
+    }
+
+    if (ioctl(uvc->fd, UVCIOC_SEND_RESPONSE, &resp) < 0) {
+        perror("发送UVC控制应答失败 (UVCIOC_SEND_RESPONSE)");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * 处理DATA事件：SET_CUR的数据阶段
+ *
+ * @param uvc UVC控制结构指针
+ * @param data 主机发来的数据
+ */
+static void uvc_handle_data(uvc_control_t *uvc, const struct uvc_request_data *data)
+{
+    struct uvc_streaming_control req;
+    struct uvc_streaming_control *target;
+    int cs = uvc->pending_control;
+
+    uvc->pending_control = 0;
+
+    if (cs == 0) {
+        return;
+    }
+
+    memset(&req, 0, sizeof(req));
+    memcpy(&req, data->data, data->length < (int)sizeof(req) ? (size_t)data->length : sizeof(req));
+
+    target = cs == UVC_VS_PROBE_CONTROL ? &uvc->probe : &uvc->commit;
+    uvc_fill_streaming_control(uvc, target, req.bFormatIndex, req.bFrameIndex, req.dwFrameInterval);
+
+    if (cs == UVC_VS_COMMIT_CONTROL) {
+        const uvc_format_info_t *format = &uvc->formats[uvc->commit.bFormatIndex - 1];
+        const uvc_frame_info_t *frame = &uvc->frames[uvc->commit.bFrameIndex - 1];
+        uvc->pixelformat = format->pixelformat;
+        uvc->bits_per_pixel = format->bits_per_pixel;
+        uvc->width = frame->width;
+        uvc->height = frame->height;
+        uvc->frame_interval = uvc->commit.dwFrameInterval;
+        printf("主机提交格式: %s %dx%d, 帧间隔 %u (%.1f fps)\n", format->name,
+               uvc->width, uvc->height, uvc->frame_interval, 1e7 / uvc->frame_interval);
+    }
+}
+
+/**
+ * 处理一个UVC Gadget事件
+ */
+int uvc_handle_event(uvc_control_t *uvc)
+{
+    struct v4l2_event ev;
+    struct uvc_event *uvc_ev = (struct uvc_event *)&ev.u.data;
+
+    memset(&ev, 0, sizeof(ev));
+    if (ioctl(uvc->fd, VIDIOC_DQEVENT, &ev) < 0) {
+        if (errno == ENOENT || errno == EAGAIN) {
+            return UVC_EV_NONE;
+        }
+        perror("获取UVC事件失败 (VIDIOC_DQEVENT)");
+        return -1;
+    }
+
+    switch (ev.type) {
+    case UVC_EVENT_SETUP:
+        return uvc_handle_setup(uvc, &uvc_ev->req) < 0 ? -1 : UVC_EV_HANDLED;
+    case UVC_EVENT_DATA:
+        uvc_handle_data(uvc, &uvc_ev->data);
+        return UVC_EV_HANDLED;
+    case UVC_EVENT_STREAMON:
+        return UVC_EV_STREAMON;
+    case UVC_EVENT_STREAMOFF:
+    case UVC_EVENT_DISCONNECT:
+        return UVC_EV_STREAMOFF;
+    default:
+        return UVC_EV_HANDLED;
+    }
+}
+
+/**
+ * 按已提交的分辨率设置输出队列格式
+ */
+int uvc_set_format(uvc_control_t *uvc)
+{
+    struct v4l2_format fmt;
+
+    uvc->sizeimage = (uint32_t)uvc->width * uvc->height * uvc->bits_per_pixel / 8;
+
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = uvc->width;
+    fmt.fmt.pix.height = uvc->height;
+    fmt.fmt.pix.pixelformat = uvc->pixelformat;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix.sizeimage = uvc->sizeimage;
+
+    if (ioctl(uvc->fd, VIDIOC_S_FMT, &fmt) < 0) {
+        perror("设置视频格式失败");
+        return -1;
+    }
+
+    printf("UVC格式设置完成: %dx%d (%.4s)\n",
+           fmt.fmt.pix.width, fmt.fmt.pix.height, (const char *)&uvc->pixelformat);
+
+    return 0;
+}
+
+/**
+ * 申请输出队列缓冲
+ */
+int uvc_request_buffers(uvc_control_t *uvc, uvc_io_mode_t io_mode, int count)
+{
+    struct v4l2_requestbuffers req;
+
+    uvc->io_mode = io_mode;
+    uvc->num_buffers = 0;
+    uvc->num_queued = 0;
+    memset(uvc->queued, 0, sizeof(uvc->queued));
+
+    if (io_mode == UVC_IO_WRITE) {
+        return 0;
+    }
+
+    if (count > UVC_MAX_BUFFERS) {
+        count = UVC_MAX_BUFFERS;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.count = count;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    req.memory = uvc_memory(uvc);
+
+    if (ioctl(uvc->fd, VIDIOC_REQBUFS, &req) < 0) {
+        perror("申请UVC缓冲失败 (VIDIOC_REQBUFS)");
+        if (io_mode == UVC_IO_USERPTR) {
+            fprintf(stderr, "提示: 内核UVC Gadget驱动需要支持USERPTR\n");
+        }
+        return -1;
+    }
+
+    if ((int)req.count < count) {
+        fprintf(stderr, "警告: 申请%d个UVC缓冲，实际得到%u个\n", count, req.count);
+    }
+
+    uvc->num_buffers = req.count;
+
+    if (io_mode == UVC_IO_MMAP && uvc_map_buffers(uvc) < 0) {
+        uvc_unmap_buffers(uvc);
+        return -1;
+    }
+
+    printf("UVC缓冲申请完成: %d个 (%s)\n", uvc->num_buffers,
+           io_mode == UVC_IO_MMAP ? "MMAP" : "USERPTR");
+
+    return uvc->num_buffers;
+}
+
+/**
+ * 填写缓冲的时间戳和序号（出队时读回；主机能否收到见uvc_queue_userptr()的说明）
+ */
+static void uvc_set_timestamp(struct v4l2_buffer *buf, uint64_t timestamp_ns, uint32_t sequence)
+{
+    buf->timestamp.tv_sec = timestamp_ns / 1000000000ULL;
+    buf->timestamp.tv_usec = (timestamp_ns % 1000000000ULL) / 1000;
+    buf->sequence = sequence;
+}
+
+/**
+ * 以USERPTR方式入队一帧
+ */
+int uvc_queue_userptr(uvc_control_t *uvc, int index, const void *data, size_t length,
+                      uint64_t timestamp_ns, uint32_t sequence)
+{
+    struct v4l2_buffer buf;
+
+    if (index < 0 || index >= uvc->num_buffers) {
+        return -1;
+    }
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_USERPTR;
+    buf.index = index;
+    buf.m.userptr = (unsigned long)data;
+    buf.length = length;
+    buf.bytesused = length;
+    uvc_set_timestamp(&buf, timestamp_ns, sequence);
+
+    if (ioctl(uvc->fd, VIDIOC_QBUF, &buf) < 0) {
+        perror("UVC缓冲入队失败 (VIDIOC_QBUF)");
+        return -1;
+    }
+
+    uvc->queued[index] = 1;
+    uvc->num_queued++;
+
+    return 0;
+}
+
+/**
+ * 获取一个空闲的MMAP缓冲
+ */
+int uvc_get_free_buffer(uvc_control_t *uvc)
+{
+    for (int i = 0; i < uvc->num_buffers; i++) {
+        if (!uvc->queued[i]) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * 入队一个MMAP缓冲
+ */
+int uvc_queue_buffer(uvc_control_t *uvc, int index, size_t bytesused,
+                     uint64_t timestamp_ns, uint32_t sequence)
+{
+    struct v4l2_buffer buf;
+
+    if (index < 0 || index >= uvc->num_buffers) {
+        return -1;
+    }
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    buf.bytesused = bytesused;
+    uvc_set_timestamp(&buf, timestamp_ns, sequence);
+
+    if (ioctl(uvc->fd, VIDIOC_QBUF, &buf) < 0) {
+        perror("UVC缓冲入队失败 (VIDIOC_QBUF)");
+        return -1;
+    }
+
+    uvc->queued[index] = 1;
+    uvc->num_queued++;
+
+    return 0;
+}
+
+/**
+ * 回收一个已完成传输的缓冲
+ */
+int uvc_dequeue(uvc_control_t *uvc)
+{
+    struct v4l2_buffer buf;
+
+    if (uvc->num_queued == 0) {
+        return -1;
+    }
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = uvc_memory(uvc);
+
+    if (ioctl(uvc->fd, VIDIOC_DQBUF, &buf) < 0) {
+        if (errno != EAGAIN) {
+            perror("UVC缓冲出队失败 (VIDIOC_DQBUF)");
+        }
+        return -1;
+    }
+
+    if (buf.index < (uint32_t)uvc->num_buffers && uvc->queued[buf.index]) {
+        uvc->queued[buf.index] = 0;
+        uvc->num_queued--;
+    }
+
+    return buf.index;
+}
+
+/**
+ * 以write()方式发送一帧
+ */
+int uvc_write_frame(uvc_control_t *uvc, const void *data, size_t length)
+{
+    ssize_t written = write(uvc->fd, data, length);
+    if (written < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            /* 非阻塞写入，缓冲区满，稍后重试 */
+            return 1;
+        }
+        perror("写入UVC设备失败");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * 启动视频流
+ */
+int uvc_stream_on(uvc_control_t *uvc)
+{
+    int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+
+    if (uvc->io_mode == UVC_IO_WRITE || uvc->streaming) {
+        return 0;
+    }
+
+    if (ioctl(uvc->fd, VIDIOC_STREAMON, &type) < 0) {
+        perror("启动UVC视频流失败 (VIDIOC_STREAMON)");
+        return -1;
+    }
+
+    uvc->streaming = 1;
+    printf("UVC视频流已启动\n");
+    return 0;
+}
+
+/**
+ * 停止视频流
+ */
+int uvc_stream_off(uvc_control_t *uvc)
+{
+    int type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+
+    if (uvc->io_mode == UVC_IO_WRITE || !uvc->streaming) {
+        return 0;
+    }
+
+    if (ioctl(uvc->fd, VIDIOC_STREAMOFF, &type) < 0) {
+        perror("停止UVC视频流失败 (VIDIOC_STREAMOFF)");
+        return -1;
+    }
+
+    /* STREAMOFF后驱动归还所有缓冲 */
+    memset(uvc->queued, 0, sizeof(uvc->queued));
+    uvc->num_queued = 0;
+    uvc->streaming = 0;
+    printf("UVC视频流已停止\n");
+    return 0;
+}
+
+/**
+ * 释放输出队列缓冲
+ */
+void uvc_release_buffers(uvc_control_t *uvc)
+{
+    struct v4l2_requestbuffers req;
+
+    uvc_unmap_buffers(uvc);
+
+    if (uvc->num_buffers > 0) {
+        memset(&req, 0, sizeof(req));
+        req.count = 0;
+        req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        req.memory = uvc_memory(uvc);
+        ioctl(uvc->fd, VIDIOC_REQBUFS, &req);
+        uvc->num_buffers = 0;
+    }
+}
+
+/**
+ * USB链路是否空闲
+ */
+int uvc_link_suspended(void)
+{
+    char state[32];
+    
+    uvc_read_udc_attr("state", state, sizeof(state));
+    return strncmp(state, "suspended", 9) == 0 || strncmp(state, "not attached", 12) == 0;
+}
+
+/**
+ * 视频流接口编号：在所有Gadget中查找uvc.<instance>
+ */
+int uvc_streaming_interface(int instance)
+{
+    char path[384];
+    struct dirent *entry;
+    int intf = -1;
+    
+    DIR *dir = opendir(UVC_GADGET_CONFIGFS);
+    if (!dir) {
+        return -1;
+    }
+    while (intf < 0 && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' ||
+            snprintf(path, sizeof(path), "%s/%s/functions/uvc.%d/streaming/bInterfaceNumber",
+                     UVC_GADGET_CONFIGFS, entry->d_name, instance) >= (int)sizeof(path)) {
+            continue;
+        }
+        FILE *fp = fopen(path, "r");
+        if (fp) {
+            if (fscanf(fp, "%d", &intf) != 1) {
+                intf = -1;
+            }
+            fclose(fp);
+        }
+    }
+    closedir(dir);
+    
+    return intf;
+}
+
+/**
+ * 清理UVC资源
+ */
+void uvc_cleanup(uvc_control_t *uvc)
+{
+    if (!uvc || uvc->fd < 0) return;
+
+    printf("清理UVC资源...\n");
+
+    uvc_stream_off(uvc);
+    uvc_release_buffers(uvc);
+
+    close(uvc->fd);
+    uvc->fd = -1;
+}
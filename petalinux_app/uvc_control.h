@@ -0,0 +1,266 @@
+/**
+ * @file uvc_control.h
+ * @brief UVC Gadget 视频输出控制接口
+ *
+ * 此模块封装对UVC Gadget V4L2输出设备的访问，包括：
+ * - 打开设备并订阅UVC Gadget事件
+ * - 处理主机的PROBE/COMMIT协商（UVC_EVENT_SETUP/DATA），记录提交的格式、分辨率和帧间隔
+ * - 设置视频格式
+ * - 申请V4L2输出队列缓冲（VIDIOC_REQBUFS）
+ * - 以USERPTR方式直接入队VDMA帧缓冲（零拷贝）
+ * - 以MMAP方式使用驱动分配的缓冲（格式转换输出）
+ * - 回收USB传输完成的缓冲（VIDIOC_DQBUF）
+ * - write()拷贝方式（兼容旧流程）
+ */
+
+#ifndef UVC_CONTROL_H
+#define UVC_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/usb/video.h>
+
+/* 输出队列最大缓冲数 */
+#define UVC_MAX_BUFFERS   16
+
+/* 每个帧描述符最多的帧间隔数 */
+#define UVC_MAX_INTERVALS 8
+
+/* UVC功能的接口编号（Gadget只有UVC一个功能时）；多个功能时实际编号由内核绑定时分配，
+ * 见uvc_streaming_interface() */
+#define UVC_INTF_CONTROL    0
+#define UVC_INTF_STREAMING  1
+
+/* ConfigFS中的USB Gadget目录 */
+#define UVC_GADGET_CONFIGFS "/sys/kernel/config/usb_gadget"
+
+/* PROBE/COMMIT中通告的默认最大负载长度（与内核streaming_maxpacket默认配置一致），
+ * 按uvc_descriptor_calc_ep()的端点参数配置Gadget时改为对应的每服务间隔字节数 */
+#define UVC_MAX_PAYLOAD     1024
+
+/**
+ * uvc_handle_event()的返回值
+ */
+typedef enum {
+    UVC_EV_NONE = 0,      /* 没有待处理事件 */
+    UVC_EV_HANDLED,       /* 已处理的控制请求（PROBE/COMMIT等） */
+    UVC_EV_STREAMON,      /* 主机选择了带宽不为零的备用设置，开始取流 */
+    UVC_EV_STREAMOFF,     /* 主机停止取流或断开连接 */
+} uvc_event_result_t;
+
+/**
+ * 格式描述符（bFormatIndex从1开始按数组顺序）
+ */
+typedef struct {
+    const char *name;         /* 格式名（-F选项，也是ConfigFS中的格式目录名） */
+    uint32_t pixelformat;     /* V4L2像素格式 */
+    int bits_per_pixel;       /* 每像素位数（压缩格式按原始帧计，只用于每帧大小上限） */
+    const char *guid;         /* 格式GUID */
+    int compressed;           /* 基于帧的压缩格式（framebased描述符，帧大小可变） */
+} uvc_format_info_t;
+
+/**
+ * 帧描述符（每个格式通告同一组帧，bFrameIndex从1开始按数组顺序）
+ */
+typedef struct {
+    int width;                              /* 宽度 */
+    int height;                             /* 高度 */
+    uint32_t intervals[UVC_MAX_INTERVALS];  /* 帧间隔（100ns单位），从短到长 */
+    int num_intervals;                      /* 帧间隔数 */
+} uvc_frame_info_t;
+
+/**
+ * 数据传输方式
+ */
+typedef enum {
+    UVC_IO_WRITE = 0,     /* write()拷贝：内核从帧缓冲复制数据 */
+    UVC_IO_USERPTR,       /* USERPTR：直接入队VDMA帧缓冲，USB控制器从同一块DDR读取 */
+    UVC_IO_MMAP,          /* MMAP：驱动分配缓冲，CPU写入转换后的帧 */
+} uvc_io_mode_t;
+
+/**
+ * UVC控制结构
+ */
+typedef struct {
+    int fd;                          /* V4L2设备文件描述符 */
+    int width;                       /* 视频宽度 */
+    int height;                      /* 视频高度 */
+    uint32_t pixelformat;            /* V4L2像素格式 */
+    uint32_t sizeimage;              /* 每帧字节数 */
+    uvc_io_mode_t io_mode;           /* 数据传输方式 */
+    int num_buffers;                 /* 已申请的缓冲数 */
+    int queued[UVC_MAX_BUFFERS];     /* 缓冲是否仍在驱动队列中 */
+    void *mem[UVC_MAX_BUFFERS];      /* MMAP模式下缓冲映射地址 */
+    size_t mem_length[UVC_MAX_BUFFERS]; /* MMAP模式下缓冲长度 */
+    int num_queued;                  /* 驱动队列中的缓冲数 */
+    int streaming;                   /* 是否已STREAMON */
+    
+    /* 格式协商 */
+    int bits_per_pixel;              /* 每像素位数，用于计算dwMaxVideoFrameSize */
+    const uvc_format_info_t *formats; /* 通告的格式描述符 */
+    int num_formats;                 /* 格式描述符数 */
+    const uvc_frame_info_t *frames;  /* 通告的帧描述符 */
+    int num_frames;                  /* 帧描述符数 */
+    struct uvc_streaming_control probe;   /* 当前PROBE状态 */
+    struct uvc_streaming_control commit;  /* 已提交的格式 */
+    int pending_control;             /* SET_CUR数据阶段对应的控制（PROBE/COMMIT），0表示无 */
+    int streaming_intf;              /* 视频流接口编号（uvc_init()设为UVC_INTF_STREAMING） */
+    uint32_t max_payload;            /* 每服务间隔最大负载（uvc_init()设为UVC_MAX_PAYLOAD） */
+    uint32_t max_payload_hs;         /* 连接为高速（USB2.0）时的最大负载 */
+    uint32_t frame_interval;         /* 已提交的帧间隔（100ns单位） */
+} uvc_control_t;
+
+/**
+ * 打开UVC设备并订阅Gadget事件
+ *
+ * 默认提交格式为第一个格式、第一个帧描述符的最短帧间隔，在主机COMMIT之前有效。
+ *
+ * @param uvc UVC控制结构指针
+ * @param device UVC设备路径（通常是/dev/video0）
+ * @param formats 通告的格式描述符
+ * @param num_formats 格式描述符数
+ * @param frames 通告的帧描述符
+ * @param num_frames 帧描述符数
+ * @return 0成功，-1失败
+ */
+int uvc_init(uvc_control_t *uvc, const char *device,
+             const uvc_format_info_t *formats, int num_formats,
+             const uvc_frame_info_t *frames, int num_frames);
+
+/**
+ * 处理一个UVC Gadget事件（非阻塞）
+ *
+ * SETUP/DATA事件在内部完成PROBE/COMMIT应答；COMMIT后uvc->pixelformat、
+ * uvc->width、uvc->height和uvc->frame_interval更新为主机选择的格式。
+ *
+ * @param uvc UVC控制结构指针
+ * @return uvc_event_result_t，出错返回-1
+ */
+int uvc_handle_event(uvc_control_t *uvc);
+
+/**
+ * 按已提交的分辨率设置输出队列格式（VIDIOC_S_FMT）
+ *
+ * @param uvc UVC控制结构指针
+ * @return 0成功，-1失败
+ */
+int uvc_set_format(uvc_control_t *uvc);
+
+/**
+ * 申请输出队列缓冲
+ *
+ * UVC_IO_WRITE模式下不申请缓冲，直接返回成功。
+ *
+ * @param uvc UVC控制结构指针
+ * @param io_mode 数据传输方式
+ * @param count 缓冲数量（USERPTR模式下与VDMA帧缓冲一一对应）
+ * @return 实际申请到的缓冲数，失败返回-1
+ */
+int uvc_request_buffers(uvc_control_t *uvc, uvc_io_mode_t io_mode, int count);
+
+/**
+ * 以USERPTR方式入队一帧
+ *
+ * 时间戳和序号写入v4l2_buffer，只在Gadget内部有效：vb2忽略输出缓冲的序号，负载头也没有
+ * 帧计数，序号不会传到主机；时间戳只有写PTS/SCR负载头的f_uvc版本才作为PTS发出（主机
+ * uvcvideo换算为主机时间）。主机需要设备序号和设备时间时用帧内时间戳（frame_stamp.h）。
+ *
+ * @param uvc UVC控制结构指针
+ * @param index 缓冲编号
+ * @param data 帧数据地址（VDMA帧缓冲映射地址）
+ * @param length 帧数据长度
+ * @param timestamp_ns 帧完成时间（CLOCK_MONOTONIC，纳秒）
+ * @param sequence 帧序号（VDMA帧计数，包括跳过的帧）
+ * @return 0成功，-1失败
+ */
+int uvc_queue_userptr(uvc_control_t *uvc, int index, const void *data, size_t length,
+                      uint64_t timestamp_ns, uint32_t sequence);
+
+/**
+ * 获取一个不在驱动队列中的MMAP缓冲
+ *
+ * @param uvc UVC控制结构指针
+ * @return 缓冲编号（映射地址为uvc->mem[编号]），没有空闲缓冲返回-1
+ */
+int uvc_get_free_buffer(uvc_control_t *uvc);
+
+/**
+ * 入队一个已写入数据的MMAP缓冲
+ *
+ * @param uvc UVC控制结构指针
+ * @param index 缓冲编号
+ * @param bytesused 有效数据长度
+ * @param timestamp_ns 帧完成时间（CLOCK_MONOTONIC，纳秒）
+ * @param sequence 帧序号（VDMA帧计数，包括跳过的帧）
+ * @return 0成功，-1失败
+ */
+int uvc_queue_buffer(uvc_control_t *uvc, int index, size_t bytesused,
+                     uint64_t timestamp_ns, uint32_t sequence);
+
+/**
+ * 回收一个已完成传输的缓冲（非阻塞）
+ *
+ * @param uvc UVC控制结构指针
+ * @return 缓冲编号，没有已完成的缓冲返回-1
+ */
+int uvc_dequeue(uvc_control_t *uvc);
+
+/**
+ * 以write()方式发送一帧
+ *
+ * @param uvc UVC控制结构指针
+ * @param data 帧数据地址
+ * @param length 帧数据长度
+ * @return 0成功，1设备忙（EAGAIN），-1失败
+ */
+int uvc_write_frame(uvc_control_t *uvc, const void *data, size_t length);
+
+/**
+ * 启动视频流（VIDIOC_STREAMON）
+ *
+ * @param uvc UVC控制结构指针
+ * @return 0成功，-1失败
+ */
+int uvc_stream_on(uvc_control_t *uvc);
+
+/**
+ * 停止视频流（VIDIOC_STREAMOFF），驱动队列中的缓冲全部归还
+ *
+ * @param uvc UVC控制结构指针
+ * @return 0成功，-1失败
+ */
+int uvc_stream_off(uvc_control_t *uvc);
+
+/**
+ * 释放输出队列缓冲（解除映射并REQBUFS 0），需要先uvc_stream_off()
+ *
+ * @param uvc UVC控制结构指针
+ */
+void uvc_release_buffers(uvc_control_t *uvc);
+
+/**
+ * USB链路是否空闲：第一个UDC（与setup_uvc.sh绑定的UDC一致）处于挂起或未连接状态
+ *
+ * @return 1挂起或未连接，0已连接（或读不到UDC状态）
+ */
+int uvc_link_suspended(void);
+
+/**
+ * 从ConfigFS读取UVC功能uvc.<instance>的视频流接口编号
+ *
+ * 接口编号由内核在Gadget绑定UDC时按功能链接顺序和每个功能的接口数分配
+ * （functions/uvc.N/streaming/bInterfaceNumber），不能由实例编号推算。
+ *
+ * @param instance UVC功能编号（uvc.N中的N）
+ * @return 接口编号，-1找不到
+ */
+int uvc_streaming_interface(int instance);
+
+/**
+ * 清理UVC资源
+ *
+ * @param uvc UVC控制结构指针
+ */
+void uvc_cleanup(uvc_control_t *uvc);
+
+#endif /* UVC_CONTROL_H */
@@ -0,0 +1,138 @@
+/**
+ * @file uvc_descriptor.c
+ * @brief UVC Gadget 描述符生成实现
+ */
+
+#include "uvc_descriptor.h"
+#include <string.h>
+
+/* 负载头最长12字节（含PTS和SCR），每个服务间隔一个负载 */
+#define UVC_PAYLOAD_HEADER_SIZE 12
+
+/**
+ * 未压缩帧的字节数
+ */
+static uint64_t uvc_frame_bytes(const uvc_format_info_t *format, const uvc_frame_info_t *frame)
+{
+    return (uint64_t)frame->width * frame->height * format->bits_per_pixel / 8;
+}
+
+/**
+ * 帧间隔（100ns单位）下的码率（bit/s），超出32位时钳位
+ */
+static uint32_t uvc_bitrate(uint64_t frame_bytes, uint32_t interval)
+{
+    uint64_t bps = frame_bytes * 8 * 10000000ULL / interval;
+
+    return bps > UINT32_MAX ? UINT32_MAX : (uint32_t)bps;
+}
+
+/**
+ * 按通告的格式和帧计算视频流端点参数
+ */
+int uvc_descriptor_calc_ep(const uvc_format_info_t *formats, int num_formats,
+                           const uvc_frame_info_t *frames, int num_frames,
+                           uint32_t bitrate, int bulk, uvc_streaming_ep_t *ep)
+{
+    uint64_t max_bytes_per_sec = 0;
+    uint64_t max_frame_bytes = 0;
+    int capped = 0;
+
+    memset(ep, 0, sizeof(uvc_streaming_ep_t));
+
+    for (int i = 0; i < num_formats; i++) {
+        for (int j = 0; j < num_frames; j++) {
+            uint64_t bytes_per_sec;
+
+            /* 压缩帧的大小上限也按原始帧计，与dwMaxVideoFrameSize一致 */
+            if (uvc_frame_bytes(&formats[i], &frames[j]) > max_frame_bytes) {
+                max_frame_bytes = uvc_frame_bytes(&formats[i], &frames[j]);
+            }
+            if (formats[i].compressed) {
+                bytes_per_sec = (uint64_t)bitrate / 8 * UVC_COMPRESSED_PEAK;
+            } else {
+                bytes_per_sec = uvc_frame_bytes(&formats[i], &frames[j]) * 10000000ULL /
+                                frames[j].intervals[0];
+            }
+            if (bytes_per_sec > max_bytes_per_sec) {
+                max_bytes_per_sec = bytes_per_sec;
+            }
+        }
+    }
+    ep->bytes_per_sec = max_bytes_per_sec;
+    ep->bulk = bulk;
+
+    if (bulk) {
+        /* 批量端点每包固定1024字节、突发16个包，整帧作为一个负载，只在帧首有负载头 */
+        ep->maxpacket = UVC_ISO_PACKET_SIZE;
+        ep->maxburst = UVC_ISO_MAX_BURST - 1;
+        ep->interval = 1;
+        ep->payload = max_frame_bytes + UVC_PAYLOAD_HEADER_SIZE;
+        ep->payload_hs = ep->payload;
+        return 0;
+    }
+
+    /* 每微帧都服务（interval=1）：延迟最低，加长服务间隔只是减少请求数 */
+    ep->interval = 1;
+
+    uint64_t need = (max_bytes_per_sec * UVC_ISO_HEADROOM + UVC_ISO_UFRAMES_PER_SEC - 1) /
+                    UVC_ISO_UFRAMES_PER_SEC + UVC_PAYLOAD_HEADER_SIZE;
+    uint64_t packets = (need + UVC_ISO_PACKET_SIZE - 1) / UVC_ISO_PACKET_SIZE;
+    if (packets > UVC_ISO_MAX_MULT * UVC_ISO_MAX_BURST) {
+        packets = UVC_ISO_MAX_MULT * UVC_ISO_MAX_BURST;
+        capped = 1;
+    }
+
+    /* 先增加突发包数，超过16个包再增加每微帧的事务数（mult） */
+    int mult = (int)((packets + UVC_ISO_MAX_BURST - 1) / UVC_ISO_MAX_BURST);
+    int burst = (int)((packets + mult - 1) / mult);
+
+    ep->maxpacket = UVC_ISO_PACKET_SIZE * mult;
+    ep->maxburst = burst - 1;
+    ep->payload = ep->maxpacket * burst;
+    /* 高速端点没有突发，每微帧mult个包 */
+    ep->payload_hs = ep->maxpacket;
+
+    return capped;
+}
+
+/**
+ * 输出setup_uvc.sh使用的描述符
+ */
+void uvc_descriptor_print(FILE *fp, const uvc_format_info_t *formats, int num_formats,
+                          const uvc_frame_info_t *frames, int num_frames,
+                          uint32_t bitrate, const uvc_streaming_ep_t *ep)
+{
+    fprintf(fp, "streaming %u %d %d %s\n", ep->maxpacket, ep->maxburst, ep->interval,
+            ep->bulk ? "bulk" : "iso");
+
+    for (int i = 0; i < num_formats; i++) {
+        const uvc_format_info_t *format = &formats[i];
+
+        /* 压缩格式的bBitsPerPixel为0 */
+        fprintf(fp, "format %s %s %s %d\n", format->name,
+                format->compressed ? "framebased" : "uncompressed", format->guid,
+                format->compressed ? 0 : format->bits_per_pixel);
+
+        for (int j = 0; j < num_frames; j++) {
+            const uvc_frame_info_t *frame = &frames[j];
+            uint64_t bytes = uvc_frame_bytes(format, frame);
+            uint32_t min_rate = bitrate;
+            uint32_t max_rate = bitrate;
+
+            if (!format->compressed) {
+                min_rate = uvc_bitrate(bytes, frame->intervals[frame->num_intervals - 1]);
+                max_rate = uvc_bitrate(bytes, frame->intervals[0]);
+            } else {
+                bytes = 0;
+            }
+
+            fprintf(fp, "frame %s %d %d %llu %u %u", format->name, frame->width, frame->height,
+                    (unsigned long long)bytes, min_rate, max_rate);
+            for (int k = 0; k < frame->num_intervals; k++) {
+                fprintf(fp, " %u", frame->intervals[k]);
+            }
+            fprintf(fp, "\n");
+        }
+    }
+}
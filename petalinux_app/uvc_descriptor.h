@@ -0,0 +1,89 @@
+/**
+ * @file uvc_descriptor.h
+ * @brief UVC Gadget 描述符生成
+ *
+ * 由应用程序的格式表和帧表（与PROBE/COMMIT协商使用的是同一份）生成ConfigFS
+ * 描述符，setup_uvc.sh 执行 `uvc-camera-app --descriptors` 读取后创建目录，
+ * 描述符和应用程序的运行参数（配置文件、-F/-p/-r/-B等）始终一致。
+ *
+ * 同时按最大码率计算视频流等时端点参数（streaming_maxpacket/maxburst/interval）：
+ * 内核默认每微帧只有1024字节（约8 MB/s），640x480 RGBA@60需要约74 MB/s，
+ * 超高速每个服务间隔最多3x16个1024字节的包（约393 MB/s）。端点按
+ * UVC_ISO_HEADROOM倍的码率预留带宽，不一下占满总线的周期性带宽，多路视频流可以共存。
+ *
+ * 批量传输（--transfer bulk）不预留带宽，繁忙的Hub上也能跑满剩余的超高速带宽：
+ * 端点每次突发16个包，每帧一个负载（dwMaxPayloadTransferSize为最大帧大小），
+ * 需要内核UVC功能支持streaming_bulk属性。
+ *
+ * 输出格式（每行一项，空格分隔）：
+ *   streaming <maxpacket> <maxburst> <interval> <iso|bulk>
+ *   format <名称> <uncompressed|framebased> <guid> <bBitsPerPixel>
+ *   frame <格式名称> <宽> <高> <dwMaxVideoFrameBufferSize> <dwMinBitRate> <dwMaxBitRate> <帧间隔...>
+ */
+
+#ifndef UVC_DESCRIPTOR_H
+#define UVC_DESCRIPTOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "uvc_control.h"
+
+/* 超高速等时端点：每包1024字节，每服务间隔最多3(mult)x16(burst)个包 */
+#define UVC_ISO_PACKET_SIZE    1024
+#define UVC_ISO_MAX_MULT       3
+#define UVC_ISO_MAX_BURST      16
+
+/* 每秒微帧数（服务间隔为1个微帧时） */
+#define UVC_ISO_UFRAMES_PER_SEC 8000
+
+/* 预留带宽相对最大码率的倍数：一帧在半个帧间隔内传完，降低传输延迟 */
+#define UVC_ISO_HEADROOM       2
+
+/* 压缩格式按目标码率的倍数预留（I帧比平均帧大得多） */
+#define UVC_COMPRESSED_PEAK    4
+
+/**
+ * 视频流等时端点参数
+ */
+typedef struct {
+    uint32_t maxpacket;       /* streaming_maxpacket：每微帧字节数（1024的1~3倍） */
+    int maxburst;             /* streaming_maxburst：超高速每次突发的额外包数（0~15） */
+    int interval;             /* streaming_interval：服务间隔为2^(interval-1)个微帧 */
+    uint32_t payload;         /* 超高速连接时每服务间隔字节数（dwMaxPayloadTransferSize） */
+    uint32_t payload_hs;      /* 高速连接时每服务间隔字节数 */
+    uint64_t bytes_per_sec;   /* 通告的格式中最大的码率（字节/秒） */
+    int bulk;                 /* 批量传输（streaming_bulk），否则为等时传输 */
+} uvc_streaming_ep_t;
+
+/**
+ * 按通告的格式和帧计算视频流端点参数
+ *
+ * @param formats 格式描述符
+ * @param num_formats 格式描述符数
+ * @param frames 帧描述符
+ * @param num_frames 帧描述符数
+ * @param bitrate 压缩格式的目标码率（bit/s）
+ * @param bulk 是否使用批量传输
+ * @param ep 计算结果
+ * @return 0成功，1需要的带宽超过超高速等时端点上限（结果为上限）
+ */
+int uvc_descriptor_calc_ep(const uvc_format_info_t *formats, int num_formats,
+                           const uvc_frame_info_t *frames, int num_frames,
+                           uint32_t bitrate, int bulk, uvc_streaming_ep_t *ep);
+
+/**
+ * 输出setup_uvc.sh使用的描述符
+ *
+ * @param fp 输出文件
+ * @param formats 格式描述符
+ * @param num_formats 格式描述符数
+ * @param frames 帧描述符
+ * @param num_frames 帧描述符数
+ * @param bitrate 压缩格式的目标码率（bit/s）
+ * @param ep 等时端点参数
+ */
+void uvc_descriptor_print(FILE *fp, const uvc_format_info_t *formats, int num_formats,
+                          const uvc_frame_info_t *frames, int num_frames,
+                          uint32_t bitrate, const uvc_streaming_ep_t *ep);
+
+#endif /* UVC_DESCRIPTOR_H */
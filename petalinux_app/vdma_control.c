@@ -4,6 +4,7 @@
  */
 
 #include "vdma_control.h"
+#include "uio_device.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,68 +13,593 @@
 #include <sys/mman.h>
 #include <errno.h>
 #include <dirent.h>
+#include <poll.h>
+#include <time.h>
+
+/* 设备树中的保留内存节点 */
+#define VDMA_DT_RESERVED_MEMORY  "/proc/device-tree/reserved-memory"
+
+/* 轮询状态位的超时（微秒）：复位、启动后离开HALTED、停止后进入HALTED（当前帧写完） */
+#define VDMA_RESET_TIMEOUT_US    100000
+#define VDMA_START_TIMEOUT_US    10000
+#define VDMA_STOP_TIMEOUT_US     50000
 /**
- * 打开UIO设备并映射VDMA寄存器
+ * 打开VDMA实例的UIO设备
  * 
- * @param vdma VDMA控制结构指针
+ * @param vdma VDMA控制结构指针（reg_phys为寄存器物理地址）
  * @return 0成功，-1失败
  */
 static int vdma_open_uio(vdma_control_t *vdma)
 {
-    struct dirent *entry;
-    DIR *dp;
-    char addr_path[128];
-    char addr_str[64];
-    unsigned long addr;
+    char dev_path[64];
+    
+    int index = uio_find_by_address(vdma->reg_phys);
+    if (index < 0) {
+        fprintf(stderr, "错误: 未找到物理地址为 0x%08X 的 VDMA UIO 设备\n", vdma->reg_phys);
+        return -1;
+    }
+    
+    snprintf(dev_path, sizeof(dev_path), "/dev/uio%d", index);
+    printf("成功找到 VDMA: %s (物理地址 0x%08X)\n", dev_path, vdma->reg_phys);
+    
+    vdma->uio_fd = open(dev_path, O_RDWR);
+    if (vdma->uio_fd < 0) {
+        fprintf(stderr, "无法打开设备 %s: %s\n", dev_path, strerror(errno));
+        return -1;
+    }
+    
+    return 0;
+}
 
-    dp = opendir("/sys/class/uio");
-    if (dp == NULL) {
-        fprintf(stderr, "无法打开 /sys/class/uio 目录\n");
+/**
+ * 从sysfs读取一个整数值
+ * 
+ * @param path sysfs文件路径
+ * @param val 读取结果
+ * @return 0成功，-1失败
+ */
+static int vdma_read_sysfs_ulong(const char *path, unsigned long *val)
+{
+    char buf[64];
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    
+    int ok = (fgets(buf, sizeof(buf), f) != NULL);
+    fclose(f);
+    if (!ok) {
         return -1;
     }
+    
+    *val = strtoul(buf, NULL, 0);
+    return 0;
+}
 
-    // 遍历所有 uioX 目录
-    while ((entry = readdir(dp))) {
-        // 跳过 . 和 .. 以及非 uio 开头的目录
-        if (strncmp(entry->d_name, "uio", 3) != 0) continue;
+/**
+ * 读取设备树属性中的一组大端32位单元
+ *
+ * @param path 属性文件路径
+ * @param cells 读取结果
+ * @param max 最多读取的单元数
+ * @return 读到的单元数，失败返回-1
+ */
+static int vdma_read_dt_cells(const char *path, uint32_t *cells, int max)
+{
+    uint8_t buf[64];
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+    
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    
+    int n = (int)(len / 4);
+    if (n > max) n = max;
+    for (int i = 0; i < n; i++) {
+        cells[i] = ((uint32_t)buf[i * 4] << 24) | ((uint32_t)buf[i * 4 + 1] << 16) |
+                   ((uint32_t)buf[i * 4 + 2] << 8) | buf[i * 4 + 3];
+    }
+    
+    return n;
+}
 
-        // 读取 map0/addr (物理地址)
-        // 路径格式: /sys/class/uio/uioX/maps/map0/addr
-        snprintf(addr_path, sizeof(addr_path), "/sys/class/uio/%s/maps/map0/addr", entry->d_name);
-        
-        FILE *f = fopen(addr_path, "r");
-        if (!f) continue;
+/**
+ * 设备树节点是否有某个属性
+ */
+static int vdma_dt_has_property(const char *node, const char *prop)
+{
+    char path[512];
+    
+    snprintf(path, sizeof(path), VDMA_DT_RESERVED_MEMORY "/%s/%s", node, prop);
+    return access(path, F_OK) == 0;
+}
 
-        if (fgets(addr_str, sizeof(addr_str), f)) {
-            // 将十六进制字符串转为长整型
-            addr = strtoul(addr_str, NULL, 0);
+/**
+ * 在设备树reserved-memory中定位帧缓冲
+ *
+ * /dev/mem方式下帧缓冲地址和大小都由应用指定，超出保留区域时VDMA会覆盖内核内存。
+ * - 指定了地址：检查[地址, 地址+大小)落在某个保留区域内
+ * - 地址为0：选择足够大的保留区域，优先名称含vdma/frame/video的节点和no-map节点；
+ *   CMA（reusable）区域会被内核分配出去，不使用
+ * 设备树中没有reserved-memory节点（如用mem=限制内核内存）时只打印警告，
+ * 地址为0时使用VDMA_DEFAULT_FB_PHYS。
+ *
+ * @param vdma VDMA控制结构指针（frame_buffer_phys为0时写入选中的地址）
+ * @return 0成功，-1没有合适的区域
+ */
+static int vdma_find_reserved_memory(vdma_control_t *vdma)
+{
+    char path[512];
+    char best_name[256] = "";
+    uint32_t cells[16];
+    int addr_cells = 2, size_cells = 2;
+    uint64_t phys = vdma->frame_buffer_phys;
+    uint64_t size = vdma->frame_buffer_size;
+    uint64_t best_base = 0, best_len = 0;
+    int best_score = -1;
+    
+    DIR *dp = opendir(VDMA_DT_RESERVED_MEMORY);
+    if (!dp) {
+        fprintf(stderr, "警告: 设备树中没有reserved-memory节点，无法检查帧缓冲范围\n");
+        if (phys == 0) {
+            vdma->frame_buffer_phys = VDMA_DEFAULT_FB_PHYS;
+        }
+        return 0;
+    }
+    
+    if (vdma_read_dt_cells(VDMA_DT_RESERVED_MEMORY "/#address-cells", cells, 1) == 1) {
+        addr_cells = cells[0];
+    }
+    if (vdma_read_dt_cells(VDMA_DT_RESERVED_MEMORY "/#size-cells", cells, 1) == 1) {
+        size_cells = cells[0];
+    }
+    
+    struct dirent *entry;
+    while ((entry = readdir(dp)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        
+        snprintf(path, sizeof(path), VDMA_DT_RESERVED_MEMORY "/%s/reg", entry->d_name);
+        int n = vdma_read_dt_cells(path, cells, 16);
+        int entry_cells = addr_cells + size_cells;
+        if (n <= 0 || entry_cells < 1 || entry_cells > 4) {
+            continue;
+        }
+        
+        int reusable = vdma_dt_has_property(entry->d_name, "reusable");
+        int score = 0;
+        if (strstr(entry->d_name, "vdma") || strstr(entry->d_name, "frame") ||
+            strstr(entry->d_name, "video")) {
+            score += 2;
+        }
+        if (vdma_dt_has_property(entry->d_name, "no-map")) {
+            score += 1;
+        }
+        
+        for (int i = 0; i + entry_cells <= n; i += entry_cells) {
+            uint64_t base = 0, len = 0;
+            for (int c = 0; c < addr_cells; c++) {
+                base = (base << 32) | cells[i + c];
+            }
+            for (int c = 0; c < size_cells; c++) {
+                len = (len << 32) | cells[i + addr_cells + c];
+            }
             
-            // 【核心判断】地址是否匹配 0x80020000
-            if (addr == VDMA_BASE_ADDR) {
-                char dev_path[64];
-                snprintf(dev_path, sizeof(dev_path), "/dev/%s", entry->d_name);
-                
-                printf("成功找到 VDMA: %s (物理地址 0x%08lX)\n", dev_path, addr);
-                
-                vdma->uio_fd = open(dev_path, O_RDWR);
-                if (vdma->uio_fd < 0) {
-                    fprintf(stderr, "无法打开设备 %s: %s\n", dev_path, strerror(errno));
-                    fclose(f);
-                    closedir(dp);
-                    return -1;
-                }
-                
-                fclose(f);
-                closedir(dp);
-                return 0; // 成功返回
+            int usable;
+            if (phys != 0) {
+                usable = phys >= base && phys + size <= base + len;
+            } else {
+                /* VDMA地址寄存器只有32位 */
+                usable = !reusable && len >= size && base + size <= 0x100000000ULL;
             }
+            
+            if (usable && score > best_score) {
+                best_score = score;
+                best_base = base;
+                best_len = len;
+                snprintf(best_name, sizeof(best_name), "%s", entry->d_name);
+            }
+        }
+    }
+    closedir(dp);
+    
+    if (best_score < 0) {
+        if (phys != 0) {
+            fprintf(stderr, "帧缓冲 0x%llx - 0x%llx 不在设备树任何reserved-memory区域内\n",
+                    (unsigned long long)phys, (unsigned long long)(phys + size));
+            fprintf(stderr, "提示: 减少帧缓冲数量/分辨率，或修改设备树和 --fb-phys\n");
+        } else {
+            fprintf(stderr, "设备树reserved-memory中没有不小于%llu字节的区域\n",
+                    (unsigned long long)size);
         }
-        fclose(f);
+        return -1;
+    }
+    
+    if (phys == 0) {
+        vdma->frame_buffer_phys = (uint32_t)best_base;
     }
+    printf("帧缓冲位于保留内存 %s: 0x%llx - 0x%llx（使用 %zu 字节）\n", best_name,
+           (unsigned long long)best_base, (unsigned long long)(best_base + best_len),
+           vdma->frame_buffer_size);
+    
+    return 0;
+}
 
+/**
+ * 查找第一个u-dma-buf设备
+ *
+ * @param name 设备名（输出）
+ * @param len name缓冲长度
+ * @return 0找到，-1没有
+ */
+static int vdma_find_udmabuf(char *name, size_t len)
+{
+    struct dirent *entry;
+    DIR *dp = opendir("/sys/class/u-dma-buf");
+    int ret = -1;
+    
+    if (!dp) {
+        return -1;
+    }
+    
+    /* 名称放不下的设备跳过，不截断成另一个设备名 */
+    while ((entry = readdir(dp)) != NULL) {
+        if (entry->d_name[0] != '.' &&
+            snprintf(name, len, "%s", entry->d_name) < (int)len) {
+            ret = 0;
+            break;
+        }
+    }
     closedir(dp);
-    fprintf(stderr, "错误: 未找到物理地址为 0x%08X 的 VDMA UIO 设备\n", VDMA_BASE_ADDR);
-    return -1;
+    
+    return ret;
+}
+
+#if !defined(__aarch64__)
+/**
+ * 向u-dma-buf的sysfs属性写入一个整数值
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param attr 属性名
+ * @param val 写入值
+ * @return 0成功，-1失败
+ */
+static int vdma_write_udmabuf_attr(vdma_control_t *vdma, const char *attr, unsigned long val)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/class/u-dma-buf/%s/%s", vdma->udmabuf_name, attr);
+    
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+    
+    int ret = (fprintf(f, "%lu", val) > 0) ? 0 : -1;
+    if (fclose(f) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+#endif
+
+/**
+ * 打开帧缓冲设备
+ * 
+ * u-dma-buf：打开/dev/<name>（不带O_SYNC，可缓存映射），物理地址和大小从sysfs读取；
+ * 否则打开/dev/mem（O_SYNC，非缓存映射）。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param udmabuf_name u-dma-buf设备名，NULL表示/dev/mem
+ * @return 文件描述符，失败返回-1
+ */
+static int vdma_open_frame_buffer(vdma_control_t *vdma, const char *udmabuf_name)
+{
+    char path[128];
+    char found_name[sizeof(vdma->udmabuf_name)];
+    unsigned long phys, size, coherent;
+    int fd;
+    
+    if (!udmabuf_name) {
+        if (vdma_find_reserved_memory(vdma) == 0) {
+            fd = open("/dev/mem", O_RDWR | O_SYNC);
+            if (fd < 0) {
+                fprintf(stderr, "打开/dev/mem失败: %s\n", strerror(errno));
+                fprintf(stderr, "提示: 确保内核启用了 /dev/mem 支持\n");
+            }
+            return fd;
+        }
+        
+        /* 自动选择时没有合适的保留区域，退回u-dma-buf */
+        if (vdma->frame_buffer_phys != 0 || vdma_find_udmabuf(found_name, sizeof(found_name)) < 0) {
+            return -1;
+        }
+        printf("使用u-dma-buf设备: %s\n", found_name);
+        udmabuf_name = found_name;
+    }
+    
+    if (snprintf(vdma->udmabuf_name, sizeof(vdma->udmabuf_name), "%s", udmabuf_name) >=
+        (int)sizeof(vdma->udmabuf_name)) {
+        fprintf(stderr, "u-dma-buf设备名过长: %s\n", udmabuf_name);
+        vdma->udmabuf_name[0] = '\0';
+        return -1;
+    }
+    
+    snprintf(path, sizeof(path), "/sys/class/u-dma-buf/%s/phys_addr", udmabuf_name);
+    if (vdma_read_sysfs_ulong(path, &phys) < 0) {
+        fprintf(stderr, "读取%s失败，请检查u-dma-buf驱动是否加载\n", path);
+        return -1;
+    }
+    
+    snprintf(path, sizeof(path), "/sys/class/u-dma-buf/%s/size", udmabuf_name);
+    if (vdma_read_sysfs_ulong(path, &size) < 0) {
+        fprintf(stderr, "读取%s失败\n", path);
+        return -1;
+    }
+    
+    if (size < vdma->frame_buffer_size) {
+        fprintf(stderr, "u-dma-buf %s 太小: %lu bytes，需要 %zu bytes\n",
+                udmabuf_name, size, vdma->frame_buffer_size);
+        return -1;
+    }
+    
+    if (vdma->frame_buffer_phys != 0 && vdma->frame_buffer_phys != phys) {
+        fprintf(stderr, "提示: 使用u-dma-buf物理地址 0x%08lX 代替 0x%08X\n",
+                phys, vdma->frame_buffer_phys);
+    }
+    vdma->frame_buffer_phys = (uint32_t)phys;
+    
+    snprintf(path, sizeof(path), "/sys/class/u-dma-buf/%s/dma_coherent", udmabuf_name);
+    vdma->dma_coherent = (vdma_read_sysfs_ulong(path, &coherent) == 0 && coherent != 0);
+    
+    snprintf(path, sizeof(path), "/dev/%s", udmabuf_name);
+    fd = open(path, O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "打开%s失败: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    vdma->cached = 1;
+    return fd;
+}
+
+/**
+ * 对帧缓冲的一段区域做Cache维护
+ * 
+ * ARM64上直接用DC CIVAC/DC CVAC指令（Linux允许EL0执行），其他平台通过
+ * u-dma-buf的sync_for_cpu/sync_for_device属性由内核完成。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param offset 帧缓冲内偏移
+ * @param size 区域大小
+ * @param for_cpu 1：DMA写入后CPU读取（失效），0：CPU写入后DMA读取（清理）
+ */
+static void vdma_cache_sync(vdma_control_t *vdma, size_t offset, size_t size, int for_cpu)
+{
+    if (!vdma->cached || vdma->dma_coherent || size == 0) {
+        return;
+    }
+    
+#if defined(__aarch64__)
+    uint64_t ctr;
+    __asm__ volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    size_t line = 4UL << ((ctr >> 16) & 0xF);   /* DminLine */
+    
+    uintptr_t start = ((uintptr_t)vdma->frame_buffer + offset) & ~(uintptr_t)(line - 1);
+    uintptr_t end = (uintptr_t)vdma->frame_buffer + offset + size;
+    
+    if (for_cpu) {
+        /* EL0不能执行DC IVAC，用清理+失效；DMA写入的帧CPU没有写过，清理不会写回数据 */
+        for (uintptr_t p = start; p < end; p += line) {
+            __asm__ volatile("dc civac, %0" : : "r"(p) : "memory");
+        }
+    } else {
+        for (uintptr_t p = start; p < end; p += line) {
+            __asm__ volatile("dc cvac, %0" : : "r"(p) : "memory");
+        }
+    }
+    __asm__ volatile("dsb sy" : : : "memory");
+#else
+    /* sync_direction: 1=DMA_TO_DEVICE, 2=DMA_FROM_DEVICE */
+    vdma_write_udmabuf_attr(vdma, "sync_offset", offset);
+    vdma_write_udmabuf_attr(vdma, "sync_size", size);
+    vdma_write_udmabuf_attr(vdma, "sync_direction", for_cpu ? 2 : 1);
+    vdma_write_udmabuf_attr(vdma, for_cpu ? "sync_for_cpu" : "sync_for_device", 1);
+#endif
+}
+
+/**
+ * 使能UIO中断（向UIO设备写1）
+ * 
+ * @param vdma VDMA控制结构指针
+ * @return 0成功，-1失败（UIO设备没有中断）
+ */
+static int vdma_irq_arm(vdma_control_t *vdma)
+{
+    uint32_t enable = 1;
+    
+    if (write(vdma->uio_fd, &enable, sizeof(enable)) != sizeof(enable)) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+/**
+ * 设置停靠指针：从下一帧开始，S2MM写入指定帧缓冲
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param frame 帧编号
+ */
+static void vdma_set_park(vdma_control_t *vdma, int frame)
+{
+    volatile uint32_t *park = (volatile uint32_t*)(vdma->base_addr + VDMA_PARK_PTR_REG);
+    uint32_t val = *park & ~VDMA_PARK_WR_REF_MASK;
+    
+    *park = val | ((uint32_t)frame << VDMA_PARK_WR_REF_SHIFT);
+}
+
+/**
+ * 处理一帧完成：发布最新帧，并把停靠指针切到一个空闲帧
+ * 
+ * 停靠指针在帧开始时生效，所以必须在帧消隐期内（下一帧开始前）完成切换。
+ * 如果切换晚了，下一帧仍写入旧帧缓冲，这里在下一次帧完成时通过
+ * WrFrmStore读回检测出来并计数。
+ * 
+ * @param vdma VDMA控制结构指针
+ */
+static void vdma_frame_done(vdma_control_t *vdma)
+{
+    /* 刚完成的帧实际写入的帧缓冲 */
+    int done = vdma_get_current_frame(vdma);
+    
+    if (done < 0 || done >= vdma->num_frames) {
+        done = vdma->write_frame;
+    } else if (done != vdma->write_frame) {
+        vdma->late_parks++;
+        if (done == vdma->latest_frame) {
+            /* 上一次发布的帧已经被覆盖 */
+            vdma->latest_frame = -1;
+        }
+    }
+    
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    vdma->sequence++;
+    vdma->frame_seq[done] = vdma->sequence;
+    vdma->frame_time_ns[done] = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    
+    /* 从刚完成的帧之后开始找一个没有被持有的帧作为下一帧写入目标 */
+    int next = -1;
+    for (int i = 1; i < vdma->num_frames; i++) {
+        int candidate = (done + i) % vdma->num_frames;
+        if (__atomic_load_n(&vdma->refcnt[candidate], __ATOMIC_ACQUIRE) == 0) {
+            next = candidate;
+            break;
+        }
+    }
+    
+    if (next < 0 && vdma->num_frames > 1) {
+        /* 没有空闲帧缓冲：继续写入同一帧，这一帧丢弃 */
+        vdma->frames_dropped++;
+        vdma->write_frame = done;
+        if (vdma->latest_frame == done) {
+            vdma->latest_frame = -1;
+        }
+        return;
+    }
+    
+    if (next < 0) {
+        /* 只有一个帧缓冲，无法避免撕裂 */
+        next = done;
+    } else {
+        vdma_set_park(vdma, next);
+    }
+    
+    vdma->write_frame = next;
+    vdma->latest_frame = done;
+}
+
+/**
+ * 软复位S2MM通道并写入帧格式、帧缓冲地址和帧缓冲数（vdma_init()和故障恢复共用）
+ *
+ * 每个帧缓冲对应一个START_ADDRn寄存器，VDMA IP的NUM_FSTORES必须不小于num_frames。
+ * 运行在停靠（Park）模式，由软件通过停靠指针决定下一帧写入哪个帧缓冲。
+ *
+ * @param vdma VDMA控制结构指针（寄存器已映射，帧格式字段已设置）
+ * @return 0成功，-1复位超时
+ */
+static int vdma_program(vdma_control_t *vdma)
+{
+    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_CONTROL) = VDMA_CTRL_RESET;
+    
+    /* 复位完成后Reset位自动清零 */
+    if (uio_poll_reg((volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_CONTROL),
+                     VDMA_CTRL_RESET, 0, VDMA_RESET_TIMEOUT_US) < 0) {
+        fprintf(stderr, "VDMA复位超时\n");
+        return -1;
+    }
+    
+    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_HSIZE) = (uint32_t)vdma->width * vdma->bytes_per_pixel;
+    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STRIDE) = vdma->stride;
+    
+    for (int i = 0; i < vdma->num_frames; i++) {
+        *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_START_ADDR(i)) =
+            vdma->frame_buffer_phys + (uint32_t)vdma->frame_size * i;
+    }
+    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_FRMSTORE) = vdma->num_frames;
+    
+    return 0;
+}
+
+/**
+ * 从指定帧缓冲开始运行S2MM通道（vdma_start()和故障恢复共用）
+ *
+ * @param vdma VDMA控制结构指针
+ * @param park 第一帧写入的帧缓冲
+ * @return 0成功，-1通道仍处于HALTED
+ */
+static int vdma_run(vdma_control_t *vdma, int park)
+{
+    vdma_set_park(vdma, park);
+    vdma->write_frame = park;
+    
+    /* 启动VDMA：Run + Park模式（不置Circular位），每帧产生一次帧计数中断 */
+    uint32_t ctrl = VDMA_CTRL_RUN |
+                    VDMA_CTRL_FRMCNT_IRQ_EN |
+                    (1 << VDMA_CTRL_IRQ_FRMCNT_SHIFT);
+    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS) = VDMA_STATUS_FRMCNT_IRQ | VDMA_STATUS_ERR_MASK;
+    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_CONTROL) = ctrl;
+    
+    /* 使能UIO中断（设备树中VDMA节点需要interrupts属性）；中断计数从这里重新开始比较 */
+    vdma->irq_enabled = (vdma_irq_arm(vdma) == 0);
+    vdma->irq_count = 0;
+    
+    /* 写VSize触发传输，通道开始运行后HALTED位清零 */
+    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_VSIZE) = vdma->height;
+    int halted = uio_poll_reg((volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS),
+                              VDMA_STATUS_HALTED, 0, VDMA_START_TIMEOUT_US) < 0;
+    
+    uint32_t status = *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS);
+    printf("VDMA状态: 0x%08X\n", status);
+    
+    return halted ? -1 : 0;
+}
+
+/**
+ * 计算帧缓冲行跨度
+ */
+uint32_t vdma_calc_stride(int width, int bytes_per_pixel)
+{
+    uint32_t hsize = (uint32_t)width * bytes_per_pixel;
+    
+    return (hsize + VDMA_STRIDE_ALIGN - 1) & ~(uint32_t)(VDMA_STRIDE_ALIGN - 1);
+}
+
+/**
+ * 解除帧缓冲和寄存器映射并关闭UIO设备（vdma_init()失败时和vdma_cleanup()共用）
+ *
+ * 映射失败的指针（MAP_FAILED）同样清空，之后base_addr为NULL表示未初始化。
+ */
+static void vdma_unmap(vdma_control_t *vdma)
+{
+    if (vdma->frame_buffer && vdma->frame_buffer != MAP_FAILED) {
+        munmap(vdma->frame_buffer, vdma->frame_buffer_size);
+    }
+    vdma->frame_buffer = NULL;
+    
+    if (vdma->base_addr && vdma->base_addr != MAP_FAILED) {
+        munmap(vdma->base_addr, VDMA_ADDR_SIZE);
+    }
+    vdma->base_addr = NULL;
+    
+    if (vdma->uio_fd >= 0) {
+        close(vdma->uio_fd);
+        vdma->uio_fd = -1;
+    }
 }
 
 /**
@@ -81,18 +607,30 @@ static int vdma_open_uio(vdma_control_t *vdma)
  */
 int vdma_init(vdma_control_t *vdma, int width, int height,
               int bytes_per_pixel, int num_frames,
-              uint32_t frame_buffer_phys)
+              uint32_t frame_buffer_phys, const char *udmabuf_name,
+              const char *device)
 {
     printf("初始化VDMA控制器...\n");
     
+    if (num_frames < 1 || num_frames > VDMA_MAX_FRAME_STORES) {
+        fprintf(stderr, "帧缓冲数量无效: %d (1~%d)\n", num_frames, VDMA_MAX_FRAME_STORES);
+        return -1;
+    }
+    
     memset(vdma, 0, sizeof(vdma_control_t));
     vdma->width = width;
     vdma->height = height;
     vdma->bytes_per_pixel = bytes_per_pixel;
     vdma->num_frames = num_frames;
     vdma->frame_buffer_phys = frame_buffer_phys;
-    vdma->frame_buffer_size = (size_t)width * height * bytes_per_pixel * num_frames;
+    vdma->stride = vdma_calc_stride(width, bytes_per_pixel);
+    vdma->frame_size = (size_t)vdma->stride * height;
     vdma->uio_fd = -1;
+    vdma->reg_phys = VDMA_BASE_ADDR;
+    
+    if (device && uio_resolve_address(device, &vdma->reg_phys) < 0) {
+        return -1;
+    }
     
     /* 打开UIO设备 */
     if (vdma_open_uio(vdma) < 0) {
@@ -107,26 +645,36 @@ int vdma_init(vdma_control_t *vdma, int width, int height,
     
     if (vdma->base_addr == MAP_FAILED) {
         fprintf(stderr, "映射VDMA寄存器失败: %s\n", strerror(errno));
-        close(vdma->uio_fd);
+        vdma_unmap(vdma);
         return -1;
     }
     
     printf("VDMA寄存器映射成功: %p\n", vdma->base_addr);
     
-    /* 映射帧缓冲（通过/dev/mem） */
-    int mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
+    /* 帧缓冲数寄存器需要IP启用Frame Store寄存器，读回0表示寄存器不存在；
+     * 写入值超过IP的帧缓冲数时读回IP支持的数量，映射帧缓冲之前先确定 */
+    volatile uint32_t *frmstore = (volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_FRMSTORE);
+    *frmstore = num_frames;
+    uint32_t hw_fstores = *frmstore & 0x1F;
+    if (hw_fstores != 0 && hw_fstores < (uint32_t)num_frames) {
+        fprintf(stderr, "警告: VDMA硬件只支持%u个帧缓冲，减少为%u个\n", hw_fstores, hw_fstores);
+        vdma->num_frames = num_frames = hw_fstores;
+    }
+    vdma->frame_buffer_size = vdma->frame_size * num_frames;
+    
+    /* 映射帧缓冲（u-dma-buf可缓存映射，或/dev/mem非缓存映射） */
+    int mem_fd = vdma_open_frame_buffer(vdma, udmabuf_name);
     if (mem_fd < 0) {
-        fprintf(stderr, "打开/dev/mem失败: %s\n", strerror(errno));
-        fprintf(stderr, "提示: 确保内核启用了 /dev/mem 支持\n");
-        munmap(vdma->base_addr, VDMA_ADDR_SIZE);
-        close(vdma->uio_fd);
+        vdma_unmap(vdma);
         return -1;
     }
+    frame_buffer_phys = vdma->frame_buffer_phys;
     
+    /* u-dma-buf从偏移0开始映射，/dev/mem按物理地址映射 */
     vdma->frame_buffer = mmap(NULL, vdma->frame_buffer_size,
                               PROT_READ | PROT_WRITE,
                               MAP_SHARED,
-                              mem_fd, frame_buffer_phys);
+                              mem_fd, vdma->cached ? 0 : frame_buffer_phys);
     close(mem_fd);
     
     if (vdma->frame_buffer == MAP_FAILED) {
@@ -134,60 +682,35 @@ int vdma_init(vdma_control_t *vdma, int width, int height,
         fprintf(stderr, "物理地址: 0x%08X, 大小: %zu bytes\n", 
                 frame_buffer_phys, vdma->frame_buffer_size);
         fprintf(stderr, "提示: 检查设备树reserved-memory配置\n");
-        munmap(vdma->base_addr, VDMA_ADDR_SIZE);
-        close(vdma->uio_fd);
+        vdma_unmap(vdma);
         return -1;
     }
     
-    printf("帧缓冲映射成功: %p (物理地址: 0x%08X)\n", 
-           vdma->frame_buffer, frame_buffer_phys);
-    
-    /* 复位VDMA */
-    printf("复位VDMA...\n");
-    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_CONTROL) = VDMA_CTRL_RESET;
-    usleep(10000);
-    
-    /* 等待复位完成 */
-    int timeout = 1000;
-    while ((*(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_CONTROL) & VDMA_CTRL_RESET) && timeout--) {
-        usleep(100);
-    }
+    printf("帧缓冲映射成功: %p (物理地址: 0x%08X, %s)\n", 
+           vdma->frame_buffer, frame_buffer_phys,
+           vdma->cached ? (vdma->dma_coherent ? "可缓存/硬件一致" : "可缓存") : "非缓存");
     
-    if (timeout == 0) {
-        fprintf(stderr, "VDMA复位超时\n");
+    /* 复位VDMA并写入帧格式和帧缓冲地址 */
+    printf("复位并配置VDMA...\n");
+    if (vdma_program(vdma) < 0) {
+        vdma_unmap(vdma);
         return -1;
     }
     
-    /* 配置VDMA参数 */
-    printf("配置VDMA参数...\n");
-    uint32_t hsize = width * bytes_per_pixel;
-    uint32_t stride = hsize;
-    
-    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_HSIZE) = hsize;
-    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STRIDE) = stride;
-    
-    /* 配置帧缓冲地址
-     * 注意：虽然VDMA硬件NUM_FSTORES=1，但我们仍然在DDR中分配多个帧缓冲
-     * 通过软件逻辑实现多缓冲，避免读写冲突
-     */
-    uint32_t frame_size = width * height * bytes_per_pixel;
-    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_START_ADDR1) = frame_buffer_phys;
-    
-    /* 配置多个帧缓冲地址（即使硬件只支持1个，也配置以支持软件多缓冲） */
-    if (num_frames >= 2) {
-        *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_START_ADDR2) = frame_buffer_phys + frame_size;
+    if (num_frames < 3) {
+        fprintf(stderr, "警告: 帧缓冲少于3个，消费者持有帧时新帧会被丢弃或撕裂\n");
     }
     
-    if (num_frames >= 3) {
-        *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_START_ADDR3) = frame_buffer_phys + frame_size * 2;
-    }
+    vdma->write_frame = 0;
+    vdma->latest_frame = -1;
     
+    uint32_t hsize = width * bytes_per_pixel;
     printf("VDMA初始化完成\n");
     printf("  分辨率: %dx%d\n", width, height);
     printf("  HSize: %d bytes\n", hsize);
-    printf("  Stride: %d bytes\n", stride);
+    printf("  Stride: %u bytes（按%d字节对齐）\n", vdma->stride, VDMA_STRIDE_ALIGN);
     printf("  帧缓冲数: %d\n", num_frames);
-    printf("  每帧大小: %d bytes\n", frame_size);
+    printf("  每帧大小: %zu bytes\n", vdma->frame_size);
     
     return 0;
 }
@@ -204,20 +727,16 @@ int vdma_start(vdma_control_t *vdma)
     
     printf("启动VDMA...\n");
     
-    /* 启动VDMA：Run + Circular模式 */
-    uint32_t ctrl = VDMA_CTRL_RUN | VDMA_CTRL_CIRCULAR;
-    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_CONTROL) = ctrl;
-    usleep(1000);
-    
-    /* 写VSize触发传输 */
-    *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_VSIZE) = vdma->height;
-    usleep(10000);
+    /* 从第0帧开始写入 */
+    vdma->latest_frame = -1;
+    memset(vdma->refcnt, 0, sizeof(vdma->refcnt));
     
-    /* 检查状态 */
-    uint32_t status = *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS);
-    printf("VDMA状态: 0x%08X\n", status);
+    int halted = vdma_run(vdma, 0) < 0;
+    if (!vdma->irq_enabled) {
+        fprintf(stderr, "警告: VDMA UIO设备没有中断，使用轮询方式检测帧完成\n");
+    }
     
-    if (status & VDMA_STATUS_HALTED) {
+    if (halted) {
         fprintf(stderr, "警告: VDMA处于HALTED状态\n");
         fprintf(stderr, "可能原因: 数据源未准备好或配置错误\n");
         return -1;
@@ -238,13 +757,60 @@ int vdma_stop(vdma_control_t *vdma)
     
     printf("停止VDMA...\n");
     
-    /* 清除Run位 */
+    /* 清除Run位，通道写完当前传输后进入HALTED */
     *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_CONTROL) = 0;
-    usleep(10000);
+    if (uio_poll_reg((volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS),
+                     VDMA_STATUS_HALTED, VDMA_STATUS_HALTED, VDMA_STOP_TIMEOUT_US) < 0) {
+        fprintf(stderr, "警告: VDMA停止超时\n");
+    }
+    
+    return 0;
+}
+
+/**
+ * 检查S2MM通道状态
+ */
+int vdma_check_health(vdma_control_t *vdma, uint32_t *errors)
+{
+    volatile uint32_t *status = (volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS);
+    uint32_t value = *status;
+    
+    *errors = value & VDMA_STATUS_ERR_MASK;
+    if ((value & VDMA_STATUS_HALTED) || (value & VDMA_STATUS_FATAL_MASK)) {
+        *errors |= value & VDMA_STATUS_HALTED;
+        return 1;
+    }
     
+    /* 帧尺寸错误不停止通道（C_FLUSH_ON_FSYNC），写1清除后继续 */
+    if (*errors) {
+        *status = *errors;
+    }
     return 0;
 }
 
+/**
+ * 故障恢复：软复位S2MM通道，重新写入寄存器后继续运行
+ */
+int vdma_recover(vdma_control_t *vdma)
+{
+    if (vdma_program(vdma) < 0) {
+        return -1;
+    }
+    
+    /* 停靠到一个没有被持有的帧缓冲（持有计数和已发布的帧保持不变） */
+    int park = vdma->write_frame;
+    for (int i = 0; i < vdma->num_frames; i++) {
+        int candidate = (vdma->write_frame + i) % vdma->num_frames;
+        if (candidate != vdma->latest_frame &&
+            __atomic_load_n(&vdma->refcnt[candidate], __ATOMIC_ACQUIRE) == 0) {
+            park = candidate;
+            break;
+        }
+    }
+    
+    return vdma_run(vdma, park);
+}
+
 /**
  * 获取当前VDMA正在写入的帧编号
  */
@@ -254,35 +820,183 @@ int vdma_get_current_frame(vdma_control_t *vdma)
         return -1;
     }
     
-    uint32_t status = *(volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS);
-    int frame = (status >> 24) & 0x3;  /* Frame Count字段（位24-25） */
+    uint32_t park = *(volatile uint32_t*)(vdma->base_addr + VDMA_PARK_PTR_REG);
+    int frame = (park >> VDMA_PARK_WR_STORE_SHIFT) & VDMA_PARK_WR_STORE_MASK;
     
     return frame;
 }
 
 /**
- * 清理VDMA资源
+ * 获取帧完成事件的文件描述符
  */
-void vdma_cleanup(vdma_control_t *vdma)
+int vdma_get_fd(vdma_control_t *vdma)
 {
-    if (!vdma) return;
+    return vdma->irq_enabled ? vdma->uio_fd : -1;
+}
+
+/**
+ * 处理一次帧完成事件（不阻塞）
+ */
+int vdma_handle_frame_event(vdma_control_t *vdma)
+{
+    volatile uint32_t *status = (volatile uint32_t*)(vdma->base_addr + VDMA_S2MM_STATUS);
     
-    printf("清理VDMA资源...\n");
+    if (!vdma->irq_enabled) {
+        /* 轮询：检查帧计数中断状态位 */
+        if (!(*status & VDMA_STATUS_FRMCNT_IRQ)) {
+            return 1;
+        }
+        *status = VDMA_STATUS_FRMCNT_IRQ;
+        vdma_frame_done(vdma);
+        return 0;
+    }
     
-    vdma_stop(vdma);
+    /* 读取中断计数，计数跳变说明中间有帧没被处理（它们写入的是同一个停靠帧） */
+    uint32_t count;
+    if (read(vdma->uio_fd, &count, sizeof(count)) != sizeof(count)) {
+        fprintf(stderr, "读取VDMA中断计数失败: %s\n", strerror(errno));
+        return -1;
+    }
+    if (vdma->irq_count != 0 && count - vdma->irq_count > 1) {
+        /* 漏掉的帧也计入序号，下游据此看出丢帧 */
+        vdma->frames_missed += count - vdma->irq_count - 1;
+        vdma->sequence += count - vdma->irq_count - 1;
+    }
+    vdma->irq_count = count;
     
-    if (vdma->frame_buffer && vdma->frame_buffer != MAP_FAILED) {
-        munmap(vdma->frame_buffer, vdma->frame_buffer_size);
-        vdma->frame_buffer = NULL;
+    /* 先切换停靠指针（必须赶在下一帧开始前），再清除中断状态并重新使能UIO中断 */
+    vdma_frame_done(vdma);
+    *status = VDMA_STATUS_FRMCNT_IRQ;
+    if (vdma_irq_arm(vdma) < 0) {
+        fprintf(stderr, "重新使能VDMA中断失败: %s\n", strerror(errno));
+        return -1;
     }
     
-    if (vdma->base_addr && vdma->base_addr != MAP_FAILED) {
-        munmap(vdma->base_addr, VDMA_ADDR_SIZE);
-        vdma->base_addr = NULL;
+    return 0;
+}
+
+/**
+ * 等待VDMA完成一帧
+ */
+int vdma_wait_frame(vdma_control_t *vdma, int timeout_ms)
+{
+    if (!vdma || !vdma->base_addr) {
+        return -1;
     }
     
-    if (vdma->uio_fd >= 0) {
-        close(vdma->uio_fd);
-        vdma->uio_fd = -1;
+    if (!vdma->irq_enabled) {
+        int waited_us = 0;
+        
+        while (vdma_handle_frame_event(vdma) != 0) {
+            if (waited_us >= timeout_ms * 1000) {
+                return 1;
+            }
+            usleep(1000);
+            waited_us += 1000;
+        }
+        return 0;
+    }
+    
+    struct pollfd pfd = { .fd = vdma->uio_fd, .events = POLLIN };
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) {
+        if (errno == EINTR) {
+            return 1;
+        }
+        fprintf(stderr, "等待VDMA中断失败: %s\n", strerror(errno));
+        return -1;
+    }
+    if (ret == 0) {
+        return 1;
+    }
+    
+    return vdma_handle_frame_event(vdma);
+}
+
+/**
+ * 获取最新完成的帧并持有它
+ */
+int vdma_acquire_latest(vdma_control_t *vdma)
+{
+    if (!vdma || vdma->latest_frame < 0) {
+        return -1;
     }
+    
+    __atomic_add_fetch(&vdma->refcnt[vdma->latest_frame], 1, __ATOMIC_ACQ_REL);
+    return vdma->latest_frame;
+}
+
+/**
+ * 释放持有的帧
+ */
+void vdma_release(vdma_control_t *vdma, int frame)
+{
+    if (!vdma || frame < 0 || frame >= vdma->num_frames) {
+        return;
+    }
+    
+    /* 可以在采集线程之外释放：DMA在下一次帧完成时才会重新选中它 */
+    if (__atomic_load_n(&vdma->refcnt[frame], __ATOMIC_ACQUIRE) > 0) {
+        __atomic_sub_fetch(&vdma->refcnt[frame], 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+/**
+ * CPU读取帧之前使其Cache失效
+ */
+void vdma_cache_invalidate(vdma_control_t *vdma, int frame)
+{
+    if (!vdma || frame < 0 || frame >= vdma->num_frames) {
+        return;
+    }
+    
+    vdma_cache_sync(vdma, vdma->frame_size * frame, vdma->frame_size, 1);
+}
+
+/**
+ * CPU写入帧之后清理Cache
+ */
+void vdma_cache_clean(vdma_control_t *vdma, int frame)
+{
+    if (!vdma || frame < 0 || frame >= vdma->num_frames) {
+        return;
+    }
+    
+    vdma_cache_sync(vdma, vdma->frame_size * frame, vdma->frame_size, 0);
+}
+
+/**
+ * CPU改写帧缓冲中的一小段数据
+ */
+void vdma_frame_write(vdma_control_t *vdma, int frame, size_t offset, const void *data, size_t len)
+{
+    if (!vdma || frame < 0 || frame >= vdma->num_frames || offset + len > vdma->frame_size) {
+        return;
+    }
+    
+    size_t start = vdma->frame_size * frame + offset;
+    vdma_cache_sync(vdma, start, len, 1);
+    memcpy((uint8_t*)vdma->frame_buffer + start, data, len);
+    vdma_cache_sync(vdma, start, len, 0);
+}
+
+/**
+ * 帧缓冲能否USERPTR入队：只有u-dma-buf映射可以被vb2固定
+ */
+int vdma_userptr_capable(const vdma_control_t *vdma)
+{
+    return vdma->frame_buffer && vdma->udmabuf_name[0] != '\0';
+}
+
+/**
+ * 清理VDMA资源
+ */
+void vdma_cleanup(vdma_control_t *vdma)
+{
+    if (!vdma) return;
+    
+    printf("清理VDMA资源...\n");
+    
+    vdma_stop(vdma);
+    vdma_unmap(vdma);
 }
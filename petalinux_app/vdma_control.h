@@ -8,6 +8,9 @@
  * - 配置帧缓冲地址
  * - 启动/停止DMA传输
  * - 获取当前写入的帧编号
+ * - 通过UIO中断等待帧完成
+ * - 停靠指针（Park）多帧缓冲管理：消费者持有的帧不会被DMA覆盖
+ * - 可缓存帧缓冲映射（u-dma-buf）及CPU访问前后的Cache维护
  */
 
 #ifndef VDMA_CONTROL_H
@@ -19,25 +22,63 @@
 #define VDMA_BASE_ADDR    0x80020000
 #define VDMA_ADDR_SIZE    0x10000
 
+/* VDMA 公共寄存器偏移 */
+#define VDMA_PARK_PTR_REG       0x28
+
 /* VDMA S2MM (Stream to Memory Mapped) 寄存器偏移 */
 #define VDMA_S2MM_CONTROL       0x30
 #define VDMA_S2MM_STATUS        0x34
+#define VDMA_S2MM_FRMSTORE      0x48   /* 0x18为MM2S通道的同名寄存器 */
 #define VDMA_S2MM_VSIZE         0xA0
 #define VDMA_S2MM_HSIZE         0xA4
 #define VDMA_S2MM_STRIDE        0xA8
 #define VDMA_S2MM_START_ADDR1   0xAC
 #define VDMA_S2MM_START_ADDR2   0xB0
 #define VDMA_S2MM_START_ADDR3   0xB4
+#define VDMA_S2MM_START_ADDR(n) (VDMA_S2MM_START_ADDR1 + 4 * (n))  /* n从0开始 */
+
+/* 不使用REG_INDEX时可直接访问的帧缓冲地址寄存器数（32位地址） */
+#define VDMA_MAX_FRAME_STORES   16
+
+/* 行跨度对齐：128位数据宽度×8拍的AXI突发，也是Cache行（64字节）的整数倍 */
+#define VDMA_STRIDE_ALIGN       128
+
+/* 设备树中找不到reserved-memory节点时使用的帧缓冲物理地址 */
+#define VDMA_DEFAULT_FB_PHYS    0x20000000
 
 /* Control Register位定义 */
 #define VDMA_CTRL_RUN           (1 << 0)
 #define VDMA_CTRL_CIRCULAR      (1 << 1)
 #define VDMA_CTRL_RESET         (1 << 2)
 #define VDMA_CTRL_GENLOCK       (1 << 3)
+#define VDMA_CTRL_FRMCNT_IRQ_EN (1 << 12) /* 帧计数中断使能 */
+#define VDMA_CTRL_ERR_IRQ_EN    (1 << 14) /* 错误中断使能 */
+#define VDMA_CTRL_IRQ_FRMCNT_SHIFT 16     /* IRQFrameCount字段（位16-23） */
+
+/* Park Pointer Register位定义 */
+#define VDMA_PARK_WR_REF_SHIFT  8         /* WrFrmPtrRef：停靠模式下S2MM写入的帧（位8-12） */
+#define VDMA_PARK_WR_REF_MASK   (0x1F << VDMA_PARK_WR_REF_SHIFT)
+#define VDMA_PARK_WR_STORE_SHIFT 24       /* WrFrmStore：S2MM当前写入的帧（位24-28，只读） */
+#define VDMA_PARK_WR_STORE_MASK 0x1F
 
 /* Status Register位定义 */
 #define VDMA_STATUS_HALTED      (1 << 0)
 #define VDMA_STATUS_IDLE        (1 << 1)
+#define VDMA_STATUS_INTERNAL_ERR (1 << 4) /* DMAIntErr：帧尺寸为0等内部错误 */
+#define VDMA_STATUS_SLAVE_ERR   (1 << 5)  /* DMASlvErr：AXI写响应SLVERR */
+#define VDMA_STATUS_DECODE_ERR  (1 << 6)  /* DMADecErr：AXI写响应DECERR（地址无效） */
+#define VDMA_STATUS_SOF_EARLY   (1 << 7)  /* SOFEarlyErr：行数少于VSize（写1清除） */
+#define VDMA_STATUS_EOL_EARLY   (1 << 8)  /* EOLEarlyErr：行短于HSize（写1清除） */
+#define VDMA_STATUS_SOF_LATE    (1 << 11) /* SOFLateErr：行数多于VSize（写1清除） */
+#define VDMA_STATUS_FRMCNT_IRQ  (1 << 12) /* 帧计数中断（写1清除） */
+#define VDMA_STATUS_ERR_IRQ     (1 << 14) /* 错误中断（写1清除） */
+#define VDMA_STATUS_EOL_LATE    (1 << 15) /* EOLLateErr：行长于HSize（写1清除） */
+
+/* 停止通道、必须复位才能恢复的错误 */
+#define VDMA_STATUS_FATAL_MASK  (VDMA_STATUS_INTERNAL_ERR | VDMA_STATUS_SLAVE_ERR | VDMA_STATUS_DECODE_ERR)
+/* 全部错误位 */
+#define VDMA_STATUS_ERR_MASK    (VDMA_STATUS_FATAL_MASK | VDMA_STATUS_SOF_EARLY | VDMA_STATUS_EOL_EARLY | \
+                                 VDMA_STATUS_SOF_LATE | VDMA_STATUS_EOL_LATE | VDMA_STATUS_ERR_IRQ)
 
 /**
  * VDMA控制结构
@@ -45,13 +86,30 @@
 typedef struct {
     void *base_addr;              /* 映射后的基地址 */
     int uio_fd;                   /* UIO设备文件描述符 */
+    uint32_t reg_phys;            /* 寄存器物理地址（区分多路采集的VDMA实例） */
     void *frame_buffer;           /* 帧缓冲映射地址 */
+    int cached;                   /* 帧缓冲是否为可缓存映射（u-dma-buf） */
+    int dma_coherent;             /* u-dma-buf是否为硬件一致性（无需Cache维护） */
+    char udmabuf_name[64];        /* u-dma-buf设备名（如udmabuf0），空表示/dev/mem */
     uint32_t frame_buffer_phys;   /* 帧缓冲物理地址 */
     size_t frame_buffer_size;     /* 帧缓冲总大小 */
+    size_t frame_size;            /* 每帧大小（stride * height） */
+    uint32_t stride;              /* 帧缓冲每行字节数（按VDMA_STRIDE_ALIGN对齐，可能大于行数据） */
     int width;                    /* 视频宽度 */
     int height;                   /* 视频高度 */
     int bytes_per_pixel;          /* 每像素字节数 */
     int num_frames;               /* 帧缓冲数量 */
+    int irq_enabled;              /* UIO中断是否可用 */
+    uint32_t irq_count;           /* 上次读取的UIO中断计数 */
+    uint32_t frames_missed;       /* 中断之间漏掉的帧数 */
+    int write_frame;              /* 停靠指针指向的帧（DMA正在写入） */
+    int latest_frame;             /* 最新完成的帧，-1表示还没有 */
+    int refcnt[VDMA_MAX_FRAME_STORES];        /* 消费者持有计数（原子访问），非0的帧DMA不会写入 */
+    uint32_t sequence;                        /* 已完成的帧计数（包括漏掉中断的帧） */
+    uint32_t frame_seq[VDMA_MAX_FRAME_STORES]; /* 每个帧缓冲中数据的帧序号 */
+    uint64_t frame_time_ns[VDMA_MAX_FRAME_STORES]; /* 帧完成时间（CLOCK_MONOTONIC，纳秒） */
+    uint32_t frames_dropped;      /* 没有空闲帧缓冲，被DMA原地覆盖的帧数 */
+    uint32_t late_parks;          /* 停靠指针切换晚于下一帧开始的次数（可能撕裂） */
 } vdma_control_t;
 
 /**
@@ -61,13 +119,29 @@ typedef struct {
  * @param width 视频宽度（像素）
  * @param height 视频高度（像素）
  * @param bytes_per_pixel 每像素字节数（如RGB888为3，RGBA为4）
- * @param num_frames 帧缓冲数量（建议3个，用于三缓冲）
- * @param frame_buffer_phys 帧缓冲物理地址（必须与设备树reserved-memory一致）
+ * @param num_frames 帧缓冲数量（1~VDMA_MAX_FRAME_STORES，消费者持有1帧时至少3个才不撕裂）；
+ *                   IP的帧缓冲数较少时减少为IP支持的数量，实际值见vdma->num_frames
+ * @param frame_buffer_phys 帧缓冲物理地址（必须在设备树reserved-memory区域内）；
+ *                          0表示自动选择：设备树中足够大的保留区域，没有时使用第一个u-dma-buf设备
+ * @param udmabuf_name u-dma-buf设备名（如"udmabuf0"）：帧缓冲使用可缓存映射，
+ *                     物理地址从sysfs读取；NULL表示通过/dev/mem做非缓存映射
+ * @param device VDMA实例：寄存器物理地址、设备树标签或UIO设备名（见uio_device.h）；
+ *               NULL表示VDMA_BASE_ADDR
  * @return 0成功，-1失败
  */
 int vdma_init(vdma_control_t *vdma, int width, int height, 
               int bytes_per_pixel, int num_frames,
-              uint32_t frame_buffer_phys);
+              uint32_t frame_buffer_phys, const char *udmabuf_name,
+              const char *device);
+
+/**
+ * 计算帧缓冲行跨度
+ *
+ * @param width 视频宽度（像素）
+ * @param bytes_per_pixel 每像素字节数
+ * @return 对齐到VDMA_STRIDE_ALIGN的每行字节数
+ */
+uint32_t vdma_calc_stride(int width, int bytes_per_pixel);
 
 /**
  * 启动VDMA
@@ -86,13 +160,133 @@ int vdma_start(vdma_control_t *vdma);
 int vdma_stop(vdma_control_t *vdma);
 
 /**
- * 获取当前VDMA正在写入的帧编号
+ * 检查S2MM通道状态（运行中每帧调用）
+ *
+ * 通道停止（HALTED）或出现DMA内部/从设备/地址译码错误时需要恢复；
+ * 只有帧尺寸错误（行数或行长与设置不符）时写1清除后继续运行。
+ *
+ * @param vdma VDMA控制结构指针
+ * @param errors 读到的错误位（VDMA_STATUS_ERR_MASK，HALTED时另含VDMA_STATUS_HALTED）
+ * @return 1需要vdma_recover()，0正常
+ */
+int vdma_check_health(vdma_control_t *vdma, uint32_t *errors);
+
+/**
+ * 故障恢复：软复位S2MM通道，按vdma_init()的顺序重新写入寄存器后继续运行
+ *
+ * 帧缓冲映射、持有计数和已发布的最新帧保持不变，消费者持有的帧（包括
+ * 仍在UVC队列中的USERPTR缓冲）不受影响，UVC视频流不需要停止。
+ * 只能在等待帧完成的线程中调用。
+ *
+ * @param vdma VDMA控制结构指针
+ * @return 0成功，-1复位超时或通道仍处于HALTED
+ */
+int vdma_recover(vdma_control_t *vdma);
+
+/**
+ * 获取当前VDMA正在写入的帧编号（Park Pointer寄存器WrFrmStore字段）
  * 
  * @param vdma VDMA控制结构指针
  * @return 帧编号（0, 1, 2...），失败返回-1
  */
 int vdma_get_current_frame(vdma_control_t *vdma);
 
+/**
+ * 获取帧完成事件的文件描述符，用于接入poll/epoll事件循环
+ * 
+ * @param vdma VDMA控制结构指针
+ * @return 可读即有帧完成的UIO设备描述符；轮询模式下返回-1，需要定时调用vdma_handle_frame_event()
+ */
+int vdma_get_fd(vdma_control_t *vdma);
+
+/**
+ * 处理一次帧完成事件（不阻塞）
+ * 
+ * 中断模式下在vdma_get_fd()可读时调用：读取中断计数、切换停靠指针、清除中断状态
+ * 并重新使能中断；轮询模式下检查一次帧计数中断状态位。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @return 0有新帧，1没有新帧，-1失败
+ */
+int vdma_handle_frame_event(vdma_control_t *vdma);
+
+/**
+ * 等待VDMA完成一帧写入
+ * 
+ * 使能UIO中断时阻塞在UIO设备上等待S2MM帧计数中断，返回前清除
+ * 中断状态并重新使能中断；UIO设备没有中断时退化为轮询中断状态位。
+ * 每完成一帧都会发布为最新帧，并把停靠指针切换到一个没有被持有的帧。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param timeout_ms 超时时间（毫秒）
+ * @return 0有新帧，1超时，-1失败
+ */
+int vdma_wait_frame(vdma_control_t *vdma, int timeout_ms);
+
+/**
+ * 获取最新完成的帧并持有它
+ * 
+ * 持有期间DMA不会写入该帧缓冲，用完必须调用vdma_release()。
+ * 帧序号见vdma->frame_seq[帧编号]。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @return 帧编号，还没有完成的帧返回-1
+ */
+int vdma_acquire_latest(vdma_control_t *vdma);
+
+/**
+ * 释放vdma_acquire_latest()持有的帧
+ * 
+ * 持有计数是原子操作，可以在等待帧完成的线程之外调用。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param frame 帧编号
+ */
+void vdma_release(vdma_control_t *vdma, int frame);
+
+/**
+ * CPU读取帧之前使其Cache失效（丢弃旧数据，读到DMA写入的内容）
+ * 
+ * 非缓存映射或硬件一致性的u-dma-buf上什么也不做。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param frame 帧编号
+ */
+void vdma_cache_invalidate(vdma_control_t *vdma, int frame);
+
+/**
+ * CPU写入帧之后清理Cache（写回DDR，供DMA或USB控制器读取）
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param frame 帧编号
+ */
+void vdma_cache_clean(vdma_control_t *vdma, int frame);
+
+/**
+ * CPU改写帧缓冲中的一小段数据（如帧内时间戳），之后由DMA或USB控制器读取
+ * 
+ * 可缓存映射下只对这一段做Cache维护：先失效（行内其余字节是DMA写入的新数据，
+ * 不能被Cache中的旧内容写回覆盖），写入后清理。
+ * 
+ * @param vdma VDMA控制结构指针
+ * @param frame 帧编号
+ * @param offset 帧内偏移
+ * @param data 数据
+ * @param len 数据长度
+ */
+void vdma_frame_write(vdma_control_t *vdma, int frame, size_t offset, const void *data, size_t len);
+
+/**
+ * 帧缓冲能否以USERPTR入队UVC输出队列
+ *
+ * /dev/mem的O_SYNC映射是VM_PFNMAP，vb2无法固定这些页，第一次QBUF就会失败；
+ * 只有u-dma-buf（普通页支撑的映射）可以零拷贝入队。
+ *
+ * @param vdma VDMA控制结构指针（vdma_init()之后）
+ * @return 1可以，0不可以
+ */
+int vdma_userptr_capable(const vdma_control_t *vdma);
+
 /**
  * 清理VDMA资源
  * 
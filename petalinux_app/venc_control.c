@@ -0,0 +1,409 @@
+/**
+ * @file venc_control.c
+ * @brief ZynqMP VCU H.264编码器控制实现（V4L2 M2M）
+ */
+
+#include "venc_control.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+#include <errno.h>
+
+/**
+ * 设置一个编码控制（驱动不支持时只打印警告）
+ */
+static void venc_set_ctrl(venc_control_t *venc, uint32_t id, int32_t value, const char *name)
+{
+    struct v4l2_control ctrl;
+
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.id = id;
+    ctrl.value = value;
+
+    if (ioctl(venc->fd, VIDIOC_S_CTRL, &ctrl) < 0) {
+        fprintf(stderr, "警告: 设置编码参数%s失败: %s\n", name, strerror(errno));
+    }
+}
+
+/**
+ * 设置编码输出（H.264）和输入（NV12）格式
+ *
+ * @param venc 编码器控制结构指针
+ * @return 0成功，-1失败
+ */
+static int venc_set_format(venc_control_t *venc)
+{
+    struct v4l2_format fmt;
+
+    /* 有状态编码器先设置编码格式，输入格式的对齐要求由它决定 */
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = venc->width;
+    fmt.fmt.pix.height = venc->height;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_H264;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+
+    if (ioctl(venc->fd, VIDIOC_S_FMT, &fmt) < 0) {
+        perror("设置编码器H.264格式失败");
+        return -1;
+    }
+
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    fmt.fmt.pix.width = venc->width;
+    fmt.fmt.pix.height = venc->height;
+    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_NV12;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix.bytesperline = venc->width;
+
+    if (ioctl(venc->fd, VIDIOC_S_FMT, &fmt) < 0) {
+        perror("设置编码器NV12输入格式失败");
+        return -1;
+    }
+
+    if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_NV12 ||
+        (int)fmt.fmt.pix.width != venc->width || (int)fmt.fmt.pix.height != venc->height) {
+        fprintf(stderr, "编码器不支持 %dx%d NV12输入\n", venc->width, venc->height);
+        return -1;
+    }
+
+    /* 格式转换按紧凑行写入，要求行跨度等于宽度；高度可以对齐，色度平面位于对齐后的亮度之后 */
+    if ((int)fmt.fmt.pix.bytesperline != venc->width) {
+        fprintf(stderr, "编码器要求行跨度%u，宽度%d需要对齐\n",
+                fmt.fmt.pix.bytesperline, venc->width);
+        return -1;
+    }
+
+    venc->sizeimage = fmt.fmt.pix.sizeimage;
+    venc->uv_offset = (size_t)fmt.fmt.pix.sizeimage * 2 / 3;
+
+    return 0;
+}
+
+/**
+ * 申请并映射一个队列的MMAP缓冲
+ *
+ * @param venc 编码器控制结构指针
+ * @param type 队列类型
+ * @param count 缓冲数
+ * @param mem 映射地址数组
+ * @param length 缓冲长度数组
+ * @return 实际缓冲数，失败返回-1
+ */
+static int venc_map_queue(venc_control_t *venc, uint32_t type, int count,
+                          void **mem, size_t *length)
+{
+    struct v4l2_requestbuffers req;
+    struct v4l2_buffer buf;
+
+    memset(&req, 0, sizeof(req));
+    req.count = count;
+    req.type = type;
+    req.memory = V4L2_MEMORY_MMAP;
+
+    if (ioctl(venc->fd, VIDIOC_REQBUFS, &req) < 0) {
+        perror("申请编码器缓冲失败 (VIDIOC_REQBUFS)");
+        return -1;
+    }
+
+    if ((int)req.count > count) {
+        req.count = count;
+    }
+
+    for (int i = 0; i < (int)req.count; i++) {
+        memset(&buf, 0, sizeof(buf));
+        buf.type = type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+
+        if (ioctl(venc->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            perror("查询编码器缓冲失败 (VIDIOC_QUERYBUF)");
+            return -1;
+        }
+
+        mem[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      venc->fd, buf.m.offset);
+        if (mem[i] == MAP_FAILED) {
+            perror("映射编码器缓冲失败");
+            mem[i] = NULL;
+            return -1;
+        }
+        length[i] = buf.length;
+    }
+
+    return req.count;
+}
+
+/**
+ * 入队一个输出（码流）缓冲
+ */
+static int venc_queue_output(venc_control_t *venc, int index)
+{
+    struct v4l2_buffer buf;
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+
+    if (ioctl(venc->fd, VIDIOC_QBUF, &buf) < 0) {
+        perror("编码器码流缓冲入队失败 (VIDIOC_QBUF)");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * 打开编码器，设置格式和编码参数，申请缓冲并开始编码
+ */
+int venc_init(venc_control_t *venc, const char *device, int width, int height,
+              uint32_t frame_interval, uint32_t bitrate)
+{
+    struct v4l2_capability cap;
+    struct v4l2_streamparm parm;
+    int type;
+
+    memset(venc, 0, sizeof(venc_control_t));
+    venc->fd = -1;
+    venc->width = width;
+    venc->height = height;
+
+    printf("初始化VCU编码器: %s (%dx%d, %u kbit/s)\n", device, width, height, bitrate / 1000);
+
+    venc->fd = open(device, O_RDWR | O_NONBLOCK);
+    if (venc->fd < 0) {
+        perror("打开编码器设备失败");
+        return -1;
+    }
+
+    if (ioctl(venc->fd, VIDIOC_QUERYCAP, &cap) < 0) {
+        perror("查询编码器能力失败");
+        goto fail;
+    }
+
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_M2M) || !(caps & V4L2_CAP_STREAMING)) {
+        fprintf(stderr, "%s (%s) 不是单平面V4L2 M2M编码器\n", device, cap.card);
+        goto fail;
+    }
+
+    if (venc_set_format(venc) < 0) {
+        goto fail;
+    }
+
+    /* 帧率用于码率控制分配每帧比特数 */
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    parm.parm.output.timeperframe.numerator = frame_interval;
+    parm.parm.output.timeperframe.denominator = 10000000;
+    if (ioctl(venc->fd, VIDIOC_S_PARM, &parm) < 0) {
+        fprintf(stderr, "警告: 设置编码帧率失败: %s\n", strerror(errno));
+    }
+
+    /* 无B帧保证一进一出；GOP为1秒，每个IDR前重复SPS/PPS，主机中途打开也能解码 */
+    int fps = frame_interval ? (int)((10000000 + frame_interval / 2) / frame_interval) : 30;
+    venc_set_ctrl(venc, V4L2_CID_MPEG_VIDEO_BITRATE_MODE, V4L2_MPEG_VIDEO_BITRATE_MODE_CBR, "码率模式");
+    venc_set_ctrl(venc, V4L2_CID_MPEG_VIDEO_BITRATE, bitrate, "码率");
+    venc_set_ctrl(venc, V4L2_CID_MPEG_VIDEO_B_FRAMES, 0, "B帧数");
+    venc_set_ctrl(venc, V4L2_CID_MPEG_VIDEO_GOP_SIZE, fps, "GOP长度");
+    venc_set_ctrl(venc, V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, 1, "重复序列头");
+
+    venc->num_input = venc_map_queue(venc, V4L2_BUF_TYPE_VIDEO_OUTPUT, VENC_NUM_INPUT,
+                                     venc->in_mem, venc->in_length);
+    if (venc->num_input < 0) {
+        goto fail;
+    }
+
+    venc->num_output = venc_map_queue(venc, V4L2_BUF_TYPE_VIDEO_CAPTURE, VENC_NUM_OUTPUT,
+                                      venc->out_mem, venc->out_length);
+    if (venc->num_output < 0) {
+        goto fail;
+    }
+
+    for (int i = 0; i < venc->num_output; i++) {
+        if (venc_queue_output(venc, i) < 0) {
+            goto fail;
+        }
+    }
+
+    type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    if (ioctl(venc->fd, VIDIOC_STREAMON, &type) < 0) {
+        perror("编码器输入队列STREAMON失败");
+        goto fail;
+    }
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(venc->fd, VIDIOC_STREAMON, &type) < 0) {
+        perror("编码器码流队列STREAMON失败");
+        goto fail;
+    }
+    venc->streaming = 1;
+
+    printf("VCU编码器初始化完成: %s, 输入缓冲%d个 (%u字节), 码流缓冲%d个\n",
+           cap.card, venc->num_input, venc->sizeimage, venc->num_output);
+
+    return 0;
+
+fail:
+    venc_cleanup(venc);
+    return -1;
+}
+
+/**
+ * 获取一个空闲的输入缓冲
+ */
+int venc_get_input(venc_control_t *venc)
+{
+    struct v4l2_buffer buf;
+
+    /* 回收编码器已读完的输入缓冲 */
+    for (;;) {
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        buf.memory = V4L2_MEMORY_MMAP;
+
+        if (ioctl(venc->fd, VIDIOC_DQBUF, &buf) < 0) {
+            break;
+        }
+        if (buf.index < VENC_NUM_INPUT) {
+            venc->in_queued[buf.index] = 0;
+        }
+    }
+
+    for (int i = 0; i < venc->num_input; i++) {
+        if (!venc->in_queued[i]) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * 入队一帧并等待编码输出
+ */
+int venc_encode(venc_control_t *venc, int index, uint64_t timestamp_ns,
+                int timeout_ms, venc_packet_t *packet)
+{
+    struct v4l2_buffer buf;
+    struct pollfd pfd = { .fd = venc->fd, .events = POLLIN };
+
+    if (index < 0 || index >= venc->num_input) {
+        return -1;
+    }
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    buf.bytesused = venc->sizeimage;
+    buf.timestamp.tv_sec = timestamp_ns / 1000000000ULL;
+    buf.timestamp.tv_usec = (timestamp_ns % 1000000000ULL) / 1000;
+
+    if (ioctl(venc->fd, VIDIOC_QBUF, &buf) < 0) {
+        perror("编码器输入缓冲入队失败 (VIDIOC_QBUF)");
+        return -1;
+    }
+    venc->in_queued[index] = 1;
+
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) {
+        return errno == EINTR ? 1 : -1;
+    }
+    if (ret == 0) {
+        return 1;
+    }
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (ioctl(venc->fd, VIDIOC_DQBUF, &buf) < 0) {
+        if (errno == EAGAIN) {
+            return 1;
+        }
+        perror("编码器码流缓冲出队失败 (VIDIOC_DQBUF)");
+        return -1;
+    }
+
+    if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+        fprintf(stderr, "警告: 编码器输出错误帧\n");
+        venc_queue_output(venc, buf.index);
+        return 1;
+    }
+
+    packet->index = buf.index;
+    packet->data = venc->out_mem[buf.index];
+    packet->length = buf.bytesused;
+    packet->keyframe = (buf.flags & V4L2_BUF_FLAG_KEYFRAME) != 0;
+
+    return 0;
+}
+
+/**
+ * 归还编码输出缓冲
+ */
+int venc_release_packet(venc_control_t *venc, const venc_packet_t *packet)
+{
+    return venc_queue_output(venc, packet->index);
+}
+
+/**
+ * 下一帧强制编码为IDR帧
+ */
+void venc_force_keyframe(venc_control_t *venc)
+{
+    venc_set_ctrl(venc, V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME, 0, "强制IDR");
+}
+
+/**
+ * 停止编码并释放资源
+ */
+void venc_cleanup(venc_control_t *venc)
+{
+    struct v4l2_requestbuffers req;
+    int type;
+
+    if (venc->fd < 0) {
+        return;
+    }
+
+    if (venc->streaming) {
+        type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        ioctl(venc->fd, VIDIOC_STREAMOFF, &type);
+        type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        ioctl(venc->fd, VIDIOC_STREAMOFF, &type);
+        venc->streaming = 0;
+    }
+
+    for (int i = 0; i < VENC_NUM_INPUT; i++) {
+        if (venc->in_mem[i]) {
+            munmap(venc->in_mem[i], venc->in_length[i]);
+            venc->in_mem[i] = NULL;
+        }
+    }
+    for (int i = 0; i < VENC_NUM_OUTPUT; i++) {
+        if (venc->out_mem[i]) {
+            munmap(venc->out_mem[i], venc->out_length[i]);
+            venc->out_mem[i] = NULL;
+        }
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.memory = V4L2_MEMORY_MMAP;
+    req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    ioctl(venc->fd, VIDIOC_REQBUFS, &req);
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    ioctl(venc->fd, VIDIOC_REQBUFS, &req);
+
+    close(venc->fd);
+    venc->fd = -1;
+    venc->num_input = 0;
+    venc->num_output = 0;
+}
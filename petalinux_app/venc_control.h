@@ -0,0 +1,112 @@
+/**
+ * @file venc_control.h
+ * @brief ZynqMP VCU H.264编码器控制接口（V4L2 M2M）
+ *
+ * 此模块封装对VCU编码器V4L2内存到内存设备（allegro-dvt驱动）的访问：
+ * - 输出队列（OUTPUT）接收NV12原始帧，CPU格式转换直接写入驱动分配的缓冲
+ * - 采集队列（CAPTURE）返回H.264码流（Annex B，每个缓冲一帧）
+ * - 码率、GOP、B帧等编码参数通过V4L2控制设置
+ *
+ * 使用同步方式：每入队一帧就等待对应的码流输出，不使用B帧，编码器不积压帧。
+ */
+
+#ifndef VENC_CONTROL_H
+#define VENC_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* 输入（原始帧）和输出（码流）缓冲数 */
+#define VENC_NUM_INPUT    2
+#define VENC_NUM_OUTPUT   4
+
+/**
+ * 一帧编码输出
+ */
+typedef struct {
+    int index;                 /* 采集队列缓冲编号，venc_release_packet()归还 */
+    const uint8_t *data;       /* 码流数据 */
+    size_t length;             /* 码流长度 */
+    int keyframe;              /* 是否为IDR帧 */
+} venc_packet_t;
+
+/**
+ * 编码器控制结构
+ */
+typedef struct {
+    int fd;                               /* V4L2 M2M设备文件描述符 */
+    int width;                            /* 编码宽度 */
+    int height;                           /* 编码高度 */
+    uint32_t sizeimage;                   /* 每个NV12输入帧字节数 */
+    size_t uv_offset;                     /* NV12色度平面在输入缓冲中的偏移 */
+    void *in_mem[VENC_NUM_INPUT];         /* 输入缓冲映射地址 */
+    size_t in_length[VENC_NUM_INPUT];     /* 输入缓冲长度 */
+    int in_queued[VENC_NUM_INPUT];        /* 输入缓冲是否仍在驱动队列中 */
+    int num_input;                        /* 已申请的输入缓冲数 */
+    void *out_mem[VENC_NUM_OUTPUT];       /* 输出缓冲映射地址 */
+    size_t out_length[VENC_NUM_OUTPUT];   /* 输出缓冲长度 */
+    int num_output;                       /* 已申请的输出缓冲数 */
+    int streaming;                        /* 两个队列是否已STREAMON */
+} venc_control_t;
+
+/**
+ * 打开编码器，设置格式和编码参数，申请缓冲并开始编码
+ *
+ * @param venc 编码器控制结构指针
+ * @param device 编码器设备路径
+ * @param width 宽度
+ * @param height 高度
+ * @param frame_interval 帧间隔（100ns单位，用于码率控制）
+ * @param bitrate 目标码率（bit/s）
+ * @return 0成功，-1失败
+ */
+int venc_init(venc_control_t *venc, const char *device, int width, int height,
+              uint32_t frame_interval, uint32_t bitrate);
+
+/**
+ * 获取一个空闲的输入缓冲（先回收编码器已读完的缓冲）
+ *
+ * 调用者把NV12帧写入venc->in_mem[index]，色度平面位于uv_offset处。
+ *
+ * @param venc 编码器控制结构指针
+ * @return 缓冲编号，没有空闲缓冲返回-1
+ */
+int venc_get_input(venc_control_t *venc);
+
+/**
+ * 入队一帧并等待编码输出
+ *
+ * @param venc 编码器控制结构指针
+ * @param index 输入缓冲编号
+ * @param timestamp_ns 帧时间戳（纳秒，驱动复制到输出缓冲）
+ * @param timeout_ms 等待编码输出的超时（毫秒）
+ * @param packet 编码输出
+ * @return 0得到输出，1超时没有输出，-1失败
+ */
+int venc_encode(venc_control_t *venc, int index, uint64_t timestamp_ns,
+                int timeout_ms, venc_packet_t *packet);
+
+/**
+ * 归还编码输出缓冲
+ *
+ * @param venc 编码器控制结构指针
+ * @param packet venc_encode()得到的输出
+ * @return 0成功，-1失败
+ */
+int venc_release_packet(venc_control_t *venc, const venc_packet_t *packet);
+
+/**
+ * 下一帧强制编码为IDR帧（丢弃码流后恢复解码）
+ *
+ * @param venc 编码器控制结构指针
+ */
+void venc_force_keyframe(venc_control_t *venc);
+
+/**
+ * 停止编码并释放资源（可重复调用）
+ *
+ * @param venc 编码器控制结构指针
+ */
+void venc_cleanup(venc_control_t *venc);
+
+#endif /* VENC_CONTROL_H */
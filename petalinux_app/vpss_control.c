@@ -4,6 +4,7 @@
  */
 
 #include "vpss_control.h"
+#include "uio_device.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,18 +13,92 @@
 #include <sys/mman.h>
 #include <errno.h>
 
+/* 轮询ap_idle的超时（微秒）：启动后离开空闲，停止后处理完当前帧进入空闲 */
+#define VPSS_START_TIMEOUT_US   10000
+#define VPSS_STOP_TIMEOUT_US    50000
+
 /**
- * 打开UIO设备并映射VPSS寄存器
+ * 读取UIO映射长度（/sys/class/uio/uioN/maps/map0/size）
  * 
+ * @param index UIO设备编号
+ * @return 映射长度，读取失败返回0
+ */
+static size_t vpss_uio_map_size(int index)
+{
+    char path[128];
+    char buf[32];
+    
+    snprintf(path, sizeof(path), "/sys/class/uio/uio%d/maps/map0/size", index);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    
+    int ok = (fgets(buf, sizeof(buf), f) != NULL);
+    fclose(f);
+    
+    return ok ? (size_t)strtoul(buf, NULL, 0) : 0;
+}
+
+/**
+ * 打开UIO设备编号为index的VPSS
+ *
  * @param vpss VPSS控制结构指针
+ * @param index UIO设备编号
  * @return 0成功，-1失败
  */
-static int vpss_open_uio(vpss_control_t *vpss)
+static int vpss_open_uio_index(vpss_control_t *vpss, int index)
+{
+    char uio_path[64];
+    
+    snprintf(uio_path, sizeof(uio_path), "/dev/uio%d", index);
+    vpss->uio_fd = open(uio_path, O_RDWR);
+    if (vpss->uio_fd < 0) {
+        fprintf(stderr, "打开%s失败: %s\n", uio_path, strerror(errno));
+        return -1;
+    }
+    
+    /* 完整配置的寄存器空间包含所有子核，据此识别比特流是否带缩放器 */
+    vpss->map_size = vpss_uio_map_size(index);
+    vpss->has_scaler = vpss->map_size >= VPSS_FULL_ADDR_SIZE;
+    if (vpss->map_size < VPSS_ADDR_SIZE) {
+        vpss->map_size = VPSS_ADDR_SIZE;
+    }
+    return 0;
+}
+
+/**
+ * 查找VPSS对应的UIO设备编号
+ *
+ * @param device VPSS实例（见vpss_init()），NULL表示按UIO设备名查找
+ * @param verbose 非0时打印找到的设备和失败原因
+ * @return UIO设备编号，-1未找到
+ */
+static int vpss_find_uio(const char *device, int verbose)
 {
     char uio_name[64];
     char uio_path[128];
     int i;
     
+    /* 多路采集：按实例的寄存器地址查找 */
+    if (device) {
+        uint32_t addr;
+        if (uio_resolve_address(device, &addr) < 0) {
+            return -1;
+        }
+        i = uio_find_by_address(addr);
+        if (i < 0) {
+            if (verbose) {
+                fprintf(stderr, "未找到物理地址为0x%08X的VPSS UIO设备\n", addr);
+            }
+            return -1;
+        }
+        if (verbose) {
+            printf("找到VPSS UIO设备: uio%d (物理地址 0x%08X)\n", i, addr);
+        }
+        return i;
+    }
+    
     /* 查找VPSS对应的UIO设备 */
     for (i = 0; i < 10; i++) {
         snprintf(uio_path, sizeof(uio_path), "/sys/class/uio/uio%d/name", i);
@@ -42,45 +117,345 @@ static int vpss_open_uio(vpss_control_t *vpss)
                 strstr(uio_name, "vpss") ||
                 strstr(uio_name, "VPSS") ||
                 strstr(uio_name, "video_proc")) {
-                snprintf(uio_path, sizeof(uio_path), "/dev/uio%d", i);
-                vpss->uio_fd = open(uio_path, O_RDWR);
-                
-                if (vpss->uio_fd < 0) {
-                    fprintf(stderr, "打开%s失败: %s\n", uio_path, strerror(errno));
-                    return -1;
+                if (verbose) {
+                    printf("找到VPSS UIO设备: %s (uio%d)\n", uio_name, i);
                 }
-                
-                printf("找到VPSS UIO设备: %s (uio%d)\n", uio_name, i);
-                return 0;
+                return i;
             }
         }
     }
     
-    fprintf(stderr, "未找到VPSS UIO设备\n");
-    fprintf(stderr, "请检查设备树配置和UIO驱动\n");
-    fprintf(stderr, "提示: 运行 check_uio.sh 脚本检查UIO设备\n");
+    if (verbose) {
+        fprintf(stderr, "未找到VPSS UIO设备\n");
+        fprintf(stderr, "请检查设备树配置和UIO驱动\n");
+        fprintf(stderr, "提示: 运行 check_uio.sh 脚本检查UIO设备\n");
+    }
     return -1;
 }
 
+/**
+ * 打开VPSS对应的UIO设备（寄存器在vpss_init()中映射）
+ * 
+ * @param vpss VPSS控制结构指针
+ * @param device VPSS实例（物理地址、设备树标签或UIO设备名），NULL按名字查找第一个
+ * @return 0成功，-1失败
+ */
+static int vpss_open_uio(vpss_control_t *vpss, const char *device)
+{
+    int index = vpss_find_uio(device, 1);
+    
+    return index < 0 ? -1 : vpss_open_uio_index(vpss, index);
+}
+
+/**
+ * 只读sysfs判断比特流是否带缩放器
+ */
+int vpss_probe_scaler(const char *device)
+{
+    int index = vpss_find_uio(device, 0);
+    
+    if (index < 0) {
+        return -1;
+    }
+    return vpss_uio_map_size(index) >= VPSS_FULL_ADDR_SIZE;
+}
+
+/**
+ * 写VPSS寄存器
+ */
+static inline void vpss_write(vpss_control_t *vpss, uint32_t offset, uint32_t value)
+{
+    *(volatile uint32_t*)(vpss->base_addr + offset) = value;
+}
+
+/**
+ * 读VPSS寄存器
+ */
+static inline uint32_t vpss_read(vpss_control_t *vpss, uint32_t offset)
+{
+    return *(volatile uint32_t*)(vpss->base_addr + offset);
+}
+
+/**
+ * 复位全部子核，然后只释放处理子核（输入保持复位）
+ *
+ * AXI写是posted的，读回GPIO确认复位已经送到子核；一次读访问远长于子核要求的
+ * 几个时钟周期的复位宽度，不需要固定延时。
+ */
+static void vpss_pulse_reset(vpss_control_t *vpss)
+{
+    vpss_write(vpss, VPSS_RESET_OFFSET, 0);
+    (void)vpss_read(vpss, VPSS_RESET_OFFSET);
+    vpss_write(vpss, VPSS_RESET_OFFSET, VPSS_RESET_IP_AXIS);
+}
+
+/*
+ * CSC系数（12位小数）与偏移（像素值）
+ *
+ * R = K11*Y + K12*U + K13*V + ROffset，G/B同理；YUV为限幅范围，输出RGB为全范围。
+ */
+static const struct {
+    int16_t k[3][3];
+    int16_t offset[3];
+} csc_matrices[] = {
+    [VPSS_CSC_IDENTITY] = {
+        { { 4096, 0, 0 }, { 0, 4096, 0 }, { 0, 0, 4096 } },
+        { 0, 0, 0 },
+    },
+    [VPSS_CSC_BT601] = {
+        { { 4768, 0, 6537 }, { 4768, -1605, -3330 }, { 4768, 8263, 0 } },
+        { -223, 136, -277 },
+    },
+    [VPSS_CSC_BT709] = {
+        { { 4768, 0, 7344 }, { 4768, -872, -2183 }, { 4768, 8651, 0 } },
+        { -248, 77, -289 },
+    },
+};
+
+/**
+ * 编程v_csc：格式、尺寸、系数矩阵和输出范围
+ * 
+ * @param vpss VPSS控制结构指针
+ * @param config 处理参数（CSC工作在缩放后的分辨率上）
+ */
+static void vpss_program_csc(vpss_control_t *vpss, const vpss_config_t *config)
+{
+    uint32_t base = vpss->csc_offset;
+    
+    vpss_write(vpss, base + VPSS_CSC_IN_FORMAT_REG, config->in_format);
+    vpss_write(vpss, base + VPSS_CSC_OUT_FORMAT_REG, config->out_format);
+    vpss_write(vpss, base + VPSS_CSC_WIDTH_REG, config->out_width);
+    vpss_write(vpss, base + VPSS_CSC_HEIGHT_REG, config->out_height);
+    
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            vpss_write(vpss, base + VPSS_CSC_K11_REG + (row * 3 + col) * 8,
+                       (uint32_t)(int32_t)csc_matrices[config->matrix].k[row][col]);
+        }
+        vpss_write(vpss, base + VPSS_CSC_ROFFSET_REG + row * 8,
+                   (uint32_t)(int32_t)csc_matrices[config->matrix].offset[row]);
+    }
+    
+    vpss_write(vpss, base + VPSS_CSC_CLAMP_MIN_REG, 0);
+    vpss_write(vpss, base + VPSS_CSC_CLIP_MAX_REG, 255);
+}
+
+/**
+ * 三次卷积核（Keys，a = -0.5）
+ */
+static double vpss_cubic(double x)
+{
+    if (x < 0) x = -x;
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+/**
+ * 生成并写入缩放滤波系数
+ * 
+ * 缩小时按比例展宽卷积核做抗混叠，每个相位的系数归一化到1.0（4096）。
+ * 
+ * @param vpss VPSS控制结构指针
+ * @param reg 系数表寄存器地址（子核偏移 + COEFF_BASE）
+ * @param size_in 输入尺寸
+ * @param size_out 输出尺寸
+ */
+static void vpss_load_coeffs(vpss_control_t *vpss, uint32_t reg, int size_in, int size_out)
+{
+    double scale = size_out < size_in ? (double)size_out / size_in : 1.0;
+    int16_t coeff[VPSS_SCALER_TAPS];
+    
+    for (int phase = 0; phase < VPSS_SCALER_PHASES; phase++) {
+        double frac = (double)phase / VPSS_SCALER_PHASES;
+        double weight[VPSS_SCALER_TAPS];
+        double sum = 0;
+        int total = 0;
+        
+        for (int tap = 0; tap < VPSS_SCALER_TAPS; tap++) {
+            double pos = tap - (VPSS_SCALER_TAPS / 2 - 1) - frac;
+            weight[tap] = vpss_cubic(pos * scale);
+            sum += weight[tap];
+        }
+        
+        for (int tap = 0; tap < VPSS_SCALER_TAPS; tap++) {
+            coeff[tap] = (int16_t)(weight[tap] / sum * VPSS_CSC_COEFF_ONE + 0.5);
+            total += coeff[tap];
+        }
+        /* 舍入误差补到中心抽头，保证直流增益严格为1 */
+        coeff[VPSS_SCALER_TAPS / 2 - 1] += VPSS_CSC_COEFF_ONE - total;
+        
+        for (int tap = 0; tap < VPSS_SCALER_TAPS; tap += 2) {
+            vpss_write(vpss, reg + (phase * VPSS_SCALER_TAPS + tap) * 2,
+                       (uint16_t)coeff[tap] | ((uint32_t)(uint16_t)coeff[tap + 1] << 16));
+        }
+    }
+}
+
+/**
+ * 计算并写入水平缩放器相位表（1像素/时钟）
+ * 
+ * 每项：[5:0]相位，[6]本周期读入新像素，[8]本周期输出像素；每个32位字存两项。
+ * 
+ * @param vpss VPSS控制结构指针
+ * @param width_in 输入宽度
+ * @param width_out 输出宽度
+ * @param pixel_rate 输入/输出步长（16位小数）
+ */
+static void vpss_load_hphases(vpss_control_t *vpss, int width_in, int width_out,
+                              uint32_t pixel_rate)
+{
+    int loop_width = width_in > width_out ? width_in : width_out;
+    int shift = VPSS_SCALER_STEP_SHIFT - 6;   /* 64相位取步长小数的高6位 */
+    uint32_t offset = 0;
+    int xwrite_pos = 0;
+    uint32_t word = 0;
+    
+    for (int x = 0; x < loop_width; x++) {
+        uint32_t phase = (offset >> shift) & (VPSS_SCALER_PHASES - 1);
+        uint32_t new_pix = 0;
+        uint32_t write_en = 0;
+        
+        if ((offset >> VPSS_SCALER_STEP_SHIFT) != 0) {
+            new_pix = 1;
+            offset -= 1 << VPSS_SCALER_STEP_SHIFT;
+        }
+        
+        if ((offset >> VPSS_SCALER_STEP_SHIFT) == 0 && xwrite_pos < width_out) {
+            offset += pixel_rate;
+            write_en = 1;
+            xwrite_pos++;
+        }
+        
+        uint32_t entry = phase | (new_pix << 6) | (write_en << 8);
+        if (x & 1) {
+            vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_PHASES_BASE + (x / 2) * 4,
+                       word | (entry << 16));
+        } else {
+            word = entry;
+        }
+    }
+    
+    if (loop_width & 1) {
+        vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_PHASES_BASE + (loop_width / 2) * 4, word);
+    }
+}
+
+/**
+ * 编程水平/垂直缩放器
+ * 
+ * @param vpss VPSS控制结构指针
+ * @param config 处理参数
+ */
+static void vpss_program_scaler(vpss_control_t *vpss, const vpss_config_t *config)
+{
+    uint32_t pixel_rate = ((uint64_t)config->in_width << VPSS_SCALER_STEP_SHIFT) / config->out_width;
+    uint32_t line_rate = ((uint64_t)config->in_height << VPSS_SCALER_STEP_SHIFT) / config->out_height;
+    
+    /* 先垂直后水平：垂直缩放器工作在输入宽度上 */
+    vpss_write(vpss, VPSS_VSCALER_OFFSET + VPSS_VSC_HEIGHT_IN_REG, config->in_height);
+    vpss_write(vpss, VPSS_VSCALER_OFFSET + VPSS_VSC_WIDTH_REG, config->in_width);
+    vpss_write(vpss, VPSS_VSCALER_OFFSET + VPSS_VSC_HEIGHT_OUT_REG, config->out_height);
+    vpss_write(vpss, VPSS_VSCALER_OFFSET + VPSS_VSC_LINERATE_REG, line_rate);
+    vpss_write(vpss, VPSS_VSCALER_OFFSET + VPSS_VSC_COLORMODE_REG, config->in_format);
+    vpss_load_coeffs(vpss, VPSS_VSCALER_OFFSET + VPSS_VSC_COEFF_BASE,
+                     config->in_height, config->out_height);
+    
+    vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_HEIGHT_REG, config->out_height);
+    vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_WIDTH_IN_REG, config->in_width);
+    vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_WIDTH_OUT_REG, config->out_width);
+    vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_COLORMODE_REG, config->in_format);
+    vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_COLORMODE_OUT_REG, config->in_format);
+    vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_PIXELRATE_REG, pixel_rate);
+    vpss_load_coeffs(vpss, VPSS_HSCALER_OFFSET + VPSS_HSC_COEFF_BASE,
+                     config->in_width, config->out_width);
+    vpss_load_hphases(vpss, config->in_width, config->out_width, pixel_rate);
+}
+
+/**
+ * 配置VPSS处理参数
+ */
+int vpss_configure(vpss_control_t *vpss, const vpss_config_t *config)
+{
+    if (!vpss || !vpss->base_addr) {
+        fprintf(stderr, "VPSS未初始化\n");
+        return -1;
+    }
+    
+    if (config->in_width <= 0 || config->in_height <= 0 ||
+        config->out_width <= 0 || config->out_height <= 0 ||
+        (config->in_width & 1) || (config->out_width & 1)) {
+        fprintf(stderr, "无效的VPSS分辨率: %dx%d -> %dx%d\n",
+                config->in_width, config->in_height, config->out_width, config->out_height);
+        return -1;
+    }
+    
+    if ((unsigned)config->matrix >= sizeof(csc_matrices) / sizeof(csc_matrices[0])) {
+        fprintf(stderr, "无效的CSC矩阵: %d\n", config->matrix);
+        return -1;
+    }
+    
+    int scaling = config->in_width != config->out_width ||
+                  config->in_height != config->out_height;
+    
+    /* 原始数据的两个字节不是亮度/色度，缩放滤波和非单位矩阵都会破坏数值 */
+    if (vpss->mode == VPSS_MODE_RAW16 && (scaling || config->matrix != VPSS_CSC_IDENTITY)) {
+        fprintf(stderr, "原始16位模式只能1:1直通\n");
+        return -1;
+    }
+    
+    if (scaling && !vpss->has_scaler) {
+        fprintf(stderr, "当前比特流的VPSS不含缩放器，无法缩放 %dx%d -> %dx%d\n",
+                config->in_width, config->in_height, config->out_width, config->out_height);
+        return -1;
+    }
+    
+    if (vpss->has_scaler &&
+        (config->in_width > VPSS_SCALER_MAX_WIDTH || config->out_width > VPSS_SCALER_MAX_WIDTH)) {
+        fprintf(stderr, "VPSS缩放宽度超过%d\n", VPSS_SCALER_MAX_WIDTH);
+        return -1;
+    }
+    
+    /* 完整配置下缩放器始终在数据通路上，不缩放时按1:1编程 */
+    if (vpss->has_scaler) {
+        vpss_program_scaler(vpss, config);
+    }
+    vpss_program_csc(vpss, config);
+    
+    vpss->width = config->in_width;
+    vpss->height = config->in_height;
+    vpss->out_width = config->out_width;
+    vpss->out_height = config->out_height;
+    vpss->config = *config;
+    
+    printf("VPSS配置: %dx%d -> %dx%d, 格式 %d -> %d, 矩阵 %d\n",
+           config->in_width, config->in_height, config->out_width, config->out_height,
+           config->in_format, config->out_format, config->matrix);
+    
+    return 0;
+}
+
 /**
  * 初始化VPSS
  */
-int vpss_init(vpss_control_t *vpss, int width, int height)
+int vpss_init(vpss_control_t *vpss, int width, int height, vpss_mode_t mode,
+              const char *device)
 {
     printf("初始化VPSS控制器...\n");
     
     memset(vpss, 0, sizeof(vpss_control_t));
     vpss->width = width;
     vpss->height = height;
+    vpss->mode = mode;
     vpss->uio_fd = -1;
     
     /* 打开UIO设备 */
-    if (vpss_open_uio(vpss) < 0) {
+    if (vpss_open_uio(vpss, device) < 0) {
         return -1;
     }
     
     /* 映射VPSS寄存器空间 */
-    vpss->base_addr = mmap(NULL, VPSS_ADDR_SIZE, 
+    vpss->base_addr = mmap(NULL, vpss->map_size, 
                            PROT_READ | PROT_WRITE, 
                            MAP_SHARED, 
                            vpss->uio_fd, 0);
@@ -91,23 +466,39 @@ int vpss_init(vpss_control_t *vpss, int width, int height)
         return -1;
     }
     
-    printf("VPSS寄存器映射成功: %p\n", vpss->base_addr);
+    printf("VPSS寄存器映射成功: %p (%s)\n", vpss->base_addr,
+           vpss->has_scaler ? "完整配置，含缩放器" : "CSC-only配置");
     
-    /* 读取版本信息 */
-    uint32_t version = *(volatile uint32_t*)(vpss->base_addr + VPSS_VERSION_REG);
-    printf("VPSS版本: 0x%08X\n", version);
-    
-    /* 复位VPSS */
-    printf("复位VPSS...\n");
-    *(volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG) = 0;
-    usleep(10000);
+    if (vpss->has_scaler) {
+        vpss->csc_offset = VPSS_CSC_OFFSET;
+        
+        /* 复位全部子核，然后只释放处理子核，输入保持复位直到vpss_start() */
+        printf("复位VPSS...\n");
+        vpss_pulse_reset(vpss);
+    } else {
+        vpss->csc_offset = 0;
+        
+        /* 复位VPSS */
+        printf("复位VPSS...\n");
+        *(volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG) = 0;
+        if (uio_poll_reg((volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG),
+                         VPSS_CTRL_IDLE, VPSS_CTRL_IDLE, VPSS_STOP_TIMEOUT_US) < 0) {
+            fprintf(stderr, "警告: VPSS没有进入空闲状态\n");
+        }
+        
+        /* 不使用VPSS中断：关闭并清除中断状态 */
+        *(volatile uint32_t*)(vpss->base_addr + VPSS_GIE_REG) = 0;
+        *(volatile uint32_t*)(vpss->base_addr + VPSS_IER_REG) = 0;
+        *(volatile uint32_t*)(vpss->base_addr + VPSS_ISR_REG) = 0x3;
+    }
     
-    /* 清除错误寄存器 */
-    *(volatile uint32_t*)(vpss->base_addr + VPSS_ERROR_REG) = 0xFFFFFFFF;
+    vpss->out_width = width;
+    vpss->out_height = height;
     
     printf("VPSS初始化完成\n");
     printf("  分辨率: %dx%d\n", width, height);
-    printf("  色彩转换: YUV422 → RGB888\n");
+    printf("  色彩转换: %s\n", mode == VPSS_MODE_YUV422 ? "YUV422 直通" :
+                               mode == VPSS_MODE_RAW16 ? "原始16位直通" : "YUV422 → RGB888");
     
     return 0;
 }
@@ -126,21 +517,26 @@ int vpss_start(vpss_control_t *vpss)
     
     /* 设置Control寄存器：启动 + 自动重启 */
     uint32_t ctrl = VPSS_CTRL_START | VPSS_CTRL_AUTO_RESTART;
-    *(volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG) = ctrl;
     
-    /* 等待启动完成 */
-    usleep(10000);
+    if (vpss->has_scaler) {
+        /* 从下游往上游依次启动子核，最后释放输入复位 */
+        vpss_write(vpss, VPSS_CSC_OFFSET + VPSS_AP_CTRL_REG, ctrl);
+        vpss_write(vpss, VPSS_HSCALER_OFFSET + VPSS_AP_CTRL_REG, ctrl);
+        vpss_write(vpss, VPSS_VSCALER_OFFSET + VPSS_AP_CTRL_REG, ctrl);
+        vpss_write(vpss, VPSS_RESET_OFFSET, VPSS_RESET_IP_AXIS | VPSS_RESET_VIDEO_IN);
+        printf("VPSS启动成功\n");
+        return 0;
+    }
     
-    /* 检查状态 */
-    uint32_t status = *(volatile uint32_t*)(vpss->base_addr + VPSS_STATUS_REG);
-    printf("VPSS状态: 0x%08X\n", status);
+    *(volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG) = ctrl;
     
-    /* 检查错误 */
-    uint32_t error = *(volatile uint32_t*)(vpss->base_addr + VPSS_ERROR_REG);
-    if (error != 0) {
-        fprintf(stderr, "警告: VPSS错误寄存器: 0x%08X\n", error);
+    /* 等待启动完成：开始处理后ap_idle清零 */
+    if (uio_poll_reg((volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG),
+                     VPSS_CTRL_IDLE, 0, VPSS_START_TIMEOUT_US) < 0) {
+        fprintf(stderr, "警告: VPSS没有开始处理（输入视频流是否存在？）\n");
     }
     
+    printf("VPSS状态: ap_ctrl 0x%08X\n", *(volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG));
     printf("VPSS启动成功\n");
     return 0;
 }
@@ -156,13 +552,55 @@ int vpss_stop(vpss_control_t *vpss)
     
     printf("停止VPSS处理...\n");
     
-    /* 清除Start位 */
+    if (vpss->has_scaler) {
+        /* 复位脉冲清空子核中残留的像素，寄存器同时被清零 */
+        vpss_pulse_reset(vpss);
+        return 0;
+    }
+    
+    /* 清除Start位，处理完当前帧后进入空闲 */
     *(volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG) = 0;
-    usleep(10000);
+    if (uio_poll_reg((volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG),
+                     VPSS_CTRL_IDLE, VPSS_CTRL_IDLE, VPSS_STOP_TIMEOUT_US) < 0) {
+        fprintf(stderr, "警告: VPSS停止超时\n");
+    }
     
     return 0;
 }
 
+/**
+ * 检查VPSS错误状态：HLS子核没有错误寄存器，故障由停顿检测发现
+ */
+int vpss_check_health(vpss_control_t *vpss, uint32_t *errors)
+{
+    (void)vpss;
+    *errors = 0;
+    return 0;
+}
+
+/**
+ * 故障恢复：复位VPSS，重新写入最近一次的配置后启动
+ */
+int vpss_recover(vpss_control_t *vpss)
+{
+    vpss_config_t config = vpss->config;
+    
+    if (vpss->has_scaler) {
+        vpss_pulse_reset(vpss);
+    } else {
+        *(volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG) = 0;
+        if (uio_poll_reg((volatile uint32_t*)(vpss->base_addr + VPSS_CTRL_REG),
+                         VPSS_CTRL_IDLE, VPSS_CTRL_IDLE, VPSS_STOP_TIMEOUT_US) < 0) {
+            fprintf(stderr, "警告: VPSS没有进入空闲状态\n");
+        }
+    }
+    
+    if (vpss_configure(vpss, &config) < 0) {
+        return -1;
+    }
+    return vpss_start(vpss);
+}
+
 /**
  * 清理VPSS资源
  */
@@ -175,7 +613,7 @@ void vpss_cleanup(vpss_control_t *vpss)
     vpss_stop(vpss);
     
     if (vpss->base_addr && vpss->base_addr != MAP_FAILED) {
-        munmap(vpss->base_addr, VPSS_ADDR_SIZE);
+        munmap(vpss->base_addr, vpss->map_size);
         vpss->base_addr = NULL;
     }
     
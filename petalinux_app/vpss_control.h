@@ -6,36 +6,139 @@
  * - 通过UIO访问VPSS寄存器
  * - 初始化VPSS
  * - 启动/停止视频处理
- * - 配置颜色空间转换（YUV422 -> RGB）
+ * - 配置输入/输出分辨率、颜色空间转换矩阵和缩放器（vpss_configure）
+ *
+ * 支持两种比特流配置：
+ * - "Color Space Conversion Only"：v_csc位于基地址，不能缩放
+ * - 带缩放器的完整配置：复位GPIO、水平/垂直缩放器和v_csc挂在内部互联上，
+ *   按下面的子核偏移访问（UIO映射大于VPSS_ADDR_SIZE时识别为此配置）
  */
 
 #ifndef VPSS_CONTROL_H
 #define VPSS_CONTROL_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 /* VPSS基地址（从Vivado Address Editor获取） */
 #define VPSS_BASE_ADDR    0x80000000
 #define VPSS_ADDR_SIZE    0x10000
 
-/* VPSS寄存器偏移（根据Xilinx VPSS IP核文档） */
-#define VPSS_CTRL_REG           0x0000  /* Control Register */
-#define VPSS_STATUS_REG         0x0004  /* Status Register */
-#define VPSS_ERROR_REG          0x0008  /* Error Register */
-#define VPSS_VERSION_REG        0x0010  /* Version Register */
+/* CSC-only配置下VPSS基地址就是v_csc HLS子核，0x00~0x0C为HLS的ap_ctrl和中断寄存器，
+ * 没有错误寄存器（ISR只有ap_done/ap_ready位），0x10起为VPSS_CSC_*参数寄存器 */
+#define VPSS_CTRL_REG           0x0000  /* ap_ctrl */
+#define VPSS_GIE_REG            0x0004  /* 全局中断使能 */
+#define VPSS_IER_REG            0x0008  /* 中断使能（bit0 ap_done，bit1 ap_ready） */
+#define VPSS_ISR_REG            0x000C  /* 中断状态（写1清除） */
+
+/* 完整配置下各子核相对基地址的偏移（Vivado Address Editor中VPSS内部互联的分配，需与比特流一致） */
+#define VPSS_HSCALER_OFFSET     0x00000   /* 水平缩放器 v_hscaler */
+#define VPSS_RESET_OFFSET       0x10000   /* 子核复位 AXI GPIO */
+#define VPSS_VSCALER_OFFSET     0x20000   /* 垂直缩放器 v_vscaler */
+#define VPSS_CSC_OFFSET         0x30000   /* 颜色空间转换 v_csc */
+#define VPSS_FULL_ADDR_SIZE     0x40000
+
+/* 复位GPIO数据位：置1释放复位 */
+#define VPSS_RESET_VIDEO_IN     (1 << 0)  /* AXI-Stream输入 */
+#define VPSS_RESET_IP_AXIS      (1 << 1)  /* 各处理子核 */
+
+/* HLS子核通用的ap_ctrl寄存器（各子核偏移0） */
+#define VPSS_AP_CTRL_REG        0x0000
+
+/* 水平缩放器寄存器偏移 */
+#define VPSS_HSC_HEIGHT_REG       0x0010
+#define VPSS_HSC_WIDTH_IN_REG     0x0018
+#define VPSS_HSC_WIDTH_OUT_REG    0x0020
+#define VPSS_HSC_COLORMODE_REG    0x0028
+#define VPSS_HSC_PIXELRATE_REG    0x0030
+#define VPSS_HSC_COLORMODE_OUT_REG 0x0038
+#define VPSS_HSC_COEFF_BASE       0x0800  /* 滤波系数，每个32位字存两个16位系数 */
+#define VPSS_HSC_PHASES_BASE      0x2000  /* 每个输出周期的相位表，每个32位字存两项 */
+
+/* 垂直缩放器寄存器偏移 */
+#define VPSS_VSC_HEIGHT_IN_REG    0x0010
+#define VPSS_VSC_WIDTH_REG        0x0018
+#define VPSS_VSC_HEIGHT_OUT_REG   0x0020
+#define VPSS_VSC_LINERATE_REG     0x0028
+#define VPSS_VSC_COLORMODE_REG    0x0030
+#define VPSS_VSC_COEFF_BASE       0x0800
+
+/* 缩放器参数（与比特流中IP配置一致：1像素/时钟，6抽头，64相位） */
+#define VPSS_SCALER_TAPS          6
+#define VPSS_SCALER_PHASES        64
+#define VPSS_SCALER_STEP_SHIFT    16      /* pixelrate/linerate为16位小数定点 */
+#define VPSS_SCALER_MAX_WIDTH     3840
+
+/* 颜色空间转换（v_csc）寄存器偏移，相对v_csc子核基址（CSC-only配置下即VPSS基地址） */
+#define VPSS_CSC_IN_FORMAT_REG  0x0010  /* 输入视频格式 */
+#define VPSS_CSC_OUT_FORMAT_REG 0x0018  /* 输出视频格式 */
+#define VPSS_CSC_WIDTH_REG      0x0020  /* 宽度 */
+#define VPSS_CSC_HEIGHT_REG     0x0028  /* 高度 */
+#define VPSS_CSC_K11_REG        0x0050  /* 系数矩阵K11，K12...K33依次间隔8字节 */
+#define VPSS_CSC_ROFFSET_REG    0x0098  /* R/Y偏移，G/B偏移依次间隔8字节 */
+#define VPSS_CSC_CLAMP_MIN_REG  0x00B0  /* 输出下限 */
+#define VPSS_CSC_CLIP_MAX_REG   0x00B8  /* 输出上限 */
+
+/* 视频格式编码 */
+#define VPSS_FORMAT_RGB         0
+#define VPSS_FORMAT_YUV444      1
+#define VPSS_FORMAT_YUV422      2
+#define VPSS_FORMAT_YUV420      3
+
+/* 系数定点格式：12位小数 */
+#define VPSS_CSC_COEFF_ONE      (1 << 12)
 
 /* Control Register位定义 */
 #define VPSS_CTRL_START         (1 << 0)  /* Start processing */
+#define VPSS_CTRL_IDLE          (1 << 2)  /* ap_idle：没有在处理（只读） */
 #define VPSS_CTRL_AUTO_RESTART  (1 << 7)  /* Auto restart */
 
+/**
+ * VPSS工作模式
+ */
+typedef enum {
+    VPSS_MODE_RGB = 0,    /* YUV422 -> RGB（比特流默认配置） */
+    VPSS_MODE_YUV422,     /* YUV422直通（单位矩阵），每像素2字节 */
+    VPSS_MODE_RAW16,      /* 原始16位数据按YUV422经单位矩阵原样通过，不缩放，每像素2字节 */
+} vpss_mode_t;
+
+/**
+ * 颜色空间转换矩阵
+ */
+typedef enum {
+    VPSS_CSC_IDENTITY = 0,   /* 单位矩阵（直通） */
+    VPSS_CSC_BT601,          /* YUV(16-235) -> RGB(0-255)，BT.601 */
+    VPSS_CSC_BT709,          /* YUV(16-235) -> RGB(0-255)，BT.709 */
+} vpss_csc_matrix_t;
+
+/**
+ * VPSS处理参数
+ */
+typedef struct {
+    int in_width;                /* 输入宽度（CameraLink有效像素） */
+    int in_height;               /* 输入高度 */
+    int out_width;               /* 输出宽度（与输入不同时需要缩放器） */
+    int out_height;              /* 输出高度 */
+    int in_format;               /* 输入视频格式（VPSS_FORMAT_*） */
+    int out_format;              /* 输出视频格式（VPSS_FORMAT_*） */
+    vpss_csc_matrix_t matrix;    /* 颜色空间转换矩阵 */
+} vpss_config_t;
+
 /**
  * VPSS控制结构
  */
 typedef struct {
     void *base_addr;      /* 映射后的基地址 */
+    size_t map_size;      /* 寄存器映射长度 */
     int uio_fd;           /* UIO设备文件描述符 */
+    int has_scaler;       /* 比特流是否包含缩放器（完整配置） */
+    uint32_t csc_offset;  /* v_csc子核相对基地址的偏移 */
     int width;            /* 视频宽度 */
     int height;           /* 视频高度 */
+    int out_width;        /* 输出宽度 */
+    int out_height;       /* 输出高度 */
+    vpss_mode_t mode;     /* 工作模式 */
+    vpss_config_t config; /* 最近一次vpss_configure()的参数，故障恢复时重新编程 */
 } vpss_control_t;
 
 /**
@@ -44,9 +147,36 @@ typedef struct {
  * @param vpss VPSS控制结构指针
  * @param width 视频宽度（像素）
  * @param height 视频高度（像素）
+ * @param mode 工作模式（RGB输出或YUV422直通）
+ * @param device VPSS实例：寄存器物理地址、设备树标签或UIO设备名（见uio_device.h）；
+ *               NULL表示按UIO设备名查找第一个VPSS
  * @return 0成功，-1失败
  */
-int vpss_init(vpss_control_t *vpss, int width, int height);
+int vpss_init(vpss_control_t *vpss, int width, int height, vpss_mode_t mode,
+              const char *device);
+
+/**
+ * 只读sysfs判断VPSS比特流是否带缩放器，不打开设备也不映射寄存器
+ *
+ * 用于在初始化PL之前确定可以通告给主机的分辨率（含--descriptors）。
+ *
+ * @param device VPSS实例，含义同vpss_init()
+ * @return 1完整配置（带缩放器），0仅CSC，-1未找到设备
+ */
+int vpss_probe_scaler(const char *device);
+
+/**
+ * 配置VPSS处理参数
+ * 
+ * 编程分辨率、CSC系数矩阵和缩放器。需要在vpss_start()之前调用；完整配置下
+ * vpss_stop()会复位子核寄存器，重新启动前需要再次配置。
+ * 输出分辨率与输入不同而比特流不含缩放器时返回失败。
+ * 
+ * @param vpss VPSS控制结构指针
+ * @param config 处理参数
+ * @return 0成功，-1失败
+ */
+int vpss_configure(vpss_control_t *vpss, const vpss_config_t *config);
 
 /**
  * 启动VPSS处理
@@ -64,6 +194,26 @@ int vpss_start(vpss_control_t *vpss);
  */
 int vpss_stop(vpss_control_t *vpss);
 
+/**
+ * 检查VPSS错误状态（运行中每帧调用）
+ *
+ * 两种配置的子核都是HLS核，没有错误寄存器，目前总是返回0；VPSS故障表现为
+ * 没有新帧，由调用者的停顿检测处理并调用vpss_recover()。
+ *
+ * @param vpss VPSS控制结构指针
+ * @param errors 错误状态（总是0）
+ * @return 1需要vpss_recover()，0正常
+ */
+int vpss_check_health(vpss_control_t *vpss, uint32_t *errors);
+
+/**
+ * 故障恢复：复位VPSS，重新写入最近一次的配置后启动（与vpss_init()相同的复位顺序）
+ *
+ * @param vpss VPSS控制结构指针
+ * @return 0成功，-1失败
+ */
+int vpss_recover(vpss_control_t *vpss);
+
 /**
  * 清理VPSS资源
  * 
@@ -44,7 +44,7 @@ while [[ $# -gt 0 ]]; do
             echo "  -w, --width <N>    视频宽度 (默认: 640)"
             echo "  -h, --height <N>   视频高度 (默认: 480)"
             echo "  -f, --fps <N>      帧率 (默认: 30)"
-            echo "  -t, --test         测试模式 (不使用 VDMA)"
+            echo "  -t, --test         测试模式 (不使用 VDMA，运行 uvc-camera-bench)"
             echo ""
             echo "示例:"
             echo "  $0                      # 默认 640x480@30fps"
@@ -142,12 +142,20 @@ if [ ! -x "$UVC_STREAM" ]; then
     exit 1
 fi
 
-# 构建命令行参数
-ARGS="-w $WIDTH -H $HEIGHT -f $FPS"
+# 测试模式使用 VPSS/VDMA 替身 (make bench)，测试图案按 FPS 产生
 if [ $TEST_MODE -eq 1 ]; then
-    ARGS="$ARGS --test"
+    UVC_STREAM="/usr/bin/uvc-camera-bench"
+    export VDMA_STUB_FPS="$FPS"
+    if [ ! -x "$UVC_STREAM" ]; then
+        echo "错误: 测试模式需要 uvc-camera-bench"
+        echo "请先编译: cd ${PROJECT_ROOT}/petalinux_app && make bench && make install"
+        exit 1
+    fi
 fi
 
+# 构建命令行参数
+ARGS="-w $WIDTH -H $HEIGHT -f $FPS"
+
 echo "运行: $UVC_STREAM $ARGS"
 echo ""
 echo "================================================"
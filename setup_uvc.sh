@@ -14,15 +14,28 @@ MANUFACTURER="Xilinx"
 PRODUCT="ZynqMP UVC Camera"
 SERIAL="0123456789"
 
-WIDTH=640
-HEIGHT=480
-FORMAT="rgba"         # RGBA 32位格式
+# 格式、帧尺寸、帧间隔和等时端点参数由应用程序按同一份运行参数生成
+# （/etc/uvc-camera.conf 和命令行选项，见 uvc-camera-app --descriptors），
+# 用法: sudo ./setup_uvc.sh [默认格式] [应用程序选项...]，如 ./setup_uvc.sh yuyv -r 0,0,320,240
+# 默认格式为主机首选的格式（应用程序 -F），流水线能输出的其他格式一并通告
+UVC_APP="${UVC_APP:-/usr/bin/uvc-camera-app}"
+APP_ARGS=()
+if [ -n "$1" ] && [ "${1#-}" = "$1" ]; then
+    APP_ARGS+=(-F "$1")
+    shift
+elif [ -n "$FORMAT" ]; then
+    APP_ARGS+=(-F "$FORMAT")
+fi
+APP_ARGS+=("$@")
+# 视频流数（多路采集：每路一个 UVC 功能 uvc.0、uvc.1...，对应应用程序 --instance 0、1...）
+# 每路的描述符单独生成：APP_ARGS_<N> 追加第 N 路的应用程序选项（与启动该路时相同），
+# 如 APP_ARGS_1="--config /etc/uvc-camera-1.conf"
+NUM_STREAMS="${NUM_STREAMS:-1}"
 
 # ConfigFS 路径
 CONFIGFS="/sys/kernel/config"
 GADGET_NAME="g1"
 GADGET="$CONFIGFS/usb_gadget/$GADGET_NAME"
-FUNCTION="$GADGET/functions/uvc.0"
 CONFIG="$GADGET/configs/c.1"
 
 # ============================================
@@ -99,10 +112,12 @@ cleanup_gadget() {
                 done
                 
                 # 删除帧格式目录
-                for frame_dir in "$func_dir"streaming/uncompressed/*/*/; do
+                for frame_dir in "$func_dir"streaming/uncompressed/*/*/ \
+                                 "$func_dir"streaming/framebased/*/*/; do
                     [ -d "$frame_dir" ] && rmdir "$frame_dir" 2>/dev/null
                 done
-                for format_dir in "$func_dir"streaming/uncompressed/*/; do
+                for format_dir in "$func_dir"streaming/uncompressed/*/ \
+                                  "$func_dir"streaming/framebased/*/; do
                     [ -d "$format_dir" ] && rmdir "$format_dir" 2>/dev/null
                 done
                 
@@ -142,6 +157,21 @@ cleanup_gadget() {
 # 主程序开始
 # ============================================
 
+# 生成描述符
+if [ ! -x "$UVC_APP" ]; then
+    echo "错误: 找不到 $UVC_APP（可用 UVC_APP=<路径> 指定）"
+    exit 1
+fi
+DESCRIPTORS=()
+for i in $(seq 0 $((NUM_STREAMS - 1))); do
+    extra_var="APP_ARGS_$i"
+    read -r -a EXTRA_ARGS <<< "${!extra_var}"
+    if ! DESCRIPTORS[$i]=$("$UVC_APP" --instance $i "${APP_ARGS[@]}" "${EXTRA_ARGS[@]}" --descriptors); then
+        echo "错误: 生成 uvc.$i 的描述符失败，请检查应用程序选项: ${APP_ARGS[*]} ${EXTRA_ARGS[*]}"
+        exit 1
+    fi
+done
+
 # 检查 root 权限
 if [ "$EUID" -ne 0 ]; then
     echo "错误: 请使用 root 权限运行此脚本"
@@ -221,68 +251,93 @@ echo "  ✅ 配置创建完成"
 # 8. 配置 UVC 功能 (Function)
 echo ""
 echo "[6/7] 配置 UVC 参数..."
-mkdir -p $FUNCTION
-
-# 8.1 控制接口 (Control Interface)
-mkdir -p $FUNCTION/control/header/h
-ln -s $FUNCTION/control/header/h $FUNCTION/control/class/fs/h 2>/dev/null || true
-ln -s $FUNCTION/control/header/h $FUNCTION/control/class/ss/h 2>/dev/null || true
-
-# 8.2 流接口 (Streaming Interface)
-# 设置格式: RGBA (Uncompressed 32-bit)
-mkdir -p $FUNCTION/streaming/uncompressed/u/$FORMAT
-
-# 设置 RGBA 格式 GUID (使用标准的 RGB4/ABGR 格式)
-# Linux UVC 使用 'BA81EB33-49C3-4F3E-9B5D-BA1D5E004344' 表示 RGB32
-echo "{ba81eb33-49c3-4f3e-9b5d-ba1d5e004344}" > $FUNCTION/streaming/uncompressed/u/guidFormat
+for i in $(seq 0 $((NUM_STREAMS - 1))); do
+    FUNCTION="$GADGET/functions/uvc.$i"
+    mkdir -p $FUNCTION
 
-# 创建帧格式目录(使用分辨率作为目录名)
-mkdir -p $FUNCTION/streaming/uncompressed/u/480p
+    # 8.1 控制接口 (Control Interface)
+    mkdir -p $FUNCTION/control/header/h
+    ln -s $FUNCTION/control/header/h $FUNCTION/control/class/fs/h 2>/dev/null || true
+    ln -s $FUNCTION/control/header/h $FUNCTION/control/class/ss/h 2>/dev/null || true
 
-echo $WIDTH > $FUNCTION/streaming/uncompressed/u/$FORMAT/wWidth
-echo $HEIGHT > $FUNCTION/streaming/uncompressed/u/$FORMAT/wHeight
-echo 166666 > $FUNCTION/streaming/uncompressed/u/$FORMAT/dwDefaultFrameInterval
-#echo 32 > $FUNCTION/streaming/uncompressed/u/$FORMAT/bBitsPerPixel
+    # 8.2 流接口 (Streaming Interface)
+    mkdir -p $FUNCTION/streaming/header/h
 
-# 计算缓冲区大小: W * H * 4 bytes (RGBA 32-bit)
-FRAME_SIZE=$((WIDTH * HEIGHT * 4))
-echo $FRAME_SIZE > $FUNCTION/streaming/uncompressed/u/$FORMAT/dwMaxVideoFrameBufferSize
-
-# 比特率 (bps) = 帧大小 * 8 * fps
-BIT_RATE=$((FRAME_SIZE * 8 * 60))
-echo $((FRAME_SIZE * 8 * 30)) > $FUNCTION/streaming/uncompressed/u/$FORMAT/dwMinBitRate
-echo $BIT_RATE > $FUNCTION/streaming/uncompressed/u/$FORMAT/dwMaxBitRate
-
-# 支持的帧率 (以 100ns 为单位的帧间隔)
-# 60fps = 166666, 30fps = 333333, 25fps = 400000, 20fps = 500000, 15fps = 666666
-cat <<EOF > $FUNCTION/streaming/uncompressed/u/$FORMAT/dwFrameInterval
-166666
-333333
-400000
-500000
-666666
-EOF
+    while read -r kind name a b c d e rest; do
+        case "$kind" in
+        streaming)
+            # 等时端点：超高速每服务间隔 maxpacket*(maxburst+1) 字节；批量端点不预留带宽
+            if [ "$c" = "bulk" ]; then
+                if [ ! -e $FUNCTION/streaming_bulk ]; then
+                    echo "❌ 错误: 内核 UVC 功能不支持批量传输 (没有 streaming_bulk 属性)"
+                    echo "   请使用 --transfer iso，或更新内核的 f_uvc 驱动"
+                    exit 1
+                fi
+                echo 1 > $FUNCTION/streaming_bulk
+            fi
+            echo $name > $FUNCTION/streaming_maxpacket
+            echo $a > $FUNCTION/streaming_maxburst
+            echo $b > $FUNCTION/streaming_interval
+            ;;
+        format)
+            # format <名称> <uncompressed|framebased> <guid> <bBitsPerPixel>
+            FORMAT_TYPE=$a
+            FORMAT_DIR=$FUNCTION/streaming/$a/$name
+            mkdir -p $FORMAT_DIR
+            echo "$b" > $FORMAT_DIR/guidFormat
+            echo $c > $FORMAT_DIR/bBitsPerPixel
+            if [ "$a" = "framebased" ]; then
+                # 压缩帧大小可变
+                echo 1 > $FORMAT_DIR/bVariableSize 2>/dev/null || true
+            fi
+            ln -s $FORMAT_DIR $FUNCTION/streaming/header/h/$name 2>/dev/null || true
+            ;;
+        frame)
+            # frame <格式> <宽> <高> <帧缓冲大小> <最小码率> <最大码率> <帧间隔...>，紧跟所属的format行
+            FRAME_DIR=$FORMAT_DIR/${a}x${b}
+            mkdir -p $FRAME_DIR
+            echo $a > $FRAME_DIR/wWidth
+            echo $b > $FRAME_DIR/wHeight
+            if [ "$FORMAT_TYPE" = "uncompressed" ]; then
+                echo $c > $FRAME_DIR/dwMaxVideoFrameBufferSize
+            else
+                # 基于帧的格式：dwBytesPerLine必须为0
+                echo 0 > $FRAME_DIR/dwBytesPerLine
+            fi
+            echo $d > $FRAME_DIR/dwMinBitRate
+            echo $e > $FRAME_DIR/dwMaxBitRate
+            # 帧间隔以 100ns 为单位，从短到长，第一个为默认值
+            set -- $rest
+            echo $1 > $FRAME_DIR/dwDefaultFrameInterval
+            printf "%s\n" "$@" > $FRAME_DIR/dwFrameInterval
+            ;;
+        esac
+    done <<< "${DESCRIPTORS[$i]}"
 
-# 链接流接口头部
-mkdir -p $FUNCTION/streaming/header/h
-ln -s $FUNCTION/streaming/uncompressed/u $FUNCTION/streaming/header/h/u 2>/dev/null || true
-ln -s $FUNCTION/streaming/header/h $FUNCTION/streaming/class/fs/h 2>/dev/null || true
-ln -s $FUNCTION/streaming/header/h $FUNCTION/streaming/class/hs/h 2>/dev/null || true
-ln -s $FUNCTION/streaming/header/h $FUNCTION/streaming/class/ss/h 2>/dev/null || true
+    # 链接流接口头部
+    ln -s $FUNCTION/streaming/header/h $FUNCTION/streaming/class/fs/h 2>/dev/null || true
+    ln -s $FUNCTION/streaming/header/h $FUNCTION/streaming/class/hs/h 2>/dev/null || true
+    ln -s $FUNCTION/streaming/header/h $FUNCTION/streaming/class/ss/h 2>/dev/null || true
+done
 
-echo "  分辨率: ${WIDTH}x${HEIGHT}"
-echo "  格式: RGBA (32-bit)"
-echo "  帧大小: $FRAME_SIZE bytes"
+for i in $(seq 0 $((NUM_STREAMS - 1))); do
+    echo "  uvc.$i:"
+    echo "${DESCRIPTORS[$i]}" | grep -E "^(streaming|format|frame) " | sed 's/^/    /'
+done
+echo "  视频流: $NUM_STREAMS (uvc.0 ~ uvc.$((NUM_STREAMS - 1)))"
 echo "  ✅ UVC 参数配置完成"
 
 # 9. 绑定功能到配置
 echo ""
 echo "[7/7] 激活并绑定..."
 
-# 链接 function 到 config
-ln -s $FUNCTION $CONFIG/uvc.0 2>/dev/null || {
-    echo "⚠️  链接已存在，跳过"
-}
+# 链接 function 到 config（接口编号由内核绑定时分配，应用程序从
+# functions/uvc.N/streaming/bInterfaceNumber 读取）
+for i in $(seq 0 $((NUM_STREAMS - 1))); do
+    ln -s $GADGET/functions/uvc.$i $CONFIG/uvc.$i 2>/dev/null || {
+        echo "⚠️  链接 uvc.$i 已存在，跳过"
+    }
+done
 
 # 10. 启用 Gadget (绑定 UDC)
 echo "  绑定 UDC: $UDC_NAME"
@@ -295,8 +350,8 @@ if [ $? -eq 0 ]; then
     echo "========================================="
     echo ""
     echo "配置信息:"
-    echo "  分辨率: ${WIDTH}x${HEIGHT}"
-    echo "  格式: RGBA (32-bit)"
+    echo "  应用程序选项: ${APP_ARGS[*]:-(配置文件默认值)}"
+    echo "  视频流: $NUM_STREAMS"
     echo "  UDC: $UDC_NAME"
     echo ""
     echo "下一步:"